@@ -7,27 +7,35 @@
 #include <SDL3/SDL_main.h>
 
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 
 namespace RayTracer
 {
 
-    HittableList CreateDemoWorld( )
+    HittableList CreateDemoWorld( MaterialTable& materials, LightList& lights )
     {
-        auto groundMaterial       = std::make_shared<Lambertian>( RgbD( 0.8, 0.8, 0.0 ) );
-        auto centerSphereMaterial = std::make_shared<Lambertian>( RgbD( 0.1, 0.2, 0.5 ) );
-        auto otherSphereMaterial  = std::make_shared<Lambertian>( RgbD( 0.5, 0.2, 0.1 ) );
-        auto leftSphereMaterial   = std::make_shared<Metal>( RgbD( 0.8, 0.8, 0.8 ) );
-        auto rightSphereMaterial  = std::make_shared<Metal>( RgbD( 0.8, 0.6, 0.2 ) );
+        auto groundMaterial       = materials.Add( Lambertian( RgbR( 0.8, 0.8, 0.0 ) ) );
+        auto centerSphereMaterial = materials.Add( Lambertian( RgbR( 0.1, 0.2, 0.5 ) ) );
+        auto otherSphereMaterial  = materials.Add( Lambertian( RgbR( 0.5, 0.2, 0.1 ) ) );
+        auto leftSphereMaterial   = materials.Add( Metal( RgbR( 0.8, 0.8, 0.8 ) ) );
+        auto rightSphereMaterial  = materials.Add( Metal( RgbR( 0.8, 0.6, 0.2 ) ) );
+
+        auto lightMaterial        = materials.Add( DiffuseLight( RgbR( 12.0, 10.0, 8.0 ) ) );
 
         //
         HittableList world;
-        world.objects.push_back( std::make_shared<Sphere>( Point3D { 0.0, -100.5, -1.0 }, 100.0, groundMaterial ) );
-        world.objects.push_back( std::make_shared<Sphere>( Point3D { 0.0, 0, -1.2 }, 0.5, centerSphereMaterial ) );
-        world.objects.push_back( std::make_shared<Sphere>( Point3D { 0.0, 0, -4.5 }, 0.3, otherSphereMaterial ) );
+        world.objects.push_back( std::make_shared<Sphere>( Point3R { 0.0, -100.5, -1.0 }, 100.0, groundMaterial ) );
+        world.objects.push_back( std::make_shared<Sphere>( Point3R { 0.0, 0, -1.2 }, 0.5, centerSphereMaterial ) );
+        world.objects.push_back( std::make_shared<Sphere>( Point3R { 0.0, 0, -4.5 }, 0.3, otherSphereMaterial ) );
+
+        world.objects.push_back( std::make_shared<Sphere>( Point3R { -1.0, 0.0, -1.0 }, 0.5, leftSphereMaterial ) );
+        world.objects.push_back( std::make_shared<Sphere>( Point3R { 1.0, 0.0, -1.0 }, 0.5, rightSphereMaterial ) );
 
-        world.objects.push_back( std::make_shared<Sphere>( Point3D { -1.0, 0.0, -1.0 }, 0.5, leftSphereMaterial ) );
-        world.objects.push_back( std::make_shared<Sphere>( Point3D { 1.0, 0.0, -1.0 }, 0.5, rightSphereMaterial ) );
+        auto light = std::make_shared<Sphere>( Point3R { 0.0, 1.2, -1.5 }, 0.15, lightMaterial );
+        world.objects.push_back( light );
+        lights.Add( *light, materials );
 
         return world;
     }
@@ -36,17 +44,36 @@ namespace RayTracer
     {
         private:
 
-            SDL_Window*      window         = nullptr;
-            SDL_Renderer*    renderer       = nullptr;
-            SDL_Surface*     renderSurface  = nullptr;
-            SDL_Texture*     surfaceTexture = nullptr;
+            SDL_Window*   window        = nullptr;
+            SDL_Renderer* renderer      = nullptr;
+            SDL_Texture*  renderTexture = nullptr;
+
+            int           windowWidth   = 0;
+            int           windowHeight  = 0;
+
+            Application*  application;
 
-            ImageView<Rgba8> renderBuffer;
+            // Gives the application write access to the pixels of the streaming texture. Returns false if the texture
+            // could not be locked.
+            template <class WriteFunction>
+            bool WriteTexture( WriteFunction writeFunction )
+            {
+                void* pixels = nullptr;
+                int   pitch  = 0;
+
+                if ( !SDL_LockTexture( renderTexture, NULL, &pixels, &pitch ) )
+                {
+                    SDL_Log( "Couldn't lock texture: %s", SDL_GetError( ) );
+                    return false;
+                }
 
-            int              windowWidth  = 0;
-            int              windowHeight = 0;
+                ImageView<Rgba8> textureView( static_cast<uint8_t*>( pixels ), windowWidth, windowHeight, pitch );
+                writeFunction( textureView );
 
-            Application*     application;
+                SDL_UnlockTexture( renderTexture );
+
+                return true;
+            }
 
         public:
 
@@ -57,17 +84,20 @@ namespace RayTracer
 
             ~GuiManager( )
             {
-                if ( renderSurface != nullptr )
-                {
-                    SDL_DestroySurface( renderSurface );
-                }
+                delete application;
+            }
 
-                if ( surfaceTexture != nullptr )
+            // Runs before SDL shuts down. The render thread is stopped first, so nothing touches the frames or the
+            // texture once they go away.
+            void QuitSdl( void* appstate, SDL_AppResult result )
+            {
+                application->StopRendering( );
+
+                if ( renderTexture != nullptr )
                 {
-                    SDL_DestroyTexture( surfaceTexture );
+                    SDL_DestroyTexture( renderTexture );
+                    renderTexture = nullptr;
                 }
-
-                delete application;
             }
 
             SDL_AppResult InitSdl( void** appstate, int argc, char* argv[] )
@@ -88,21 +118,31 @@ namespace RayTracer
                     return SDL_APP_FAILURE;
                 }
 
-                if ( renderSurface != nullptr )
-                {
-                    SDL_DestroySurface( renderSurface );
-                }
-
-                this->renderSurface = SDL_CreateSurface( this->windowWidth, this->windowHeight, SDL_PIXELFORMAT_RGBA32 );
-                this->renderBuffer  = ImageView<Rgba8>( static_cast<uint8_t*>( renderSurface->pixels ), renderSurface->w, renderSurface->h, renderSurface->pitch );
+                // Rendering runs on its own thread, so the event loop would otherwise spin as fast as it can.
+                SDL_SetRenderVSync( renderer, 1 );
 
-                application->InitRenderBuffer( this->renderBuffer );
+                // Created once and updated in place, instead of uploading a new texture for every frame.
+                renderTexture = SDL_CreateTexture( renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, this->windowWidth, this->windowHeight );
 
-                if ( renderSurface != nullptr )
+                if ( renderTexture == nullptr )
                 {
-                    surfaceTexture = SDL_CreateTextureFromSurface( renderer, renderSurface );
+                    SDL_Log( "Couldn't create texture: %s", SDL_GetError( ) );
+                    return SDL_APP_FAILURE;
                 }
 
+                // The contents of a new streaming texture are undefined until the first frame arrives.
+                WriteTexture(
+                    []( ImageView<Rgba8>& textureView )
+                    {
+                        for ( SizeType j = 0; j < textureView.GetHeight( ); j++ )
+                        {
+                            auto row = textureView.GetRowSpan( j );
+                            std::fill( row.begin( ), row.end( ), Rgba8( ) );
+                        }
+                    } );
+
+                application->InitRenderBuffer( this->windowWidth, this->windowHeight );
+
                 return SDL_APP_CONTINUE;
             }
 
@@ -110,19 +150,18 @@ namespace RayTracer
             {
                 const double timeSec = ( double( SDL_GetTicks( ) ) ) / 1000.0;
 
-                if ( application->Iterate( timeSec, this->renderBuffer ) )
+                if ( application->Iterate( timeSec ) )
                 {
-                    if ( surfaceTexture != nullptr )
-                    {
-                        SDL_DestroyTexture( surfaceTexture );
-                    }
-
-                    surfaceTexture = SDL_CreateTextureFromSurface( renderer, renderSurface );
+                    WriteTexture(
+                        [ this ]( ImageView<Rgba8>& textureView )
+                        {
+                            application->PresentFrame( textureView );
+                        } );
                 }
 
                 SDL_SetRenderDrawColorFloat( renderer, 0.0, 0.0, 0.0, SDL_ALPHA_OPAQUE_FLOAT );
                 SDL_RenderClear( renderer );
-                SDL_RenderTexture( renderer, surfaceTexture, NULL, NULL );
+                SDL_RenderTexture( renderer, renderTexture, NULL, NULL );
                 SDL_RenderPresent( renderer );
 
                 return SDL_APP_CONTINUE;
@@ -199,9 +238,33 @@ namespace RayTracer
     GuiManager guiManager;
 
 
-    Application::Application( ) : camera( 1.0, 68.0 )
+    Application::Application( ) : camera( 1.0, 68.0 ), publishedCamera( camera )
+    {
+        world = SceneBvh( CreateDemoWorld( materials, lights ) );
+
+        // Accumulation passes continue the same Sobol sequence, so the image converges faster than with random samples.
+        camera.SetSampler( std::make_shared<SobolSampler>( ) );
+        publishedCamera = camera;
+    }
+
+    Application::~Application( )
     {
-        world = CreateDemoWorld( );
+        StopRendering( );
+    }
+
+    void Application::StopRendering( )
+    {
+        {
+            std::lock_guard<std::mutex> lock( renderMutex );
+            stopRendering = true;
+        }
+
+        renderCondition.notify_all( );
+
+        if ( renderThread.joinable( ) )
+        {
+            renderThread.join( );
+        }
     }
 
     void Application::InitGui( int& windowWidth, int& windowHeight )
@@ -210,15 +273,135 @@ namespace RayTracer
         windowHeight = 480;
     }
 
-    void Application::InitRenderBuffer( ImageView<Rgba8>& /* renderBuffer */ )
+    void Application::InitRenderBuffer( SizeType width, SizeType height )
     {
+        frames[ 0 ].assign( width * height, Rgba8( ) );
+        frames[ 1 ].assign( width * height, Rgba8( ) );
+
+        renderThread = std::thread( &Application::RenderLoop, this, width, height );
     }
 
-    bool Application::Iterate( const double& timeSec, ImageView<Rgba8>& renderBuffer )
+    void Application::RenderLoop( SizeType width, SizeType height )
+    {
+        // Iterate publishes the camera and reads the accumulation state under the lock, from the start.
+        std::unique_lock<std::mutex> startLock( renderMutex );
+
+        Camera                       renderCamera          = publishedCamera;
+        uint64_t                     renderViewVersion     = renderCamera.GetViewVersion( );
+        double                       renderResolutionScale = 1.0;
+
+        std::vector<Rgba8>           scaledFrame;
+
+        accumulationBuffer                                 = RgbImageD( width, height );
+        accumulatedSampleCount                             = 0;
+
+        startLock.unlock( );
+
+        while ( true )
+        {
+            {
+                std::unique_lock<std::mutex> lock( renderMutex );
+
+                // Sleeps once the image has converged, until the camera moves again.
+                renderCondition.wait( lock,
+                    [ & ]
+                    {
+                        return stopRendering || publishedCamera.GetViewVersion( ) != renderViewVersion || accumulatedSampleCount < maxAccumulatedSamples || resolutionScale != renderResolutionScale;
+                    } );
+
+                if ( stopRendering )
+                {
+                    return;
+                }
+
+                if ( publishedCamera.GetViewVersion( ) != renderViewVersion )
+                {
+                    renderCamera      = publishedCamera;
+                    renderViewVersion = renderCamera.GetViewVersion( );
+
+                    accumulationBuffer.Fill( RgbD( 0, 0, 0 ) );
+                    accumulatedSampleCount = 0;
+                }
+
+                // Rounded to sixteenths so that small corrections do not reallocate the buffers on every frame.
+                renderResolutionScale = resolutionScale;
+
+                double   roundedScale = std::max( std::round( renderResolutionScale * 16.0 ) / 16.0, 1.0 / 16.0 );
+                SizeType scaledWidth  = std::max( SizeType( 1 ), SizeType( std::lround( double( width ) * roundedScale ) ) );
+                SizeType scaledHeight = std::max( SizeType( 1 ), SizeType( std::lround( double( height ) * roundedScale ) ) );
+
+                if ( scaledWidth != accumulationBuffer.GetWidth( ) || scaledHeight != accumulationBuffer.GetHeight( ) )
+                {
+                    accumulationBuffer     = RgbImageD( scaledWidth, scaledHeight );
+                    accumulatedSampleCount = 0;
+                }
+            }
+
+            auto frameStart = std::chrono::steady_clock::now( );
+
+            renderCamera.Accumulate( world, materials, lights, accumulationBuffer, maxBounces, samplesPerPixel, accumulatedSampleCount );
+            accumulatedSampleCount += samplesPerPixel;
+
+            std::vector<Rgba8>& backFrame = frames[ 1 - frontFrameIndex ];
+            RgbaImageView8      backFrameView( reinterpret_cast<uint8_t*>( backFrame.data( ) ), width, height, width * sizeof( Rgba8 ) );
+
+            if ( accumulationBuffer.GetWidth( ) == width && accumulationBuffer.GetHeight( ) == height )
+            {
+                Resolve( accumulationBuffer, accumulatedSampleCount, backFrameView );
+            }
+            else
+            {
+                SizeType scaledWidth  = accumulationBuffer.GetWidth( );
+                SizeType scaledHeight = accumulationBuffer.GetHeight( );
+
+                scaledFrame.resize( scaledWidth * scaledHeight );
+                RgbaImageView8 scaledFrameView( reinterpret_cast<uint8_t*>( scaledFrame.data( ) ), scaledWidth, scaledHeight, scaledWidth * sizeof( Rgba8 ) );
+
+                Resolve( accumulationBuffer, accumulatedSampleCount, scaledFrameView );
+                ResizeNearest( scaledFrameView, backFrameView );
+            }
+
+            std::lock_guard<std::mutex> lock( renderMutex );
+            frontFrameIndex  = 1 - frontFrameIndex;
+            frameReady       = true;
+            lastFrameTimeSec = std::chrono::duration<double>( std::chrono::steady_clock::now( ) - frameStart ).count( );
+        }
+    }
+
+    void Application::UpdateResolutionScale( const double& timeSec )
+    {
+        if ( camera.GetViewVersion( ) != publishedCamera.GetViewVersion( ) )
+        {
+            lastViewChangeTimeSec = timeSec;
+        }
+
+        if ( timeSec - lastViewChangeTimeSec >= idleDelaySec )
+        {
+            if ( resolutionScale != 1.0 )
+            {
+                resolutionScale = 1.0;
+                renderCondition.notify_one( );
+            }
+
+            return;
+        }
+
+        // Only a new frame brings a new measurement.
+        if ( !frameReady || lastFrameTimeSec <= 0.0 )
+        {
+            return;
+        }
+
+        // The cost of a frame follows its pixel count, which is the square of the scale. The correction is limited to
+        // avoid oscillating on a single slow or fast frame.
+        double correction = std::clamp( std::sqrt( 1.0 / ( targetFps * lastFrameTimeSec ) ), 0.5, 1.25 );
+        resolutionScale   = std::clamp( resolutionScale * correction, minResolutionScale, 1.0 );
+    }
+
+    bool Application::Iterate( const double& timeSec )
     {
         static double   prevFrameTimeSec  = 0;
         static double   prevReportTimeSec = 0;
-        static SizeType reportFrameCount  = 0;
 
         
 
@@ -227,13 +410,9 @@ namespace RayTracer
 
         if ( reportDurationSec >= 1.0 )
         {
-            std::cout << "Fps: " << double( reportFrameCount ) / reportDurationSec << std::endl;
-            reportFrameCount  = 1;
-            prevReportTimeSec = timeSec;
-        }
-        else
-        {
-            reportFrameCount++;
+            std::cout << "Fps: " << double( presentedFrameCount ) / reportDurationSec << ", resolution scale: " << resolutionScale << std::endl;
+            presentedFrameCount = 0;
+            prevReportTimeSec   = timeSec;
         }
 
         if ( rotate )
@@ -243,7 +422,10 @@ namespace RayTracer
             double deltaX   = mousePos.x( ) - rotateStart.x( );
             double deltaY   = mousePos.y( ) - rotateStart.y( );
 
-            camera.Rotate( Vec<double, 2> { -10.0 * deltaX * deltaTimeSec, -10.0 * deltaY * deltaTimeSec } );
+            if ( deltaX != 0 || deltaY != 0 )
+            {
+                camera.Rotate( Vec<double, 2> { -10.0 * deltaX * deltaTimeSec, -10.0 * deltaY * deltaTimeSec } );
+            }
 
             rotateStart = mousePos;
         }
@@ -284,11 +466,34 @@ namespace RayTracer
             moveVelocityPerSec = minMoveVelocityPerSec;
         }
 
-        camera.Render( world, renderBuffer, maxBounces, samplesPerPixel );
-
         prevFrameTimeSec = timeSec;
 
-        return true;
+        std::lock_guard<std::mutex> lock( renderMutex );
+
+        UpdateResolutionScale( timeSec );
+
+        if ( camera.GetViewVersion( ) != publishedCamera.GetViewVersion( ) )
+        {
+            publishedCamera = camera;
+            renderCondition.notify_one( );
+        }
+
+        return frameReady;
+    }
+
+    void Application::PresentFrame( ImageView<Rgba8>& renderBuffer )
+    {
+        std::lock_guard<std::mutex> lock( renderMutex );
+
+        const std::vector<Rgba8>&   frontFrame = frames[ frontFrameIndex ];
+
+        for ( SizeType j = 0; j < renderBuffer.GetHeight( ); j++ )
+        {
+            std::copy_n( frontFrame.data( ) + j * renderBuffer.GetWidth( ), renderBuffer.GetWidth( ), renderBuffer.GetRowSpan( j ).data( ) );
+        }
+
+        frameReady = false;
+        presentedFrameCount++;
     }
 
     Point2F Application::GetMousePosition( ) const
@@ -406,4 +611,5 @@ SDL_AppResult SDL_AppIterate( void* appstate )
 void SDL_AppQuit( void* appstate, SDL_AppResult result )
 {
     // SDL will clean up the window/renderer for us.
+    guiManager.QuitSdl( appstate, result );
 }
@@ -5,6 +5,12 @@
 #include "Common.hpp"
 #include "Hittable.hpp"
 #include "Image.hpp"
+#include "WideBvh.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace RayTracer
 {
@@ -14,10 +20,46 @@ namespace RayTracer
             SizeType     maxBounces      = 10;
             SizeType     samplesPerPixel = 1;
 
-            HittableList world;
+            SceneBvh      world;
+            MaterialTable materials;
+            LightList     lights;
 
+            // Moved by the event loop. The render thread works on a copy taken from publishedCamera.
             Camera       camera;
 
+            // Sums of the samples taken since the camera last moved. Only touched by the render thread.
+            RgbImageD    accumulationBuffer;
+            SizeType     accumulatedSampleCount = 0;
+            SizeType     maxAccumulatedSamples  = 4096;
+
+            // The render thread resolves into the back frame and swaps it with the front frame, which the event loop
+            // copies to the window. Everything below is guarded by renderMutex.
+            std::thread             renderThread;
+            std::mutex              renderMutex;
+            std::condition_variable renderCondition;
+            Camera                  publishedCamera;
+            std::vector<Rgba8>      frames[ 2 ];
+            SizeType                frontFrameIndex = 0;
+            bool                    frameReady      = false;
+            bool                    stopRendering   = false;
+
+            // Frames picked up by PresentFrame, so the reported rate is that of the render thread.
+            SizeType                presentedFrameCount = 0;
+
+            // Dynamic resolution. While the camera moves, the render thread works at a fraction of the window size
+            // chosen so that a frame takes about 1 / targetFps, and the frame is upscaled for display. Once the camera
+            // has been still for idleDelaySec, rendering goes back to full resolution and converges.
+            double                  targetFps             = 30.0;
+            double                  minResolutionScale    = 0.25;
+            double                  idleDelaySec          = 0.25;
+            double                  resolutionScale       = 1.0; // Guarded by renderMutex.
+            double                  lastFrameTimeSec      = 0.0; // Guarded by renderMutex, written by the render thread.
+            double                  lastViewChangeTimeSec = 0.0;
+
+            void                    UpdateResolutionScale( const double& timeSec );
+
+            void                    RenderLoop( SizeType width, SizeType height );
+
             bool         rotate = false;
             Point2F      rotateStart;
 
@@ -35,9 +77,18 @@ namespace RayTracer
 
             Application( );
 
+            virtual ~Application( );
+
+            // Stops and joins the render thread. Called when the application quits, while SDL is still up, and again by
+            // the destructor, where it does nothing.
+            void         StopRendering( );
+
             void         InitGui( int& windowWidth, int& windowHeight );
-            void         InitRenderBuffer( ImageView<Rgba8>& renderBuffer );
-            bool         Iterate( const double& timeSec, ImageView<Rgba8>& renderBuffer );
+            void         InitRenderBuffer( SizeType width, SizeType height );
+
+            // Handles input. Returns true when the render thread has a new frame for PresentFrame.
+            bool         Iterate( const double& timeSec );
+            void         PresentFrame( ImageView<Rgba8>& renderBuffer );
 
 
             Point2F      GetMousePosition( ) const;
@@ -0,0 +1,9 @@
+#include "Aabb.hpp"
+
+namespace RayTracer
+{
+
+    template class Aabb<float>;
+    template class Aabb<double>;
+
+} // namespace RayTracer
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "Algebra.hpp"
+#include "Interval.hpp"
+#include "Ray.hpp"
+
+#include <limits>
+
+namespace RayTracer
+{
+
+    template <typename Type>
+    class Aabb
+    {
+        private:
+
+            Point<Type, 3> minimum { std::numeric_limits<Type>::infinity( ), std::numeric_limits<Type>::infinity( ), std::numeric_limits<Type>::infinity( ) };
+            Point<Type, 3> maximum { -std::numeric_limits<Type>::infinity( ), -std::numeric_limits<Type>::infinity( ), -std::numeric_limits<Type>::infinity( ) };
+
+        public:
+
+            Aabb( )
+            {
+            }
+
+            Aabb( const Point<Type, 3>& minimum, const Point<Type, 3>& maximum ) : minimum( minimum ), maximum( maximum )
+            {
+            }
+
+            const Point<Type, 3>& GetMin( ) const
+            {
+                return minimum;
+            }
+
+            const Point<Type, 3>& GetMax( ) const
+            {
+                return maximum;
+            }
+
+            bool IsEmpty( ) const
+            {
+                return maximum[ 0 ] < minimum[ 0 ] || maximum[ 1 ] < minimum[ 1 ] || maximum[ 2 ] < minimum[ 2 ];
+            }
+
+            Vec<Type, 3> GetExtent( ) const
+            {
+                return maximum - minimum;
+            }
+
+            Point<Type, 3> GetCentroid( ) const
+            {
+                return minimum + Type( 0.5 ) * ( maximum - minimum );
+            }
+
+            Type GetSurfaceArea( ) const
+            {
+                if ( IsEmpty( ) )
+                {
+                    return 0;
+                }
+
+                Vec<Type, 3> e = GetExtent( );
+
+                return Type( 2 ) * ( e[ 0 ] * e[ 1 ] + e[ 1 ] * e[ 2 ] + e[ 2 ] * e[ 0 ] );
+            }
+
+            SizeType GetLongestAxis( ) const
+            {
+                Vec<Type, 3> e = GetExtent( );
+
+                if ( e[ 0 ] > e[ 1 ] && e[ 0 ] > e[ 2 ] )
+                {
+                    return 0;
+                }
+
+                return e[ 1 ] > e[ 2 ] ? 1 : 2;
+            }
+
+            void Expand( const Point<Type, 3>& p )
+            {
+                for ( SizeType axis = 0; axis < 3; axis++ )
+                {
+                    minimum[ axis ] = std::min( minimum[ axis ], p[ axis ] );
+                    maximum[ axis ] = std::max( maximum[ axis ], p[ axis ] );
+                }
+            }
+
+            void Expand( const Aabb& other )
+            {
+                for ( SizeType axis = 0; axis < 3; axis++ )
+                {
+                    minimum[ axis ] = std::min( minimum[ axis ], other.minimum[ axis ] );
+                    maximum[ axis ] = std::max( maximum[ axis ], other.maximum[ axis ] );
+                }
+            }
+
+            // Slab test. inverseDirection is passed in so that it is computed once per ray rather than once per box.
+            bool Hit( const Ray<Type>& ray, const Vec<Type, 3>& inverseDirection, const Interval<Type>& rayParameterInterval ) const
+            {
+                Type tMin = rayParameterInterval.GetFrom( );
+                Type tMax = rayParameterInterval.GetTo( );
+
+                for ( SizeType axis = 0; axis < 3; axis++ )
+                {
+                    Type t0 = ( minimum[ axis ] - ray.GetOrigin( )[ axis ] ) * inverseDirection[ axis ];
+                    Type t1 = ( maximum[ axis ] - ray.GetOrigin( )[ axis ] ) * inverseDirection[ axis ];
+
+                    if ( inverseDirection[ axis ] < 0 )
+                    {
+                        std::swap( t0, t1 );
+                    }
+
+                    tMin = t0 > tMin ? t0 : tMin;
+                    tMax = t1 < tMax ? t1 : tMax;
+
+                    if ( tMax < tMin )
+                    {
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+    };
+
+    template <typename Type>
+    inline Aabb<Type> Union( Aabb<Type> a, const Aabb<Type>& b )
+    {
+        a.Expand( b );
+
+        return a;
+    }
+
+
+    extern template class Aabb<float>;
+    extern template class Aabb<double>;
+
+    using AabbF = Aabb<float>;
+    using AabbD = Aabb<double>;
+    using AabbR = Aabb<RealType>;
+
+} // namespace RayTracer
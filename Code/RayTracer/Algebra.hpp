@@ -3,6 +3,7 @@
 #include "Array.hpp"
 #include "Common.hpp"
 #include "ConstexprFor.hpp"
+#include "Random.hpp"
 #include <cmath>
 
 
@@ -79,22 +80,36 @@ namespace RayTracer
 
             inline Point& operator+=( const Vec<T, Dimension>& vec )
             {
-                Constexpr_For<SizeType, 0, Dimension>(
-                    [ this, &vec ]( auto i )
-                    {
-                        ( *this )[ i ] += vec[ i ];
-                    } );
+                if constexpr ( isPaddedArray<T, Dimension> )
+                {
+                    ( Simd<T, 4>::Load( this->GetData( ) ) + Simd<T, 4>::Load( vec.GetData( ) ) ).Store( this->GetData( ) );
+                }
+                else
+                {
+                    Constexpr_For<SizeType, 0, Dimension>(
+                        [ this, &vec ]( auto i )
+                        {
+                            ( *this )[ i ] += vec[ i ];
+                        } );
+                }
 
                 return *this;
             }
 
             inline Point& operator-=( const Vec<T, Dimension>& vec )
             {
-                Constexpr_For<SizeType, 0, Dimension>(
-                    [ this, &vec ]( auto i )
-                    {
-                        ( *this )[ i ] -= vec[ i ];
-                    } );
+                if constexpr ( isPaddedArray<T, Dimension> )
+                {
+                    ( Simd<T, 4>::Load( this->GetData( ) ) - Simd<T, 4>::Load( vec.GetData( ) ) ).Store( this->GetData( ) );
+                }
+                else
+                {
+                    Constexpr_For<SizeType, 0, Dimension>(
+                        [ this, &vec ]( auto i )
+                        {
+                            ( *this )[ i ] -= vec[ i ];
+                        } );
+                }
 
                 return *this;
             }
@@ -108,55 +123,85 @@ namespace RayTracer
 
             inline Vec& operator+=( const Vec& v )
             {
-                Constexpr_For<SizeType, 0, Dimension>(
-                    [ this, &v ]( auto i )
-                    {
-                        ( *this )[ i ] += v[ i ];
-                    } );
+                if constexpr ( isPaddedArray<T, Dimension> )
+                {
+                    ( Simd<T, 4>::Load( this->GetData( ) ) + Simd<T, 4>::Load( v.GetData( ) ) ).Store( this->GetData( ) );
+                }
+                else
+                {
+                    Constexpr_For<SizeType, 0, Dimension>(
+                        [ this, &v ]( auto i )
+                        {
+                            ( *this )[ i ] += v[ i ];
+                        } );
+                }
 
                 return *this;
             }
 
             inline Vec& operator-=( const Vec& v )
             {
-                Constexpr_For<SizeType, 0, Dimension>(
-                    [ this, &v ]( auto i )
-                    {
-                        ( *this )[ i ] -= v[ i ];
-                    } );
+                if constexpr ( isPaddedArray<T, Dimension> )
+                {
+                    ( Simd<T, 4>::Load( this->GetData( ) ) - Simd<T, 4>::Load( v.GetData( ) ) ).Store( this->GetData( ) );
+                }
+                else
+                {
+                    Constexpr_For<SizeType, 0, Dimension>(
+                        [ this, &v ]( auto i )
+                        {
+                            ( *this )[ i ] -= v[ i ];
+                        } );
+                }
 
                 return *this;
             }
 
             inline Vec& operator*=( const T& s )
             {
-                Constexpr_For<SizeType, 0, Dimension>(
-                    [ this, &s ]( auto i )
-                    {
-                        ( *this )[ i ] *= s;
-                    } );
+                if constexpr ( isPaddedArray<T, Dimension> )
+                {
+                    ( Simd<T, 4>::Load( this->GetData( ) ) * Simd<T, 4>::Broadcast( s ) ).Store( this->GetData( ) );
+                }
+                else
+                {
+                    Constexpr_For<SizeType, 0, Dimension>(
+                        [ this, &s ]( auto i )
+                        {
+                            ( *this )[ i ] *= s;
+                        } );
+                }
 
                 return *this;
             }
 
             inline Vec& operator/=( const T& s )
             {
-                *( this ) *= 1.0 / s;
+                *( this ) *= T( 1 ) / s;
 
                 return *this;
             }
 
             inline T MagSquare( ) const
             {
-                T m = 0;
-
-                Constexpr_For<SizeType, 0, Dimension>(
-                    [ this, &m ]( auto i )
-                    {
-                        m += std::powf( ( *this )[ i ], 2 );
-                    } );
-
-                return m;
+                if constexpr ( isPaddedArray<T, Dimension> )
+                {
+                    Simd<T, 4> v = Simd<T, 4>::Load( this->GetData( ) );
+
+                    return ReduceAdd3( v * v );
+                }
+                else
+                {
+                    T m = 0;
+
+                    Constexpr_For<SizeType, 0, Dimension>(
+                        [ this, &m ]( auto i )
+                        {
+                            m += ( *this )[ i ] * ( *this )[ i ];
+                        } );
+
+                    return m;
+                }
             }
 
             inline T Magnitude( ) const
@@ -206,12 +251,18 @@ namespace RayTracer
     template <typename T, SizeType Dimension>
     inline Vec<T, Dimension> operator-( Vec<T, Dimension> v )
     {
-        Constexpr_For<SizeType, 0, Dimension>(
-            [ &v ]( auto i )
-            {
-                v[ i ] -= v[ i ];
-            } );
-
+        if constexpr ( isPaddedArray<T, Dimension> )
+        {
+            ( Simd<T, 4>::Broadcast( 0 ) - Simd<T, 4>::Load( v.GetData( ) ) ).Store( v.GetData( ) );
+        }
+        else
+        {
+            Constexpr_For<SizeType, 0, Dimension>(
+                [ &v ]( auto i )
+                {
+                    v[ i ] = -v[ i ];
+                } );
+        }
 
         return v;
     }
@@ -221,11 +272,18 @@ namespace RayTracer
     {
         Vec<T, Dimension> vec;
 
-        Constexpr_For<SizeType, 0, Dimension>(
-            [ &vec, &a, &b ]( auto i )
-            {
-                vec[ i ] = a[ i ] - b[ i ];
-            } );
+        if constexpr ( isPaddedArray<T, Dimension> )
+        {
+            ( Simd<T, 4>::Load( a.GetData( ) ) - Simd<T, 4>::Load( b.GetData( ) ) ).Store( vec.GetData( ) );
+        }
+        else
+        {
+            Constexpr_For<SizeType, 0, Dimension>(
+                [ &vec, &a, &b ]( auto i )
+                {
+                    vec[ i ] = a[ i ] - b[ i ];
+                } );
+        }
 
         return vec;
     }
@@ -260,30 +318,51 @@ namespace RayTracer
     }
 
     template <typename T, SizeType Dimension>
-    inline T Dot( const Vec<T, Dimension>& u, const Vec<T, 3>& v )
+    inline T Dot( const Vec<T, Dimension>& u, const Vec<T, Dimension>& v )
     {
-        T d = 0.0;
+        if constexpr ( isPaddedArray<T, Dimension> )
+        {
+            return ReduceAdd3( Simd<T, 4>::Load( u.GetData( ) ) * Simd<T, 4>::Load( v.GetData( ) ) );
+        }
+        else
+        {
+            T d = 0;
 
-        Constexpr_For<SizeType, 0, Dimension>(
-            [ &d, &u, &v ]( auto i )
-            {
-                d += u[ i ] * v[ i ];
-            } );
+            Constexpr_For<SizeType, 0, Dimension>(
+                [ &d, &u, &v ]( auto i )
+                {
+                    d += u[ i ] * v[ i ];
+                } );
 
-        return d;
+            return d;
+        }
     }
 
 
     template <typename T>
     inline Vec<T, 3> Cross( const Vec<T, 3>& u, const Vec<T, 3>& v )
     {
-        return Vec<T, 3> { u[ 1 ] * v[ 2 ] - u[ 2 ] * v[ 1 ], u[ 2 ] * v[ 0 ] - u[ 0 ] * v[ 2 ], u[ 0 ] * v[ 1 ] - u[ 1 ] * v[ 0 ] };
+        if constexpr ( isPaddedArray<T, 3> )
+        {
+            // u.yzx * v.zxy - u.zxy * v.yzx, with the padding lane left in place.
+            Simd<T, 4> a = Simd<T, 4>::Load( u.GetData( ) );
+            Simd<T, 4> b = Simd<T, 4>::Load( v.GetData( ) );
+            Vec<T, 3>  cross;
+
+            ( Permute<1, 2, 0, 3>( a ) * Permute<2, 0, 1, 3>( b ) - Permute<2, 0, 1, 3>( a ) * Permute<1, 2, 0, 3>( b ) ).Store( cross.GetData( ) );
+
+            return cross;
+        }
+        else
+        {
+            return Vec<T, 3> { u[ 1 ] * v[ 2 ] - u[ 2 ] * v[ 1 ], u[ 2 ] * v[ 0 ] - u[ 0 ] * v[ 2 ], u[ 0 ] * v[ 1 ] - u[ 1 ] * v[ 0 ] };
+        }
     }
 
     template <typename T>
     inline Vec<T, 3> Reflect( const Vec<T, 3>& vec, const Vec<T, 3>& normal )
     {
-        return vec - 2.0 * Dot( vec, normal ) * normal;
+        return vec - T( 2 ) * Dot( vec, normal ) * normal;
     }
 
 
@@ -293,7 +372,7 @@ namespace RayTracer
         T cosTheta = std::cos( DegreesToRadians( angleDeg ) );
         T sinTheta = std::sin( DegreesToRadians( angleDeg ) );
 
-        return vec * cosTheta + Cross( normalizedRotationAxis, vec ) * sinTheta + normalizedRotationAxis * Dot( normalizedRotationAxis, vec ) * ( 1.0 - cosTheta );
+        return vec * cosTheta + Cross( normalizedRotationAxis, vec ) * sinTheta + normalizedRotationAxis * Dot( normalizedRotationAxis, vec ) * ( T( 1 ) - cosTheta );
     }
 
     template <typename T>
@@ -303,36 +382,69 @@ namespace RayTracer
         T         sinTheta    = std::sin( DegreesToRadians( angleDeg ) );
 
         Vec<T, 3> vec         = point - rotationPoint;
-        vec                   = vec * cosTheta + Cross( normalizedRotationAxis, vec ) * sinTheta + normalizedRotationAxis * Dot( normalizedRotationAxis, vec ) * ( 1.0 - cosTheta );
+        vec                   = vec * cosTheta + Cross( normalizedRotationAxis, vec ) * sinTheta + normalizedRotationAxis * Dot( normalizedRotationAxis, vec ) * ( T( 1 ) - cosTheta );
 
         return rotationPoint += vec;
     }
 
     template <class T>
-    Vec<T, 3> CreateRandomVector( )
+    Vec<T, 3> CreateRandomVector( Pcg32& rng )
     {
-        return Vec<T, 3> { RandomReal<T>( ), RandomReal<T>( ), RandomReal<T>( ) };
+        return Vec<T, 3> { RandomReal<T>( rng ), RandomReal<T>( rng ), RandomReal<T>( rng ) };
     }
 
     template <typename T>
-    Vec<T, 3> CreateRandomVector( const T& min, const T& max )
+    Vec<T, 3> CreateRandomVector( Pcg32& rng, const T& min, const T& max )
     {
-        return Vec<T, 3> { RandomReal<T>( min, max ), RandomReal<T>( min, max ), RandomReal<T>( min, max ) };
+        return Vec<T, 3> { RandomReal<T>( rng, min, max ), RandomReal<T>( rng, min, max ), RandomReal<T>( rng, min, max ) };
     }
 
+    // Maps a uniform point of [0, 1)^2 to a unit vector uniformly distributed on the sphere, in closed form.
     template <typename T>
-    Vec<T, 3> CreateRandomUnitVector( )
+    inline Vec<T, 3> SampleUniformSphere( const Point<T, 2>& u )
     {
-        while ( true )
-        {
-            Vec<T, 3> p         = CreateRandomVector( -1.0, 1.0 );
-            T         magSquare = p.MagSquare( );
+        T z   = T( 1 ) - T( 2 ) * u[ 0 ];
+        T r   = std::sqrt( std::max( T( 0 ), T( 1 ) - z * z ) );
+        T phi = T( 2 ) * T( pi ) * u[ 1 ];
 
-            if ( 1e-16 < magSquare && magSquare <= 1.0 )
-            {
-                return p / sqrt( magSquare );
-            }
-        }
+        return Vec<T, 3> { r * std::cos( phi ), r * std::sin( phi ), z };
+    }
+
+    // Completes the unit vector n to an orthonormal basis without branches (Duff et al. 2017).
+    template <typename T>
+    inline void CreateOrthonormalBasis( const Vec<T, 3>& n, Vec<T, 3>& b1, Vec<T, 3>& b2 )
+    {
+        T sign = std::copysign( T( 1 ), n[ 2 ] );
+        T a    = T( -1 ) / ( sign + n[ 2 ] );
+        T b    = n[ 0 ] * n[ 1 ] * a;
+
+        b1     = Vec<T, 3> { T( 1 ) + sign * n[ 0 ] * n[ 0 ] * a, sign * b, -sign * n[ 0 ] };
+        b2     = Vec<T, 3> { b, sign + n[ 1 ] * n[ 1 ] * a, -n[ 1 ] };
+    }
+
+    // Maps a uniform point of [0, 1)^2 to a unit vector in the hemisphere around the unit normal, with density
+    // cos(theta) / pi. A uniform point of the unit disk is projected up to the hemisphere (Malley's method).
+    template <typename T>
+    inline Vec<T, 3> SampleCosineHemisphere( const Vec<T, 3>& normal, const Point<T, 2>& u )
+    {
+        T         r   = std::sqrt( u[ 0 ] );
+        T         phi = T( 2 ) * T( pi ) * u[ 1 ];
+        T         z   = std::sqrt( std::max( T( 0 ), T( 1 ) - u[ 0 ] ) );
+
+        Vec<T, 3> b1;
+        Vec<T, 3> b2;
+        CreateOrthonormalBasis( normal, b1, b2 );
+
+        return b1 * ( r * std::cos( phi ) ) + b2 * ( r * std::sin( phi ) ) + normal * z;
+    }
+
+    template <typename T>
+    Vec<T, 3> CreateRandomUnitVector( Pcg32& rng )
+    {
+        T u0 = RandomReal<T>( rng );
+        T u1 = RandomReal<T>( rng );
+
+        return SampleUniformSphere( Point<T, 2> { u0, u1 } );
     }
 
     template <typename T>
@@ -409,6 +521,7 @@ namespace RayTracer
     // extern template Vec3D operator+( const Vec3D& u, const Vec3D& v );
 
     using Point2F = Point<float, 2>;
+    using Point2D = Point<double, 2>;
 
     using Vec3D   = Vec<double, 3>;
     using Point3D = Point<double, 3>;
@@ -421,6 +534,10 @@ namespace RayTracer
     using Vec3F   = Vec<float, 3>;
     using Point3F = Point<float, 3>;
 
+    using Point2R = Point<RealType, 2>;
+    using Vec3R   = Vec<RealType, 3>;
+    using Point3R = Point<RealType, 3>;
+
 
     // extern template float Dot( const Vec3F& u, const Vec3F& v );
     // extern template Vec3F Cross( const Vec3F& u, const Vec3F& v );
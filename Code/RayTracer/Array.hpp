@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Common.hpp"
+#include "Simd.hpp"
 
 namespace RayTracer
 {
@@ -38,6 +39,57 @@ namespace RayTracer
             }
     };
 
+    // Whether Array<T, Dimension> is padded to a Simd<T, 4>, see RAYTRACER_PADDED_ARRAY3.
+    template <typename T, SizeType Dimension>
+    inline constexpr bool isPaddedArray = false;
+
+// Three component arrays of the scalars with a native four lane Simd are padded to four lanes and aligned to them, so
+// that Vec and Point operate on them with one Simd<T, 4> per operation (see Algebra.hpp). Default initialized arrays
+// are zero, so the fourth lane never holds garbage, the operations keep it at zero for finite operands, and reductions
+// such as Dot ignore it.
+#define RAYTRACER_PADDED_ARRAY3( T )                                    \
+    template <>                                                         \
+    struct Array<T, 3>                                                  \
+    {                                                                   \
+            alignas( 4 * sizeof( T ) ) T data[ 4 ] { };                 \
+                                                                        \
+            const T& operator[]( const SizeType& i ) const              \
+            {                                                           \
+                return data[ i ];                                       \
+            }                                                           \
+                                                                        \
+            T& operator[]( const SizeType& i )                          \
+            {                                                           \
+                return data[ i ];                                       \
+            }                                                           \
+                                                                        \
+            constexpr SizeType GetDimension( )                          \
+            {                                                           \
+                return 3;                                               \
+            }                                                           \
+                                                                        \
+            const T* GetData( ) const                                   \
+            {                                                           \
+                return data;                                            \
+            }                                                           \
+                                                                        \
+            T* GetData( )                                               \
+            {                                                           \
+                return data;                                            \
+            }                                                           \
+    };                                                                  \
+                                                                        \
+    template <>                                                         \
+    inline constexpr bool isPaddedArray<T, 3> = true;
+
+#if defined( RAYTRACER_SIMD_SSE2 )
+    RAYTRACER_PADDED_ARRAY3( float )
+#endif
+
+#if defined( RAYTRACER_SIMD_AVX )
+    RAYTRACER_PADDED_ARRAY3( double )
+#endif
+
 #define RAYTRACER_INSTANTIATE_ARRAY( T, Dimension ) template class Array<T, Dimension>;
 #define RAYTRACER_EXTERNALIZE_ARRAY( T, Dimension ) extern RAYTRACER_INSTANTIATE_ARRAY( T, Dimension )
 
@@ -0,0 +1,787 @@
+#include "Bvh.hpp"
+
+#include "omp.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+
+namespace RayTracer
+{
+
+    namespace
+    {
+        constexpr SizeType sahBinCount      = 16;
+        constexpr double   sahTraversalCost = 0.5; // Relative to the cost of intersecting one primitive.
+
+        // Past this depth nodes are split at the object median, which bounds the total depth and thus the traversal stack.
+        constexpr SizeType maxSahDepth        = 32;
+
+        constexpr SizeType mortonBitsPerAxis = 21;
+
+        struct SahBin
+        {
+                AabbR    boundingBox;
+                SizeType count = 0;
+        };
+
+        struct MortonPrimitive
+        {
+                uint64_t code;
+                uint32_t index;
+        };
+
+        // Spreads the lower 21 bits of v so that there are two zero bits between each of them.
+        uint64_t SpreadBitsBy3( uint64_t v )
+        {
+            v &= 0x1fffff;
+            v  = ( v | v << 32 ) & 0x1f00000000ffff;
+            v  = ( v | v << 16 ) & 0x1f0000ff0000ff;
+            v  = ( v | v << 8 ) & 0x100f00f00f00f00f;
+            v  = ( v | v << 4 ) & 0x10c30c30c30c30c3;
+            v  = ( v | v << 2 ) & 0x1249249249249249;
+
+            return v;
+        }
+
+        // Parallel least significant digit radix sort, eight bits per pass. Each thread counts and then scatters its own
+        // contiguous chunk, so the sort is stable and needs no atomics.
+        void RadixSort( std::vector<MortonPrimitive>& items )
+        {
+            constexpr int                bucketCount = 256;
+            const int                    itemCount   = int( items.size( ) );
+
+            std::vector<MortonPrimitive> buffer( items.size( ) );
+            std::vector<SizeType>        offsets;
+
+            for ( int shift = 0; shift < 64; shift += 8 )
+            {
+                bool skipPass = false;
+
+#pragma omp parallel
+                {
+                    const int threadCount = omp_get_num_threads( );
+                    const int thread      = omp_get_thread_num( );
+                    const int begin       = int( int64_t( itemCount ) * thread / threadCount );
+                    const int end         = int( int64_t( itemCount ) * ( thread + 1 ) / threadCount );
+
+#pragma omp single
+                    {
+                        offsets.assign( SizeType( threadCount ) * bucketCount, 0 );
+                    }
+
+                    SizeType* threadOffsets = &offsets[ SizeType( thread ) * bucketCount ];
+
+                    for ( int i = begin; i < end; i++ )
+                    {
+                        threadOffsets[ ( items[ i ].code >> shift ) & ( bucketCount - 1 ) ]++;
+                    }
+
+#pragma omp barrier
+
+#pragma omp single
+                    {
+                        SizeType offset = 0;
+
+                        for ( int bucket = 0; bucket < bucketCount; bucket++ )
+                        {
+                            SizeType bucketBegin = offset;
+
+                            for ( int t = 0; t < threadCount; t++ )
+                            {
+                                SizeType count                                    = offsets[ SizeType( t ) * bucketCount + bucket ];
+                                offsets[ SizeType( t ) * bucketCount + bucket ] = offset;
+                                offset                                           += count;
+                            }
+
+                            // All keys share this digit, the pass would not move anything.
+                            skipPass = skipPass || ( offset - bucketBegin == SizeType( itemCount ) );
+                        }
+                    }
+
+                    if ( !skipPass )
+                    {
+                        for ( int i = begin; i < end; i++ )
+                        {
+                            buffer[ threadOffsets[ ( items[ i ].code >> shift ) & ( bucketCount - 1 ) ]++ ] = items[ i ];
+                        }
+                    }
+                }
+
+                if ( !skipPass )
+                {
+                    items.swap( buffer );
+                }
+            }
+        }
+
+        // Binary radix tree node of Karras' construction. Internal node i always has primitive i as one end of its range
+        // and the root is node 0.
+        struct LbvhNode
+        {
+                uint32_t first;
+                uint32_t last;
+                uint32_t children[ 2 ];
+                bool     childIsLeaf[ 2 ];
+                uint32_t parent;
+                uint16_t splitAxis;
+        };
+
+        // Writes a radix tree into the depth first node layout of Bvh, collapsing subtrees that are small enough into leaves.
+        struct LbvhEmitter
+        {
+                struct Task
+                {
+                        uint32_t index;
+                        bool     isLeaf;
+                        uint32_t outputIndex;
+                };
+
+                const std::vector<LbvhNode>&  lbvhNodes;
+                const std::vector<AabbR>&     internalBoxes;
+                const std::vector<uint32_t>&  internalNodeCounts;
+                const std::vector<AabbR>&     leafBoxes;
+                SizeType                      maxPrimitivesInLeaf;
+                std::vector<Bvh::Node>&       nodes;
+
+                uint32_t                      GetNodeCount( uint32_t index, bool isLeaf ) const
+                {
+                    return isLeaf ? 1 : internalNodeCounts[ index ];
+                }
+
+                bool IsExpandable( const Task& task ) const
+                {
+                    return !task.isLeaf && lbvhNodes[ task.index ].last - lbvhNodes[ task.index ].first + 1 > maxPrimitivesInLeaf;
+                }
+
+                // Writes the node of the task and returns the tasks of its two children if it is an interior node.
+                bool EmitNode( const Task& task, Task childTasks[ 2 ] ) const
+                {
+                    if ( task.isLeaf )
+                    {
+                        nodes[ task.outputIndex ] = Bvh::Node { leafBoxes[ task.index ], task.index, 1, 0 };
+                        return false;
+                    }
+
+                    const LbvhNode& node = lbvhNodes[ task.index ];
+
+                    if ( !IsExpandable( task ) )
+                    {
+                        nodes[ task.outputIndex ] = Bvh::Node { internalBoxes[ task.index ], node.first, uint16_t( node.last - node.first + 1 ), 0 };
+                        return false;
+                    }
+
+                    uint32_t firstChildOutputIndex  = task.outputIndex + 1;
+                    uint32_t secondChildOutputIndex = firstChildOutputIndex + GetNodeCount( node.children[ 0 ], node.childIsLeaf[ 0 ] );
+
+                    nodes[ task.outputIndex ]       = Bvh::Node { internalBoxes[ task.index ], secondChildOutputIndex, 0, node.splitAxis };
+                    childTasks[ 0 ]                 = Task { node.children[ 0 ], node.childIsLeaf[ 0 ], firstChildOutputIndex };
+                    childTasks[ 1 ]                 = Task { node.children[ 1 ], node.childIsLeaf[ 1 ], secondChildOutputIndex };
+
+                    return true;
+                }
+
+                void Emit( const Task& task ) const
+                {
+                    Task childTasks[ 2 ];
+
+                    if ( EmitNode( task, childTasks ) )
+                    {
+                        Emit( childTasks[ 0 ] );
+                        Emit( childTasks[ 1 ] );
+                    }
+                }
+        };
+    } // namespace
+
+    struct Bvh::BuildPrimitive
+    {
+            AabbR    boundingBox;
+            Point3R  centroid;
+            uint32_t index;
+    };
+
+    Bvh::Bvh( const HittableList& list, BuildMethod buildMethod, SizeType maxPrimitivesInLeaf ) :
+        maxPrimitivesInLeaf( std::clamp( maxPrimitivesInLeaf, SizeType( 1 ), SizeType( std::numeric_limits<uint16_t>::max( ) ) ) )
+    {
+        if ( list.objects.empty( ) )
+        {
+            return;
+        }
+
+        const int                   primitiveCount = int( list.objects.size( ) );
+        std::vector<BuildPrimitive> buildPrimitives( primitiveCount );
+
+#pragma omp parallel for
+        for ( int i = 0; i < primitiveCount; i++ )
+        {
+            buildPrimitives[ i ].boundingBox = list.objects[ i ]->GetBoundingBox( );
+            buildPrimitives[ i ].centroid    = buildPrimitives[ i ].boundingBox.GetCentroid( );
+            buildPrimitives[ i ].index       = uint32_t( i );
+        }
+
+        Build( buildPrimitives, buildMethod );
+
+        primitives.resize( buildPrimitives.size( ) );
+
+#pragma omp parallel for
+        for ( int i = 0; i < primitiveCount; i++ )
+        {
+            primitives[ i ] = list.objects[ buildPrimitives[ i ].index ];
+        }
+    }
+
+    Bvh::Bvh( const std::vector<AabbR>& boundingBoxes, std::vector<uint32_t>& primitiveOrder, BuildMethod buildMethod, SizeType maxPrimitivesInLeaf ) :
+        maxPrimitivesInLeaf( std::clamp( maxPrimitivesInLeaf, SizeType( 1 ), SizeType( std::numeric_limits<uint16_t>::max( ) ) ) )
+    {
+        primitiveOrder.clear( );
+
+        if ( boundingBoxes.empty( ) )
+        {
+            return;
+        }
+
+        const int                   primitiveCount = int( boundingBoxes.size( ) );
+        std::vector<BuildPrimitive> buildPrimitives( primitiveCount );
+
+#pragma omp parallel for
+        for ( int i = 0; i < primitiveCount; i++ )
+        {
+            buildPrimitives[ i ].boundingBox = boundingBoxes[ i ];
+            buildPrimitives[ i ].centroid    = boundingBoxes[ i ].GetCentroid( );
+            buildPrimitives[ i ].index       = uint32_t( i );
+        }
+
+        Build( buildPrimitives, buildMethod );
+
+        primitiveOrder.resize( buildPrimitives.size( ) );
+
+#pragma omp parallel for
+        for ( int i = 0; i < primitiveCount; i++ )
+        {
+            primitiveOrder[ i ] = buildPrimitives[ i ].index;
+        }
+    }
+
+    void Bvh::Build( std::vector<BuildPrimitive>& buildPrimitives, BuildMethod buildMethod )
+    {
+        if ( buildMethod == BuildMethod::Lbvh )
+        {
+            BuildLbvh( buildPrimitives );
+        }
+        else
+        {
+            nodes.reserve( 2 * buildPrimitives.size( ) );
+            BuildSahNode( buildPrimitives, 0, buildPrimitives.size( ), 0 );
+            nodes.shrink_to_fit( );
+        }
+    }
+
+    uint32_t Bvh::BuildSahNode( std::vector<BuildPrimitive>& buildPrimitives, SizeType begin, SizeType end, SizeType depth )
+    {
+        uint32_t nodeIndex = uint32_t( nodes.size( ) );
+        nodes.emplace_back( );
+
+        AabbR boundingBox;
+        AabbR centroidBoundingBox;
+
+        for ( SizeType i = begin; i < end; i++ )
+        {
+            boundingBox.Expand( buildPrimitives[ i ].boundingBox );
+            centroidBoundingBox.Expand( buildPrimitives[ i ].centroid );
+        }
+
+        SizeType count = end - begin;
+
+        auto     makeLeaf = [ this, nodeIndex, &boundingBox, begin, count ]( )
+        {
+            nodes[ nodeIndex ] = Node { boundingBox, uint32_t( begin ), uint16_t( count ), 0 };
+            return nodeIndex;
+        };
+
+        if ( count == 1 )
+        {
+            return makeLeaf( );
+        }
+
+        SizeType axis   = centroidBoundingBox.GetLongestAxis( );
+        Vec3R    extent = centroidBoundingBox.GetExtent( );
+        SizeType middle = begin + count / 2;
+
+        if ( extent[ axis ] <= 0.0 )
+        {
+            // All centroids coincide, no split can separate them.
+            if ( count <= maxPrimitivesInLeaf )
+            {
+                return makeLeaf( );
+            }
+        }
+        else if ( depth >= maxSahDepth )
+        {
+            std::nth_element( buildPrimitives.begin( ) + begin, buildPrimitives.begin( ) + middle, buildPrimitives.begin( ) + end,
+                              [ axis ]( const BuildPrimitive& a, const BuildPrimitive& b )
+                              {
+                                  return a.centroid[ axis ] < b.centroid[ axis ];
+                              } );
+        }
+        else
+        {
+            double   bestCost  = std::numeric_limits<double>::infinity( );
+            SizeType bestAxis  = axis;
+            SizeType bestSplit = 0;
+
+            for ( SizeType candidateAxis = 0; candidateAxis < 3; candidateAxis++ )
+            {
+                if ( extent[ candidateAxis ] <= 0.0 )
+                {
+                    continue;
+                }
+
+                SahBin bins[ sahBinCount ];
+                double scale = double( sahBinCount ) / extent[ candidateAxis ];
+
+                for ( SizeType i = begin; i < end; i++ )
+                {
+                    SizeType b = std::min( sahBinCount - 1, SizeType( ( buildPrimitives[ i ].centroid[ candidateAxis ] - centroidBoundingBox.GetMin( )[ candidateAxis ] ) * scale ) );
+                    bins[ b ].count++;
+                    bins[ b ].boundingBox.Expand( buildPrimitives[ i ].boundingBox );
+                }
+
+                // Sweep from the right to get the cost contribution of every right hand side, then from the left to combine.
+                double   rightCost[ sahBinCount - 1 ];
+                AabbR    rightBox;
+                SizeType rightCount = 0;
+
+                for ( SizeType b = sahBinCount - 1; b > 0; b-- )
+                {
+                    rightBox.Expand( bins[ b ].boundingBox );
+                    rightCount       += bins[ b ].count;
+                    rightCost[ b - 1 ] = double( rightCount ) * rightBox.GetSurfaceArea( );
+                }
+
+                AabbR    leftBox;
+                SizeType leftCount = 0;
+
+                for ( SizeType b = 0; b < sahBinCount - 1; b++ )
+                {
+                    leftBox.Expand( bins[ b ].boundingBox );
+                    leftCount += bins[ b ].count;
+
+                    if ( leftCount == 0 || leftCount == count )
+                    {
+                        continue;
+                    }
+
+                    double cost = double( leftCount ) * leftBox.GetSurfaceArea( ) + rightCost[ b ];
+
+                    if ( cost < bestCost )
+                    {
+                        bestCost  = cost;
+                        bestAxis  = candidateAxis;
+                        bestSplit = b;
+                    }
+                }
+            }
+
+            bestCost        = sahTraversalCost + bestCost / boundingBox.GetSurfaceArea( );
+            double leafCost = double( count );
+
+            if ( count <= maxPrimitivesInLeaf && leafCost <= bestCost )
+            {
+                return makeLeaf( );
+            }
+
+            axis         = bestAxis;
+            double scale = double( sahBinCount ) / extent[ axis ];
+            double from  = centroidBoundingBox.GetMin( )[ axis ];
+
+            auto   split = std::partition( buildPrimitives.begin( ) + begin, buildPrimitives.begin( ) + end,
+                                           [ axis, scale, from, bestSplit ]( const BuildPrimitive& p )
+                                           {
+                                             return std::min( sahBinCount - 1, SizeType( ( p.centroid[ axis ] - from ) * scale ) ) <= bestSplit;
+                                           } );
+
+            middle       = SizeType( split - buildPrimitives.begin( ) );
+
+            if ( middle == begin || middle == end )
+            {
+                middle = begin + count / 2;
+            }
+        }
+
+        BuildSahNode( buildPrimitives, begin, middle, depth + 1 );
+        uint32_t secondChild = BuildSahNode( buildPrimitives, middle, end, depth + 1 );
+
+        nodes[ nodeIndex ]   = Node { boundingBox, secondChild, 0, uint16_t( axis ) };
+
+        return nodeIndex;
+    }
+
+    void Bvh::BuildLbvh( std::vector<BuildPrimitive>& buildPrimitives )
+    {
+        const int primitiveCount = int( buildPrimitives.size( ) );
+
+        // Centroid bounds, reduced per thread.
+        std::vector<AabbR> threadCentroidBoxes( omp_get_max_threads( ) );
+
+#pragma omp parallel
+        {
+            AabbR& centroidBox = threadCentroidBoxes[ omp_get_thread_num( ) ];
+
+#pragma omp for
+            for ( int i = 0; i < primitiveCount; i++ )
+            {
+                centroidBox.Expand( buildPrimitives[ i ].centroid );
+            }
+        }
+
+        AabbR centroidBoundingBox;
+
+        for ( const auto& box : threadCentroidBoxes )
+        {
+            centroidBoundingBox.Expand( box );
+        }
+
+        // Morton codes of the centroids quantized to 21 bits per axis, then sorted.
+        std::vector<MortonPrimitive> mortonPrimitives( primitiveCount );
+
+        const double                 quantizationSteps = double( ( 1 << mortonBitsPerAxis ) - 1 );
+        double                       scale[ 3 ];
+
+        for ( SizeType axis = 0; axis < 3; axis++ )
+        {
+            double extent = centroidBoundingBox.GetMax( )[ axis ] - centroidBoundingBox.GetMin( )[ axis ];
+            scale[ axis ] = extent > 0.0 ? quantizationSteps / extent : 0.0;
+        }
+
+#pragma omp parallel for
+        for ( int i = 0; i < primitiveCount; i++ )
+        {
+            uint64_t quantized[ 3 ];
+
+            for ( SizeType axis = 0; axis < 3; axis++ )
+            {
+                quantized[ axis ] = uint64_t( ( buildPrimitives[ i ].centroid[ axis ] - centroidBoundingBox.GetMin( )[ axis ] ) * scale[ axis ] );
+            }
+
+            mortonPrimitives[ i ] = MortonPrimitive { SpreadBitsBy3( quantized[ 0 ] ) << 2 | SpreadBitsBy3( quantized[ 1 ] ) << 1 | SpreadBitsBy3( quantized[ 2 ] ), uint32_t( i ) };
+        }
+
+        RadixSort( mortonPrimitives );
+
+        std::vector<BuildPrimitive> sortedBuildPrimitives( primitiveCount );
+        std::vector<AabbR>          leafBoxes( primitiveCount );
+
+#pragma omp parallel for
+        for ( int i = 0; i < primitiveCount; i++ )
+        {
+            sortedBuildPrimitives[ i ] = buildPrimitives[ mortonPrimitives[ i ].index ];
+            leafBoxes[ i ]             = sortedBuildPrimitives[ i ].boundingBox;
+        }
+
+        buildPrimitives.swap( sortedBuildPrimitives );
+
+        if ( primitiveCount == 1 )
+        {
+            nodes.assign( 1, Node { leafBoxes[ 0 ], 0, 1, 0 } );
+            return;
+        }
+
+        // Radix tree construction (Karras 2012). Every internal node is found independently of the others.
+        const int             internalCount = primitiveCount - 1;
+        std::vector<LbvhNode> lbvhNodes( internalCount );
+        std::vector<uint32_t> leafParents( primitiveCount );
+
+        auto                  commonPrefixLength = [ &mortonPrimitives, primitiveCount ]( int64_t i, int64_t j )
+        {
+            if ( j < 0 || j >= primitiveCount )
+            {
+                return -1;
+            }
+
+            uint64_t a = mortonPrimitives[ i ].code;
+            uint64_t b = mortonPrimitives[ j ].code;
+
+            // Duplicate codes are disambiguated by their position in the sorted order.
+            return a == b ? 64 + std::countl_zero( uint32_t( i ^ j ) ) : std::countl_zero( a ^ b );
+        };
+
+#pragma omp parallel for
+        for ( int i = 0; i < internalCount; i++ )
+        {
+            const int64_t direction       = commonPrefixLength( i, i + 1 ) - commonPrefixLength( i, i - 1 ) > 0 ? 1 : -1;
+            const int     minPrefixLength = commonPrefixLength( i, i - direction );
+
+            int64_t       maxLength       = 2;
+
+            while ( commonPrefixLength( i, i + maxLength * direction ) > minPrefixLength )
+            {
+                maxLength *= 2;
+            }
+
+            int64_t length = 0;
+
+            for ( int64_t step = maxLength / 2; step >= 1; step /= 2 )
+            {
+                if ( commonPrefixLength( i, i + ( length + step ) * direction ) > minPrefixLength )
+                {
+                    length += step;
+                }
+            }
+
+            const int64_t j            = i + length * direction;
+            const int     prefixLength = commonPrefixLength( i, j );
+
+            int64_t       split        = 0;
+            int64_t       step         = length;
+
+            do
+            {
+                step = ( step + 1 ) >> 1;
+
+                if ( commonPrefixLength( i, i + ( split + step ) * direction ) > prefixLength )
+                {
+                    split += step;
+                }
+            } while ( step > 1 );
+
+            const int64_t gamma = i + split * direction + std::min<int64_t>( direction, 0 );
+
+            LbvhNode&     node  = lbvhNodes[ i ];
+            node.first          = uint32_t( std::min<int64_t>( i, j ) );
+            node.last           = uint32_t( std::max<int64_t>( i, j ) );
+            node.children[ 0 ]  = uint32_t( gamma );
+            node.children[ 1 ]  = uint32_t( gamma + 1 );
+            node.childIsLeaf[ 0 ] = node.first == gamma;
+            node.childIsLeaf[ 1 ] = node.last == gamma + 1;
+
+            // The highest differing bit of the range tells which axis the Morton order was split along.
+            uint64_t differingBits = mortonPrimitives[ node.first ].code ^ mortonPrimitives[ node.last ].code;
+            node.splitAxis         = differingBits == 0 ? 0 : uint16_t( 2 - ( 63 - std::countl_zero( differingBits ) ) % 3 );
+
+            for ( SizeType c = 0; c < 2; c++ )
+            {
+                if ( node.childIsLeaf[ c ] )
+                {
+                    leafParents[ node.children[ c ] ] = uint32_t( i );
+                }
+                else
+                {
+                    lbvhNodes[ node.children[ c ] ].parent = uint32_t( i );
+                }
+            }
+        }
+
+        // Bounding boxes and output node counts, bottom up. The second thread to arrive at a node has both children ready.
+        std::vector<AabbR>                 internalBoxes( internalCount );
+        std::vector<uint32_t>              internalNodeCounts( internalCount );
+        std::vector<std::atomic<uint32_t>> visitCounts( internalCount );
+
+#pragma omp parallel for
+        for ( int i = 0; i < primitiveCount; i++ )
+        {
+            uint32_t current = leafParents[ i ];
+
+            while ( visitCounts[ current ].fetch_add( 1, std::memory_order_acq_rel ) == 1 )
+            {
+                const LbvhNode& node      = lbvhNodes[ current ];
+                AabbR           box;
+                uint32_t        nodeCount = 1;
+
+                for ( SizeType c = 0; c < 2; c++ )
+                {
+                    box.Expand( node.childIsLeaf[ c ] ? leafBoxes[ node.children[ c ] ] : internalBoxes[ node.children[ c ] ] );
+                    nodeCount += node.childIsLeaf[ c ] ? 1 : internalNodeCounts[ node.children[ c ] ];
+                }
+
+                internalBoxes[ current ]      = box;
+                internalNodeCounts[ current ] = node.last - node.first + 1 <= maxPrimitivesInLeaf ? 1 : nodeCount;
+
+                if ( current == 0 )
+                {
+                    break;
+                }
+
+                current = node.parent;
+            }
+        }
+
+        // Emission: the top of the tree is expanded serially until there are enough independent subtrees to emit in parallel.
+        nodes.resize( internalNodeCounts[ 0 ] );
+
+        LbvhEmitter                    emitter { lbvhNodes, internalBoxes, internalNodeCounts, leafBoxes, maxPrimitivesInLeaf, nodes };
+
+        std::vector<LbvhEmitter::Task> tasks { LbvhEmitter::Task { 0, false, 0 } };
+        const SizeType                 targetTaskCount = 8 * SizeType( omp_get_max_threads( ) );
+
+        while ( tasks.size( ) < targetTaskCount )
+        {
+            std::vector<LbvhEmitter::Task> nextTasks;
+            bool                           expanded = false;
+
+            for ( const auto& task : tasks )
+            {
+                LbvhEmitter::Task childTasks[ 2 ];
+
+                if ( emitter.IsExpandable( task ) && emitter.EmitNode( task, childTasks ) )
+                {
+                    nextTasks.push_back( childTasks[ 0 ] );
+                    nextTasks.push_back( childTasks[ 1 ] );
+                    expanded = true;
+                }
+                else
+                {
+                    nextTasks.push_back( task );
+                }
+            }
+
+            tasks.swap( nextTasks );
+
+            if ( !expanded )
+            {
+                break;
+            }
+        }
+
+#pragma omp parallel for schedule( dynamic )
+        for ( int t = 0; t < int( tasks.size( ) ); t++ )
+        {
+            emitter.Emit( tasks[ t ] );
+        }
+    }
+
+    template <bool AnyHit>
+    bool Bvh::Traverse( const RayR& ray, const IntervalR& rayParameterInterval, Intersection& intersection ) const
+    {
+        return TraverseLeaves<AnyHit>( ray, rayParameterInterval,
+                                       [ & ]( uint32_t first, SizeType count, RealType& closest )
+                                       {
+                                           bool hitLeaf = false;
+
+                                           for ( SizeType i = 0; i < count; i++ )
+                                           {
+                                               if constexpr ( AnyHit )
+                                               {
+                                                   if ( primitives[ first + i ]->Occluded( ray, rayParameterInterval ) )
+                                                   {
+                                                       return true;
+                                                   }
+                                               }
+                                               else if ( primitives[ first + i ]->Intersect( ray, IntervalR( rayParameterInterval.GetFrom( ), closest ), intersection ) )
+                                               {
+                                                   hitLeaf = true;
+                                                   closest = intersection.t;
+                                               }
+                                           }
+
+                                           return hitLeaf;
+                                       } );
+    }
+
+    bool Bvh::Intersect( const RayR& ray, const IntervalR& rayParameterInterval, Intersection& intersection ) const
+    {
+        return Traverse<false>( ray, rayParameterInterval, intersection );
+    }
+
+    LaneMask Bvh::IntersectPacket( RayPacket& packet, LaneMask activeMask, Intersection* intersections ) const
+    {
+        if ( nodes.empty( ) || activeMask == 0 )
+        {
+            return 0;
+        }
+
+        struct StackEntry
+        {
+                uint32_t index;
+                LaneMask activeMask;
+        };
+
+        const RayPacketBounds bounds = packet.GetBounds( activeMask );
+
+        RayR                  rays[ RayPacket::Size ];
+        Vec3R                 inverseDirections[ RayPacket::Size ];
+
+        for ( SizeType lane = 0; lane < RayPacket::Size; lane++ )
+        {
+            if ( activeMask & ( 1u << lane ) )
+            {
+                rays[ lane ]              = packet.GetRay( lane );
+                inverseDirections[ lane ] = Vec3R { 1 / packet.directionX[ lane ], 1 / packet.directionY[ lane ], 1 / packet.directionZ[ lane ] };
+            }
+        }
+
+        // Children are visited in the order of the first ray, which suits all of them in a coherent packet.
+        const Vec3R& firstInverseDirection    = inverseDirections[ std::countr_zero( activeMask ) ];
+        bool         directionIsNegative[ 3 ] = { firstInverseDirection[ 0 ] < 0, firstInverseDirection[ 1 ] < 0, firstInverseDirection[ 2 ] < 0 };
+
+        StackEntry   stack[ traversalStackSize ];
+        SizeType     stackSize = 0;
+        StackEntry   current { 0, activeMask };
+
+        LaneMask     hits      = 0;
+
+        while ( true )
+        {
+            const Node&    node     = nodes[ current.index ];
+            PacketCoverage coverage = bounds.Classify( node.boundingBox, packet.GetEarliestEnd( current.activeMask ) );
+            LaneMask       nodeMask = coverage == PacketCoverage::All ? current.activeMask : 0;
+
+            if ( coverage == PacketCoverage::Some )
+            {
+                for ( SizeType lane = 0; lane < RayPacket::Size; lane++ )
+                {
+                    if ( ( current.activeMask & ( 1u << lane ) ) && node.boundingBox.Hit( rays[ lane ], inverseDirections[ lane ], packet.GetInterval( lane ) ) )
+                    {
+                        nodeMask |= 1u << lane;
+                    }
+                }
+            }
+
+            if ( nodeMask != 0 )
+            {
+                if ( !node.IsLeaf( ) )
+                {
+                    if ( directionIsNegative[ node.splitAxis ] )
+                    {
+                        stack[ stackSize++ ] = StackEntry { current.index + 1, nodeMask };
+                        current              = StackEntry { node.offset, nodeMask };
+                    }
+                    else
+                    {
+                        stack[ stackSize++ ] = StackEntry { node.offset, nodeMask };
+                        current              = StackEntry { current.index + 1, nodeMask };
+                    }
+
+                    continue;
+                }
+
+                for ( SizeType i = 0; i < node.primitiveCount; i++ )
+                {
+                    hits |= primitives[ node.offset + i ]->IntersectPacket( packet, nodeMask, intersections );
+                }
+            }
+
+            if ( stackSize == 0 )
+            {
+                break;
+            }
+
+            current = stack[ --stackSize ];
+        }
+
+        return hits;
+    }
+
+    bool Bvh::Occluded( const RayR& ray, const IntervalR& rayParameterInterval ) const
+    {
+        Intersection unused;
+
+        return Traverse<true>( ray, rayParameterInterval, unused );
+    }
+
+    AabbR Bvh::GetBoundingBox( ) const
+    {
+        return nodes.empty( ) ? AabbR( ) : nodes[ 0 ].boundingBox;
+    }
+
+} // namespace RayTracer
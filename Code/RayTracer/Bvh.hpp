@@ -0,0 +1,162 @@
+#pragma once
+
+#include "Aabb.hpp"
+#include "Hittable.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace RayTracer
+{
+
+    // Bounding volume hierarchy over the objects of a HittableList. Nodes are stored depth first in a flat array: the
+    // first child of an interior node immediately follows it and the second child is found through its offset.
+    class Bvh : public Hittable
+    {
+        public:
+
+            enum class BuildMethod
+            {
+                Sah,  // Top down binned surface area heuristic. Best traversal performance.
+                Lbvh, // Morton code sorted linear BVH built in parallel. Fastest to build, for large scenes.
+            };
+
+            struct Node
+            {
+                    AabbR    boundingBox;
+                    uint32_t offset;         // Leaf: index of the first primitive. Interior: index of the second child.
+                    uint16_t primitiveCount; // Zero for interior nodes.
+                    uint16_t splitAxis;
+
+                    bool     IsLeaf( ) const
+                    {
+                        return primitiveCount > 0;
+                    }
+            };
+
+        private:
+
+            struct BuildPrimitive;
+
+            // A linear BVH splits on one bit of the 63 bit Morton code plus 32 bits of primitive index per level at most.
+            static constexpr SizeType            traversalStackSize = 128;
+
+            std::vector<Node>                    nodes;
+            std::vector<SharedPointer<Hittable>> primitives;
+            SizeType                             maxPrimitivesInLeaf = 4;
+
+            // Builds the nodes over buildPrimitives, which it leaves in leaf order.
+            void                                 Build( std::vector<BuildPrimitive>& buildPrimitives, BuildMethod buildMethod );
+
+            uint32_t                             BuildSahNode( std::vector<BuildPrimitive>& buildPrimitives, SizeType begin, SizeType end, SizeType depth );
+
+            void                                 BuildLbvh( std::vector<BuildPrimitive>& buildPrimitives );
+
+            // Shared by Intersect and Occluded. With AnyHit, traversal stops at the first primitive hit.
+            template <bool AnyHit>
+            bool                                 Traverse( const RayR& ray, const IntervalR& rayParameterInterval, Intersection& intersection ) const;
+
+        public:
+
+            Bvh( )
+            {
+            }
+
+            Bvh( const HittableList& list, BuildMethod buildMethod = BuildMethod::Sah, SizeType maxPrimitivesInLeaf = 4 );
+
+            // Tree over primitives that its owner stores itself, given by their bounding boxes. The tree holds no
+            // primitives: primitiveOrder receives the index of the box of every leaf entry, in leaf order, and the owner
+            // reorders its primitives to match and intersects them through TraverseLeaves.
+            Bvh( const std::vector<AabbR>& boundingBoxes, std::vector<uint32_t>& primitiveOrder, BuildMethod buildMethod = BuildMethod::Sah, SizeType maxPrimitivesInLeaf = 4 );
+
+            // Visits the leaves hit by the ray, nearer first, as intersectLeaf( first, count, closest ), which returns
+            // whether one of the count primitives from first is hit before closest and then lowers closest to the hit.
+            // With AnyHit, traversal stops at the first leaf that returns true.
+            template <bool AnyHit, class LeafFunction>
+            bool                                        TraverseLeaves( const RayR& ray, const IntervalR& rayParameterInterval, LeafFunction&& intersectLeaf ) const;
+
+            bool                                        Intersect( const RayR& ray, const IntervalR& rayParameterInterval, Intersection& intersection ) const override;
+
+            // Traverses the tree once for the whole packet, carrying the mask of the lanes that hit each node.
+            LaneMask                                    IntersectPacket( RayPacket& packet, LaneMask activeMask, Intersection* intersections ) const override;
+
+            bool                                        Occluded( const RayR& ray, const IntervalR& rayParameterInterval ) const override;
+
+            AabbR                                       GetBoundingBox( ) const override;
+
+            const std::vector<Node>&                    GetNodes( ) const
+            {
+                return nodes;
+            }
+
+            const std::vector<SharedPointer<Hittable>>& GetPrimitives( ) const
+            {
+                return primitives;
+            }
+    };
+
+    template <bool AnyHit, class LeafFunction>
+    bool Bvh::TraverseLeaves( const RayR& ray, const IntervalR& rayParameterInterval, LeafFunction&& intersectLeaf ) const
+    {
+        if ( nodes.empty( ) )
+        {
+            return false;
+        }
+
+        const Vec3R& direction = ray.GetDirection( );
+        Vec3R        inverseDirection { 1 / direction[ 0 ], 1 / direction[ 1 ], 1 / direction[ 2 ] };
+        bool         directionIsNegative[ 3 ] = { inverseDirection[ 0 ] < 0, inverseDirection[ 1 ] < 0, inverseDirection[ 2 ] < 0 };
+
+        uint32_t     stack[ traversalStackSize ];
+        SizeType     stackSize    = 0;
+        uint32_t     current      = 0;
+
+        bool         hitSomething = false;
+        RealType     closest      = rayParameterInterval.GetTo( );
+
+        while ( true )
+        {
+            const Node& node = nodes[ current ];
+
+            if ( node.boundingBox.Hit( ray, inverseDirection, IntervalR( rayParameterInterval.GetFrom( ), closest ) ) )
+            {
+                if ( !node.IsLeaf( ) )
+                {
+                    // Visit the child nearer to the ray origin first so that closest shrinks as early as possible.
+                    if ( directionIsNegative[ node.splitAxis ] )
+                    {
+                        stack[ stackSize++ ] = current + 1;
+                        current              = node.offset;
+                    }
+                    else
+                    {
+                        stack[ stackSize++ ] = node.offset;
+                        current              = current + 1;
+                    }
+
+                    continue;
+                }
+
+                if ( intersectLeaf( node.offset, SizeType( node.primitiveCount ), closest ) )
+                {
+                    if constexpr ( AnyHit )
+                    {
+                        return true;
+                    }
+
+                    hitSomething = true;
+                }
+            }
+
+            if ( stackSize == 0 )
+            {
+                break;
+            }
+
+            current = stack[ --stackSize ];
+        }
+
+        return hitSomething;
+    }
+
+} // namespace RayTracer
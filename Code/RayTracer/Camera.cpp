@@ -1,11 +1,35 @@
 #include "Camera.hpp"
-#include "Material.hpp"
 
 #include "omp.h"
 
+#include <variant>
+
 namespace RayTracer
 {
-    Camera::Camera( const double& focalLength, const double& verticalFieldOfViewInDegrees ) :
+
+    namespace
+    {
+        // Power heuristic with exponent 2 (Veach 1997), the weight of the strategy with density pdf.
+        RealType PowerHeuristic( RealType pdf, RealType otherPdf )
+        {
+            return pdf * pdf / ( pdf * pdf + otherPdf * otherPdf );
+        }
+
+        // Fraction of the way to a light sample by which shadow rays stop short of it. The sample and the intersection of
+        // the shadow ray with the light are rounded differently, most of all for directions that graze the light, and
+        // without the margin lights shadow themselves.
+        constexpr RealType shadowEpsilon = RealType( 1e-4 );
+
+        // Light of the sky seen by rays that leave the scene.
+        RgbR SkyColor( const RayR& ray )
+        {
+            RealType a = RealType( 0.5 ) * ( Normalize( ray.GetDirection( ) ).y( ) + 1 );
+
+            return ( 1 - a ) * RgbR( 1.0, 1.0, 1.0 ) + a * RgbR( 0.5, 0.7, 1.0 );
+        }
+    } // namespace
+
+    Camera::Camera( const RealType& focalLength, const RealType& verticalFieldOfViewInDegrees ) :
         focalLength( focalLength ),
         verticalFieldOfViewInDegrees( verticalFieldOfViewInDegrees ),
         center { 0.0, 0.0, 0.0 },
@@ -14,115 +38,710 @@ namespace RayTracer
     {
     }
 
-    void Camera::CalculateViewportParameters( double windowWidth, double windowHeight )
+    void Camera::CalculateViewportParameters( RealType windowWidth, RealType windowHeight )
     {
-        double aspectRatio      = double( windowWidth ) / windowHeight;
-        double theta            = DegreesToRadians( verticalFieldOfViewInDegrees );
-        double h                = std::tan( theta / 2 );
-        double viewportHeight   = 2.0 * h * focalLength;
-        double viewportWidth    = viewportHeight * aspectRatio;
+        RealType aspectRatio    = windowWidth / windowHeight;
+        RealType theta          = DegreesToRadians( verticalFieldOfViewInDegrees );
+        RealType h              = std::tan( theta / 2 );
+        RealType viewportHeight = 2 * h * focalLength;
+        RealType viewportWidth  = viewportHeight * aspectRatio;
 
-        Vec3D  w                = Normalize( center - lookAt );
-        Vec3D  u                = Normalize( Cross( upVector, w ) );
-        Vec3D  v                = Cross( w, u );
+        Vec3R    w              = Normalize( center - lookAt );
+        Vec3R    u              = Normalize( Cross( upVector, w ) );
+        Vec3R    v              = Cross( w, u );
 
-        Vec3D  viewportU        = viewportWidth * u;
-        Vec3D  viewportV        = -(viewportHeight)*v;
+        Vec3R    viewportU      = viewportWidth * u;
+        Vec3R    viewportV      = -(viewportHeight)*v;
 
-        pixelDeltaU             = viewportU / double( windowWidth );
-        pixelDeltaV             = viewportV / double( windowHeight );
+        pixelDeltaU             = viewportU / windowWidth;
+        pixelDeltaV             = viewportV / windowHeight;
 
-        Point3D viewportTopLeft = center - ( focalLength * w ) - viewportU / 2.0 - viewportV / 2.0;
+        Point3R viewportTopLeft = center - ( focalLength * w ) - viewportU / RealType( 2 ) - viewportV / RealType( 2 );
 
-        topLeftPixelLocation    = viewportTopLeft + ( pixelDeltaU + pixelDeltaV ) / 2.0;
+        topLeftPixelLocation    = viewportTopLeft + ( pixelDeltaU + pixelDeltaV ) / RealType( 2 );
     }
 
-    RayD Camera::CreateRandomRayAt( const SizeType& i, const SizeType& j )
+    RayR Camera::CreateRandomRayAt( const SizeType& i, const SizeType& j, Sampler& sampler ) const
     {
-        RealType xOffset                = RandomReal<RealType>( ) - 0.5;
-        RealType yOffset                = RandomReal<RealType>( ) - 0.5;
+        Point2R  pixelSample            = sampler.Get2D( );
+        RealType xOffset                = pixelSample[ 0 ] - RealType( 0.5 );
+        RealType yOffset                = pixelSample[ 1 ] - RealType( 0.5 );
 
-        Point3D pertrubedPixelLocation = topLeftPixelLocation + ( ( i + xOffset ) * pixelDeltaU ) + ( ( j + yOffset ) * pixelDeltaV );
-        Vec3D   rayDirection           = pertrubedPixelLocation - center;
+        Point3R pertrubedPixelLocation = topLeftPixelLocation + ( ( RealType( i ) + xOffset ) * pixelDeltaU ) + ( ( RealType( j ) + yOffset ) * pixelDeltaV );
+        Vec3R   rayDirection           = pertrubedPixelLocation - center;
 
-        return RayD( center, rayDirection );
+        return RayR( center, rayDirection );
     }
 
-    void Camera::Render( const Hittable& world, RgbaImageView8& renderBuffer, SizeType maxBounces, SizeType samplesPerPixel )
+    void Camera::Render( const Hittable& world, const MaterialTable& materials, const LightList& lights, RgbaImageView8& renderBuffer, SizeType maxBounces, SizeType samplesPerPixel )
     {
         CalculateViewportParameters( renderBuffer.GetWidth( ), renderBuffer.GetHeight( ) );
 
-        double summationDivisor = double( samplesPerPixel );
+        // Threads take bands of rows as high as a pixel block.
+        const int bandCount = int( ( renderBuffer.GetHeight( ) + rayPacketHeight - 1 ) / rayPacketHeight );
 
-#pragma omp parallel for
-        for ( int j = 0; j < renderBuffer.GetHeight( ); j++ )
+#pragma omp parallel
         {
-            auto imageRow = renderBuffer.GetRowSpan( j );
+            SharedPointer<Sampler> threadSampler = sampler->Clone( );
 
-            for ( int i = 0; i < renderBuffer.GetWidth( ); i++ )
+#pragma omp for
+            for ( int band = 0; band < bandCount; band++ )
             {
-                RgbD pixelColor( 0, 0, 0 );
+                SizeType y = SizeType( band ) * rayPacketHeight;
+
+                SampleRegion( 0, y, renderBuffer.GetWidth( ), std::min( rayPacketHeight, renderBuffer.GetHeight( ) - y ), world, materials, lights, maxBounces, samplesPerPixel, 0, *threadSampler,
+                              [ &renderBuffer ]( SizeType i, SizeType j, const RgbD& color )
+                              {
+                                  renderBuffer.GetRowSpan( j )[ i ] = ConvertToRgba8( LinearToGamma( color ) );
+                              } );
+            }
+        }
+
+        renderIndex++;
+    }
+
+    void Camera::Accumulate( const Hittable& world, const MaterialTable& materials, const LightList& lights, RgbImageD& accumulationBuffer, SizeType maxBounces, SizeType samplesPerPixel, SizeType firstSampleIndex )
+    {
+        CalculateViewportParameters( accumulationBuffer.GetWidth( ), accumulationBuffer.GetHeight( ) );
 
-                for ( int sample = 0; sample < samplesPerPixel; sample++ )
+        // Passes of the same accumulation share the seed, so that low discrepancy samplers stay stratified across them.
+        if ( firstSampleIndex == 0 )
+        {
+            renderIndex++;
+        }
+
+        const int bandCount = int( ( accumulationBuffer.GetHeight( ) + rayPacketHeight - 1 ) / rayPacketHeight );
+
+#pragma omp parallel
+        {
+            SharedPointer<Sampler> threadSampler = sampler->Clone( );
+
+#pragma omp for
+            for ( int band = 0; band < bandCount; band++ )
+            {
+                SizeType y = SizeType( band ) * rayPacketHeight;
+
+                SampleRegion( 0, y, accumulationBuffer.GetWidth( ), std::min( rayPacketHeight, accumulationBuffer.GetHeight( ) - y ), world, materials, lights, maxBounces, samplesPerPixel, firstSampleIndex, *threadSampler,
+                              [ &accumulationBuffer, samplesPerPixel ]( SizeType i, SizeType j, const RgbD& color )
+                              {
+                                  accumulationBuffer.GetRowSpan( j )[ i ] += double( samplesPerPixel ) * color;
+                              } );
+            }
+        }
+    }
+
+    void Camera::RenderTiled( const Hittable& world, const MaterialTable& materials, const LightList& lights, RgbaImageView8& renderBuffer, SizeType maxBounces, SizeType samplesPerPixel, SizeType tileSize, TileOrder tileOrder )
+    {
+        CalculateViewportParameters( renderBuffer.GetWidth( ), renderBuffer.GetHeight( ) );
+
+        TileScheduler scheduler( renderBuffer.GetWidth( ), renderBuffer.GetHeight( ), tileSize, tileOrder );
+
+        // Threads missing from a smaller team leave their deques to be stolen by the others.
+        scheduler.Distribute( omp_get_max_threads( ) );
+
+#pragma omp parallel
+        {
+            SizeType               worker        = omp_get_thread_num( );
+            Tile                   tile;
+            SharedPointer<Sampler> threadSampler = sampler->Clone( );
+
+            while ( scheduler.Next( worker, tile ) )
+            {
+                SampleRegion( tile.x, tile.y, tile.width, tile.height, world, materials, lights, maxBounces, samplesPerPixel, 0, *threadSampler,
+                              [ &renderBuffer ]( SizeType i, SizeType j, const RgbD& color )
+                              {
+                                  renderBuffer.GetRowSpan( j )[ i ] = ConvertToRgba8( LinearToGamma( color ) );
+                              } );
+            }
+        }
+
+        renderIndex++;
+    }
+
+    SizeType Camera::RenderAdaptive( const Hittable& world, const MaterialTable& materials, const LightList& lights, RgbaImageView8& renderBuffer, SizeType maxBounces, SizeType minSamplesPerPixel, SizeType maxSamplesPerPixel, double maxError, SizeType tileSize )
+    {
+        CalculateViewportParameters( renderBuffer.GetWidth( ), renderBuffer.GetHeight( ) );
+
+        // The cost of a tile depends on how fast its pixels converge, so tiles are balanced by the work stealing scheduler.
+        TileScheduler scheduler( renderBuffer.GetWidth( ), renderBuffer.GetHeight( ), tileSize, TileOrder::Hilbert );
+        scheduler.Distribute( omp_get_max_threads( ) );
+
+        std::vector<SizeType> workerSampleCounts( omp_get_max_threads( ), 0 );
+
+#pragma omp parallel
+        {
+            SizeType               worker        = omp_get_thread_num( );
+            Tile                   tile;
+            SharedPointer<Sampler> threadSampler = sampler->Clone( );
+
+            while ( scheduler.Next( worker, tile ) )
+            {
+                for ( SizeType j = tile.y; j < tile.y + tile.height; j++ )
                 {
-                    RayD ray    = CreateRandomRayAt( i, j );
-                    pixelColor += RayColor( ray, maxBounces, world );
+                    auto imageRow = renderBuffer.GetRowSpan( j );
+
+                    for ( SizeType i = tile.x; i < tile.x + tile.width; i++ )
+                    {
+                        SizeType sampleCount = 0;
+                        imageRow[ i ]        = ConvertToRgba8( LinearToGamma( SamplePixelAdaptive( i, j, world, materials, lights, maxBounces, minSamplesPerPixel, maxSamplesPerPixel, maxError, sampleCount, *threadSampler ) ) );
+
+                        workerSampleCounts[ worker ] += sampleCount;
+                    }
                 }
+            }
+        }
+
+        renderIndex++;
+
+        SizeType totalSampleCount = 0;
+
+        for ( SizeType count : workerSampleCounts )
+        {
+            totalSampleCount += count;
+        }
+
+        return totalSampleCount;
+    }
+
+    RgbD Camera::SamplePixelAdaptive( SizeType i, SizeType j, const Hittable& world, const MaterialTable& materials, const LightList& lights, SizeType maxBounces, SizeType minSamplesPerPixel, SizeType maxSamplesPerPixel, double maxError, SizeType& sampleCount, Sampler& sampler ) const
+    {
+        RgbD pixelColor( 0, 0, 0 );
+
+        // Running mean and sum of squared deviations of the luminance (Welford).
+        double mean          = 0.0;
+        double squaredDeltas = 0.0;
+
+        minSamplesPerPixel   = std::max( minSamplesPerPixel, SizeType( 2 ) );
+        maxSamplesPerPixel   = std::max( maxSamplesPerPixel, minSamplesPerPixel );
+        sampleCount          = 0;
+
+        while ( sampleCount < maxSamplesPerPixel )
+        {
+            SizeType batchEnd = std::min( sampleCount + minSamplesPerPixel, maxSamplesPerPixel );
+
+            for ( ; sampleCount < batchEnd; sampleCount++ )
+            {
+                sampler.StartPixelSample( i, j, sampleCount, renderIndex );
+
+                RayR   ray       = CreateRandomRayAt( i, j, sampler );
+                RgbD   color     = RgbCast<double>( RayColor( ray, maxBounces, world, materials, lights, sampler ) );
+                double luminance = Luminance( color );
+
+                pixelColor      += color;
 
-                imageRow[ i ] = ConvertToRgba8( LinearToGamma( pixelColor / summationDivisor ) );
+                double delta     = luminance - mean;
+                mean            += delta / double( sampleCount + 1 );
+                squaredDeltas   += delta * ( luminance - mean );
+            }
+
+            // A pixel stops no earlier than after two batches, so that one whose first batch missed a rare bright path
+            // (or came back all black) gets a second chance to find it. The error is measured after the gamma curve of
+            // LinearToGamma, where it is visible, so dark pixels get more samples than bright ones with the same noise.
+            if ( sampleCount < 2 * minSamplesPerPixel )
+            {
+                continue;
+            }
+
+            double variance      = squaredDeltas / double( sampleCount - 1 );
+            double standardError = std::sqrt( variance / double( sampleCount ) );
+            double gammaSlope    = std::pow( std::max( mean, 1e-4 ), 1.0 / 2.2 - 1.0 ) / 2.2;
+
+            if ( standardError * gammaSlope <= maxError )
+            {
+                break;
+            }
+        }
+
+        return pixelColor / double( sampleCount );
+    }
+
+    RgbD Camera::SamplePixel( SizeType i, SizeType j, const Hittable& world, const MaterialTable& materials, const LightList& lights, SizeType maxBounces, SizeType samplesPerPixel, SizeType firstSampleIndex, Sampler& sampler ) const
+    {
+        RgbD pixelColor( 0, 0, 0 );
+
+        for ( SizeType sample = firstSampleIndex; sample < firstSampleIndex + samplesPerPixel; sample++ )
+        {
+            // Samples depend on the pixel and sample index only, so the image does not depend on how pixels are
+            // distributed among threads.
+            sampler.StartPixelSample( i, j, sample, renderIndex );
+
+            RayR ray    = CreateRandomRayAt( i, j, sampler );
+            pixelColor += RgbCast<double>( RayColor( ray, maxBounces, world, materials, lights, sampler ) );
+        }
+
+        return pixelColor / double( samplesPerPixel );
+    }
+
+    void Camera::SamplePixelBlock( SizeType i, SizeType j, SizeType width, SizeType height, const Hittable& world, const MaterialTable& materials, const LightList& lights, SizeType maxBounces, SizeType samplesPerPixel, SizeType firstSampleIndex, Sampler& sampler, RgbD* colors ) const
+    {
+        RayPacket    packet;
+        Intersection intersections[ RayPacket::Size ];
+        RayR         rays[ RayPacket::Size ];
+        uint32_t     cameraDimensions[ RayPacket::Size ];
+        LaneMask     activeMask = 0;
+
+        for ( SizeType lane = 0; lane < RayPacket::Size; lane++ )
+        {
+            colors[ lane ] = RgbD( 0, 0, 0 );
+
+            if ( lane % rayPacketWidth < width && lane / rayPacketWidth < height )
+            {
+                activeMask |= 1u << lane;
+            }
+        }
+
+        for ( SizeType sample = firstSampleIndex; sample < firstSampleIndex + samplesPerPixel; sample++ )
+        {
+            for ( SizeType lane = 0; lane < RayPacket::Size; lane++ )
+            {
+                if ( activeMask & ( 1u << lane ) )
+                {
+                    sampler.StartPixelSample( i + lane % rayPacketWidth, j + lane / rayPacketWidth, sample, renderIndex );
+
+                    rays[ lane ]             = CreateRandomRayAt( i + lane % rayPacketWidth, j + lane / rayPacketWidth, sampler );
+                    cameraDimensions[ lane ] = sampler.GetDimension( );
+
+                    packet.SetRay( lane, rays[ lane ], IntervalR( 0, std::numeric_limits<RealType>::infinity( ) ) );
+                }
+            }
+
+            LaneMask hits = world.IntersectPacket( packet, activeMask, intersections );
+
+            // The paths go on one by one. The sampler of each is restarted past the camera sample, so that the path sees
+            // the same numbers as with SamplePixel.
+            for ( SizeType lane = 0; lane < RayPacket::Size; lane++ )
+            {
+                if ( !( activeMask & ( 1u << lane ) ) )
+                {
+                    continue;
+                }
+
+                sampler.StartPixelSample( i + lane % rayPacketWidth, j + lane / rayPacketWidth, sample, renderIndex );
+                sampler.SetDimension( cameraDimensions[ lane ] );
+
+                HitRecord hitRecord;
+                bool      hit = hits & ( 1u << lane );
+
+                if ( hit )
+                {
+                    intersections[ lane ].primitive->FinalizeHit( rays[ lane ], intersections[ lane ], hitRecord );
+                }
+
+                colors[ lane ] += RgbCast<double>( PathColor( rays[ lane ], hit, hitRecord, maxBounces, world, materials, lights, sampler ) );
             }
         }
+
+        for ( SizeType lane = 0; lane < RayPacket::Size; lane++ )
+        {
+            colors[ lane ] /= double( samplesPerPixel );
+        }
     }
 
-    RgbD Camera::RayColor( const RayD& ray, SizeType maxBounces, const Hittable& world ) const
+    template <class Store>
+    void Camera::SampleRegion( SizeType x, SizeType y, SizeType width, SizeType height, const Hittable& world, const MaterialTable& materials, const LightList& lights, SizeType maxBounces, SizeType samplesPerPixel, SizeType firstSampleIndex, Sampler& sampler, Store store ) const
     {
-        if ( maxBounces == 0 )
+        if ( !primaryRayPackets )
+        {
+            for ( SizeType j = y; j < y + height; j++ )
+            {
+                for ( SizeType i = x; i < x + width; i++ )
+                {
+                    store( i, j, SamplePixel( i, j, world, materials, lights, maxBounces, samplesPerPixel, firstSampleIndex, sampler ) );
+                }
+            }
+
+            return;
+        }
+
+        RgbD colors[ RayPacket::Size ];
+
+        for ( SizeType blockY = y; blockY < y + height; blockY += rayPacketHeight )
         {
-            return RgbD( 0, 0, 0 );
+            for ( SizeType blockX = x; blockX < x + width; blockX += rayPacketWidth )
+            {
+                SizeType blockWidth  = std::min( rayPacketWidth, x + width - blockX );
+                SizeType blockHeight = std::min( rayPacketHeight, y + height - blockY );
+
+                SamplePixelBlock( blockX, blockY, blockWidth, blockHeight, world, materials, lights, maxBounces, samplesPerPixel, firstSampleIndex, sampler, colors );
+
+                for ( SizeType lane = 0; lane < RayPacket::Size; lane++ )
+                {
+                    if ( lane % rayPacketWidth < blockWidth && lane / rayPacketWidth < blockHeight )
+                    {
+                        store( blockX + lane % rayPacketWidth, blockY + lane / rayPacketWidth, colors[ lane ] );
+                    }
+                }
+            }
         }
+    }
 
+    RgbR Camera::RayColor( const RayR& ray, SizeType maxBounces, const Hittable& world, const MaterialTable& materials, const LightList& lights, Sampler& sampler ) const
+    {
         HitRecord hitRecord;
 
-        if ( world.Hit( ray, IntervalD( 0.001, std::numeric_limits<double>::infinity( ) ), hitRecord ) )
+        // Rays leave surfaces from origins offset by HitRecord::SpawnRay, so they need no minimum t.
+        bool      hit = world.Hit( ray, IntervalR( 0, std::numeric_limits<RealType>::infinity( ) ), hitRecord );
+
+        return PathColor( ray, hit, hitRecord, maxBounces, world, materials, lights, sampler );
+    }
+
+    RgbR Camera::PathColor( const RayR& primaryRay, bool hit, HitRecord hitRecord, SizeType maxBounces, const Hittable& world, const MaterialTable& materials, const LightList& lights, Sampler& sampler ) const
+    {
+        RayR      ray = primaryRay;
+        PathState state;
+
+        for ( SizeType depth = 0; depth < maxBounces; depth++ )
         {
-            RayD scatteredRay;
-            RgbD attenuation;
+            if ( depth > 0 )
+            {
+                hit = world.Hit( ray, IntervalR( 0, std::numeric_limits<RealType>::infinity( ) ), hitRecord );
+            }
+
+            if ( !hit )
+            {
+                return state.radiance + state.throughput * SkyColor( ray );
+            }
+
+            ShadowRay shadowRay;
+            bool      continues = ShadeHit( ray, hitRecord, depth, materials, lights, sampler, state, shadowRay );
+
+            if ( shadowRay.isValid && !world.Occluded( shadowRay.ray, IntervalR( 0, 1 - shadowEpsilon ) ) )
+            {
+                state.radiance += shadowRay.contribution;
+            }
+
+            if ( !continues )
+            {
+                break;
+            }
+        }
+
+        return state.radiance;
+    }
+
+    bool Camera::ShadeHit( RayR& ray, const HitRecord& hitRecord, SizeType depth, const MaterialTable& materials, const LightList& lights, Sampler& sampler, PathState& state, ShadowRay& shadowRay ) const
+    {
+        // Lights reached after a diffuse bounce were also sampled directly, so both estimates are combined with multiple
+        // importance sampling. Emitters that are not in lights have a light density of 0, and so keep their full weight.
+        RgbR emitted = materials.Emitted( hitRecord.materialId, ray, hitRecord );
+
+        if ( emitted.r > 0 || emitted.g > 0 || emitted.b > 0 )
+        {
+            RealType weight = state.sampledLights ? PowerHeuristic( state.scatteringPdf, lights.Pdf( state.scatteringPoint, hitRecord.lightId ) ) : 1;
+
+            state.radiance += weight * ( state.throughput * emitted );
+        }
+
+        state.sampledLights = !lights.IsEmpty( ) && !materials.IsSpecular( hitRecord.materialId );
+        shadowRay.isValid   = false;
+
+        if ( state.sampledLights )
+        {
+            RealType    uLight = sampler.Get1D( );
+            Point2R     u      = sampler.Get2D( );
+            LightSample lightSample;
+
+            if ( lights.Sample( hitRecord.point, uLight, u, lightSample ) )
+            {
+                RgbR scattering = materials.EvaluateScattering( hitRecord.materialId, ray, hitRecord, lightSample.direction );
+
+                if ( scattering.r > 0 || scattering.g > 0 || scattering.b > 0 )
+                {
+                    RealType pdf           = materials.ScatteringPdf( hitRecord.materialId, ray, hitRecord, lightSample.direction );
+                    RealType weight        = PowerHeuristic( lightSample.pdf, pdf );
+
+                    shadowRay.ray          = hitRecord.SpawnRayTo( hitRecord.point + lightSample.distance * lightSample.direction );
+                    shadowRay.contribution = ( weight / lightSample.pdf ) * ( state.throughput * scattering * lightSample.radiance );
+                    shadowRay.isValid      = true;
+                }
+            }
+        }
+
+        RayR scatteredRay;
+        RgbR attenuation;
+
+        if ( !materials.Scatter( hitRecord.materialId, ray, hitRecord, attenuation, scatteredRay, sampler ) )
+        {
+            return false;
+        }
+
+        if ( state.sampledLights )
+        {
+            state.scatteringPdf   = materials.ScatteringPdf( hitRecord.materialId, ray, hitRecord, Normalize( scatteredRay.GetDirection( ) ) );
+            state.scatteringPoint = hitRecord.point;
+        }
+
+        state.throughput = state.throughput * attenuation;
+        ray              = scatteredRay;
+
+        if ( depth + 1 >= russianRouletteStartDepth )
+        {
+            // Surviving paths are reweighted by the inverse probability, which keeps the estimate unbiased.
+            RealType survivalProbability = std::min( RealType( 0.95 ), std::max( { state.throughput.r, state.throughput.g, state.throughput.b } ) );
+
+            if ( sampler.Get1D( ) >= survivalProbability )
+            {
+                return false;
+            }
+
+            state.throughput /= survivalProbability;
+        }
+
+        return true;
+    }
 
-            if ( hitRecord.material->Scatter( ray, hitRecord, attenuation, scatteredRay ) )
+    void Camera::RenderWavefront( const Hittable& world, const MaterialTable& materials, const LightList& lights, RgbaImageView8& renderBuffer, SizeType maxBounces, SizeType samplesPerPixel, SizeType maxPathsInFlight )
+    {
+        CalculateViewportParameters( renderBuffer.GetWidth( ), renderBuffer.GetHeight( ) );
+
+        RgbImageD pixelSums( renderBuffer.GetWidth( ), renderBuffer.GetHeight( ) );
+        TraceWavefront( world, materials, lights, pixelSums, maxBounces, samplesPerPixel, 0, maxPathsInFlight );
+
+#pragma omp parallel for
+        for ( int j = 0; j < int( renderBuffer.GetHeight( ) ); j++ )
+        {
+            for ( SizeType i = 0; i < renderBuffer.GetWidth( ); i++ )
             {
-                return attenuation * RayColor( scatteredRay, maxBounces - 1, world );
+                renderBuffer.GetRowSpan( j )[ i ] = ConvertToRgba8( LinearToGamma( pixelSums.GetRowSpan( j )[ i ] / double( samplesPerPixel ) ) );
             }
-            return RgbD( 0, 0, 0 );
         }
 
-        auto a = 0.5 * ( Normalize( ray.GetDirection( ) ).y( ) + 1.0 );
+        renderIndex++;
+    }
+
+    void Camera::AccumulateWavefront( const Hittable& world, const MaterialTable& materials, const LightList& lights, RgbImageD& accumulationBuffer, SizeType maxBounces, SizeType samplesPerPixel, SizeType firstSampleIndex, SizeType maxPathsInFlight )
+    {
+        CalculateViewportParameters( accumulationBuffer.GetWidth( ), accumulationBuffer.GetHeight( ) );
+
+        if ( firstSampleIndex == 0 )
+        {
+            renderIndex++;
+        }
+
+        TraceWavefront( world, materials, lights, accumulationBuffer, maxBounces, samplesPerPixel, firstSampleIndex, maxPathsInFlight );
+    }
+
+    void Camera::TraceWavefront( const Hittable& world, const MaterialTable& materials, const LightList& lights, RgbImageD& pixelSums, SizeType maxBounces, SizeType samplesPerPixel, SizeType firstSampleIndex, SizeType maxPathsInFlight ) const
+    {
+        const SizeType        width            = pixelSums.GetWidth( );
+        const SizeType        pixelCount       = width * pixelSums.GetHeight( );
+        const SizeType        pathCount        = pixelCount * samplesPerPixel;
+
+        if ( maxPathsInFlight == 0 )
+        {
+            maxPathsInFlight = 4096 * SizeType( omp_get_max_threads( ) );
+        }
+
+        // Paths are numbered sample by sample, so a wave covers the image with at most one path per pixel and its paths
+        // can add to their pixels in parallel, in sample order.
+        const SizeType        waveSize         = std::max( SizeType( 1 ), std::min( maxPathsInFlight, pixelCount ) );
+
+        // Rays are sorted into the 8 octants, with finished paths and paths without a shadow ray in the last bin. Hits
+        // are sorted by material type, after the misses.
+        constexpr SizeType    octantCount      = 8;
+        constexpr SizeType    materialBinCount = std::variant_size_v<MaterialVariant> + 1;
+
+        PathStates            paths;
+        PathStates            compactedPaths;
+        std::vector<uint32_t> activePaths;
+        std::vector<uint32_t> sortedPaths;
+        std::vector<SizeType> binStarts;
+
+        paths.Resize( std::min( waveSize, pathCount ) );
+        compactedPaths.Resize( std::min( waveSize, pathCount ) );
+
+        // Cloned once, and resumed path by path with SetDimension in every stage.
+        std::vector<SharedPointer<Sampler>> threadSamplers( static_cast<SizeType>( omp_get_max_threads( ) ) );
+
+        for ( SharedPointer<Sampler>& threadSampler : threadSamplers )
+        {
+            threadSampler = sampler->Clone( );
+        }
+
+        for ( SizeType waveStart = 0; waveStart < pathCount; waveStart += waveSize )
+        {
+            const SizeType pathsInWave = std::min( waveSize, pathCount - waveStart );
+
+            // Generate: camera rays.
+#pragma omp parallel for
+            for ( int slot = 0; slot < int( pathsInWave ); slot++ )
+            {
+                Sampler& threadSampler      = *threadSamplers[ omp_get_thread_num( ) ];
+                SizeType path               = waveStart + SizeType( slot );
+                SizeType pixel              = path % pixelCount;
+
+                paths.pixelX[ slot ]        = uint32_t( pixel % width );
+                paths.pixelY[ slot ]        = uint32_t( pixel / width );
+                paths.sampleIndices[ slot ] = uint32_t( firstSampleIndex + path / pixelCount );
+
+                threadSampler.StartPixelSample( paths.pixelX[ slot ], paths.pixelY[ slot ], paths.sampleIndices[ slot ], renderIndex );
+
+                RayR ray                    = CreateRandomRayAt( paths.pixelX[ slot ], paths.pixelY[ slot ], threadSampler );
+
+                paths.SetRay( slot, ray );
+                paths.SetState( slot, PathState( ) );
+                paths.dimensions[ slot ]    = threadSampler.GetDimension( );
+                paths.binKeys[ slot ]       = GetOctant( ray.GetDirection( ) );
+            }
+
+            // The paths in flight are always the first activeCount slots.
+            SizeType activeCount = pathsInWave;
+
+            activePaths.resize( pathsInWave );
+
+            for ( SizeType slot = 0; slot < pathsInWave; slot++ )
+            {
+                activePaths[ slot ] = uint32_t( slot );
+            }
+
+            for ( SizeType depth = 0; depth < maxBounces; depth++ )
+            {
+                // Compact: the paths still going move to the front slots, octant by octant, so that the stages read them
+                // in order. Finished paths add their radiance to their pixels, one path per pixel in a wave.
+                SortPaths( activePaths, paths.binKeys, octantCount + 1, sortedPaths, binStarts );
+
+#pragma omp parallel for
+                for ( int k = int( binStarts[ octantCount ] ); k < int( activeCount ); k++ )
+                {
+                    uint32_t slot                                                        = sortedPaths[ k ];
+
+                    pixelSums.GetRowSpan( paths.pixelY[ slot ] )[ paths.pixelX[ slot ] ] += RgbCast<double>( paths.GetState( slot ).radiance );
+                }
+
+                activeCount = binStarts[ octantCount ];
+                activePaths.resize( activeCount );
+
+#pragma omp parallel for
+                for ( int k = 0; k < int( activeCount ); k++ )
+                {
+                    compactedPaths.CopyPath( SizeType( k ), paths, sortedPaths[ k ] );
+                }
+
+                std::swap( paths, compactedPaths );
+
+                if ( activeCount == 0 )
+                {
+                    break;
+                }
+
+                // Extend: the next hits of the paths still going.
+#pragma omp parallel for
+                for ( int slot = 0; slot < int( activeCount ); slot++ )
+                {
+                    paths.hits[ slot ]    = world.Hit( paths.GetRay( slot ), IntervalR( 0, std::numeric_limits<RealType>::infinity( ) ), paths.hitRecords[ slot ] );
+                    paths.binKeys[ slot ] = paths.hits[ slot ] ? uint8_t( 1 + materials.GetKind( paths.hitRecords[ slot ].materialId ) ) : 0;
+                }
+
+                // Shade: the misses, then one material type after the other, so that threads mostly shade runs of paths
+                // with the same material code.
+                SortPaths( activePaths, paths.binKeys, materialBinCount, sortedPaths, binStarts );
+
+#pragma omp parallel for
+                for ( int k = 0; k < int( activeCount ); k++ )
+                {
+                    Sampler&  threadSampler     = *threadSamplers[ omp_get_thread_num( ) ];
+                    uint32_t  slot              = sortedPaths[ k ];
+                    RayR      ray               = paths.GetRay( slot );
+
+                    paths.binKeys[ slot ]       = uint8_t( octantCount );
+                    paths.shadowBinKeys[ slot ] = uint8_t( octantCount );
+
+                    if ( !paths.hits[ slot ] )
+                    {
+                        paths.AddRadiance( slot, paths.GetState( slot ).throughput * SkyColor( ray ) );
+                        continue;
+                    }
+
+                    threadSampler.StartPixelSample( paths.pixelX[ slot ], paths.pixelY[ slot ], paths.sampleIndices[ slot ], renderIndex );
+                    threadSampler.SetDimension( paths.dimensions[ slot ] );
+
+                    PathState state     = paths.GetState( slot );
+                    ShadowRay shadowRay;
+                    bool      continues = ShadeHit( ray, paths.hitRecords[ slot ], depth, materials, lights, threadSampler, state, shadowRay );
+
+                    paths.SetState( slot, state );
+                    paths.dimensions[ slot ] = threadSampler.GetDimension( );
+
+                    if ( shadowRay.isValid )
+                    {
+                        paths.SetShadowRay( slot, shadowRay );
+                        paths.shadowBinKeys[ slot ] = GetOctant( shadowRay.ray.GetDirection( ) );
+                    }
+
+                    if ( continues )
+                    {
+                        paths.SetRay( slot, ray );
+                        paths.binKeys[ slot ] = GetOctant( ray.GetDirection( ) );
+                    }
+                }
+
+                // Connect: the shadow rays, octant by octant.
+                SortPaths( activePaths, paths.shadowBinKeys, octantCount + 1, sortedPaths, binStarts );
+
+#pragma omp parallel for
+                for ( int k = 0; k < int( binStarts[ octantCount ] ); k++ )
+                {
+                    uint32_t slot = sortedPaths[ k ];
+
+                    if ( !world.Occluded( paths.GetShadowRay( slot ), IntervalR( 0, 1 - shadowEpsilon ) ) )
+                    {
+                        paths.AddRadiance( slot, paths.GetShadowContribution( slot ) );
+                    }
+                }
+            }
 
-        return ( 1.0 - a ) * RgbD( 1.0, 1.0, 1.0 ) + a * RgbD( 0.5, 0.7, 1.0 );
+            // The paths left when the bounces run out.
+#pragma omp parallel for
+            for ( int slot = 0; slot < int( activeCount ); slot++ )
+            {
+                pixelSums.GetRowSpan( paths.pixelY[ slot ] )[ paths.pixelX[ slot ] ] += RgbCast<double>( paths.GetState( slot ).radiance );
+            }
+        }
     }
 
-    void Camera::SetLookAt( const Point3D& p )
+    void Camera::SetLookAt( const Point3R& p )
     {
         lookAt = p;
+        viewVersion++;
+    }
+
+    void Camera::SetRussianRouletteStartDepth( SizeType depth )
+    {
+        russianRouletteStartDepth = depth;
+    }
+
+    void Camera::SetPrimaryRayPackets( bool enable )
+    {
+        primaryRayPackets = enable;
+    }
+
+    void Camera::SetSampler( const SharedPointer<Sampler>& sampler )
+    {
+        this->sampler = sampler;
     }
 
     void Camera::Rotate( Vec<double,2> rotationAnglesDeg )
     {
-        lookAt      = RotateAround( center, lookAt, Vec3D { 0.0, 1.0, 0.0 }, rotationAnglesDeg.x( ) );
+        lookAt      = RotateAround( center, lookAt, Vec3R { 0.0, 1.0, 0.0 }, RealType( rotationAnglesDeg.x( ) ) );
 
-        Vec3D fwd   = Normalize( center - lookAt );
-        Vec3D right = Normalize( Cross( upVector, fwd ) );
-        lookAt      = RotateAround( center, lookAt, right, rotationAnglesDeg.y( ) );
+        Vec3R fwd   = Normalize( center - lookAt );
+        Vec3R right = Normalize( Cross( upVector, fwd ) );
+        lookAt      = RotateAround( center, lookAt, right, RealType( rotationAnglesDeg.y( ) ) );
+
+        viewVersion++;
     }
 
     void Camera::Pan( Vec<double,2> panVector )
     {
-        Vec3D fwd   = Normalize( center - lookAt );
-        center      = center + fwd * panVector.y( );
-        lookAt      = lookAt + fwd * panVector.y( );
+        Vec3R fwd   = Normalize( center - lookAt );
+        center      = center + fwd * RealType( panVector.y( ) );
+        lookAt      = lookAt + fwd * RealType( panVector.y( ) );
+
+        Vec3R right = Normalize( Cross( upVector, fwd ) );
+        center      = center + right * RealType( panVector.x( ) );
+        lookAt      = lookAt + right * RealType( panVector.x( ) );
 
-        Vec3D right = Normalize( Cross( upVector, fwd ) );
-        center      = center + right * panVector.x( );
-        lookAt      = lookAt + right * panVector.x( );
+        viewVersion++;
     }
 
 } // namespace RayTracer
\ No newline at end of file
@@ -3,7 +3,12 @@
 #include "Algebra.hpp"
 #include "Hittable.hpp"
 #include "Image.hpp"
+#include "Light.hpp"
+#include "Material.hpp"
+#include "PathState.hpp"
 #include "Ray.hpp"
+#include "Sampler.hpp"
+#include "TileScheduler.hpp"
 
 #include <iostream>
 #include <limits>
@@ -16,35 +21,129 @@ namespace RayTracer
     {
         private:
 
-            double  focalLength;
-            double  verticalFieldOfViewInDegrees = 90;
+            RealType focalLength;
+            RealType verticalFieldOfViewInDegrees = 90;
 
-            Point3D center;
-            Point3D lookAt;
-            Vec3D   upVector;
-            Point3D topLeftPixelLocation;
+            Point3R center;
+            Point3R lookAt;
+            Vec3R   upVector;
+            Point3R topLeftPixelLocation;
 
-            Vec3D   pixelDeltaU;
-            Vec3D   pixelDeltaV;
+            Vec3R   pixelDeltaU;
+            Vec3R   pixelDeltaV;
 
-            void    CalculateViewportParameters( double windowWidth, double windowHeight );
+            // Counts Render calls so that every frame draws different random numbers.
+            uint64_t renderIndex               = 0;
+
+            // Changes whenever the camera moves, so that accumulated samples can be discarded.
+            uint64_t viewVersion               = 0;
+
+            // Bounce from which paths are randomly terminated with a probability that follows their throughput.
+            SizeType russianRouletteStartDepth = 3;
+
+            // Prototype of the per thread samplers.
+            SharedPointer<Sampler> sampler     = std::make_shared<IndependentSampler>( );
+
+            // Whether Render, RenderTiled and Accumulate trace the primary rays of pixel blocks as RayPackets. Off by
+            // default, as packets have not been measured faster than single rays in those paths.
+            bool     primaryRayPackets         = false;
+
+            void    CalculateViewportParameters( RealType windowWidth, RealType windowHeight );
+
+            // Pixel values are averaged in double whatever RealType is.
+            RgbD    SamplePixel( SizeType i, SizeType j, const Hittable& world, const MaterialTable& materials, const LightList& lights, SizeType maxBounces, SizeType samplesPerPixel, SizeType firstSampleIndex, Sampler& sampler ) const;
+
+            RgbD    SamplePixelAdaptive( SizeType i, SizeType j, const Hittable& world, const MaterialTable& materials, const LightList& lights, SizeType maxBounces, SizeType minSamplesPerPixel, SizeType maxSamplesPerPixel, double maxError, SizeType& sampleCount, Sampler& sampler ) const;
+
+            // SamplePixel for the pixels of the rayPacketWidth x rayPacketHeight block at (i, j), clipped to width x height.
+            // The primary rays of each sample index are traced as one RayPacket. colors is indexed by packet lane.
+            void    SamplePixelBlock( SizeType i, SizeType j, SizeType width, SizeType height, const Hittable& world, const MaterialTable& materials, const LightList& lights, SizeType maxBounces, SizeType samplesPerPixel, SizeType firstSampleIndex, Sampler& sampler, RgbD* colors ) const;
+
+            // Passes the SamplePixel value of every pixel of the rectangle at (x, y) to store( i, j, color ), sampling
+            // pixel blocks with SamplePixelBlock if primaryRayPackets is set.
+            template <class Store>
+            void    SampleRegion( SizeType x, SizeType y, SizeType width, SizeType height, const Hittable& world, const MaterialTable& materials, const LightList& lights, SizeType maxBounces, SizeType samplesPerPixel, SizeType firstSampleIndex, Sampler& sampler, Store store ) const;
+
+            // RayColor of a path whose first hit along ray, if any, is already found.
+            RgbR    PathColor( const RayR& ray, bool hit, HitRecord hitRecord, SizeType maxBounces, const Hittable& world, const MaterialTable& materials, const LightList& lights, Sampler& sampler ) const;
+
+            // Bounce depth of a path at the hit of ray: adds the emitted light to state, samples a light and scatters. Returns
+            // false if the path ends there, otherwise ray becomes the scattered ray. The light sample is returned as
+            // shadowRay instead of being traced, so that the wavefront renderer can trace shadow rays together.
+            bool    ShadeHit( RayR& ray, const HitRecord& hitRecord, SizeType depth, const MaterialTable& materials, const LightList& lights, Sampler& sampler, PathState& state, ShadowRay& shadowRay ) const;
+
+            // Adds the sum of samplesPerPixel samples to every pixel of pixelSums, tracing waves of up to maxPathsInFlight
+            // paths one stage at a time.
+            void    TraceWavefront( const Hittable& world, const MaterialTable& materials, const LightList& lights, RgbImageD& pixelSums, SizeType maxBounces, SizeType samplesPerPixel, SizeType firstSampleIndex, SizeType maxPathsInFlight ) const;
 
         public:
 
-            Camera( const double& focalLength, const double& verticalFieldOfViewInDegrees );
+            Camera( const RealType& focalLength, const RealType& verticalFieldOfViewInDegrees );
+
+            RayR           CreateRandomRayAt( const SizeType& i, const SizeType& j, Sampler& sampler ) const;
+
+            void           Render( const Hittable& world, const MaterialTable& materials, const LightList& lights, RgbaImageView8& renderBuffer, SizeType maxBounces = 10, SizeType samplesPerPixel = 10 );
+
+            // Samples every pixel in batches of minSamplesPerPixel until, after at least two batches, the standard error of
+            // its gamma corrected luminance falls below maxError, or maxSamplesPerPixel is reached. Returns the number of
+            // samples taken.
+            SizeType       RenderAdaptive( const Hittable& world, const MaterialTable& materials, const LightList& lights, RgbaImageView8& renderBuffer, SizeType maxBounces = 10, SizeType minSamplesPerPixel = 16, SizeType maxSamplesPerPixel = 500, double maxError = 0.004, SizeType tileSize = 32 );
+
+            // Adds the sum of samplesPerPixel new samples to every pixel of accumulationBuffer. See Resolve. firstSampleIndex is
+            // the number of samples already in the buffer: the passes of one accumulation then continue the same sample
+            // sequence, and a new sequence starts when it is 0.
+            void           Accumulate( const Hittable& world, const MaterialTable& materials, const LightList& lights, RgbImageD& accumulationBuffer, SizeType maxBounces = 10, SizeType samplesPerPixel = 1, SizeType firstSampleIndex = 0 );
 
-            RayD           CreateRandomRayAt( const SizeType& i, const SizeType& j );
+            // Same image as Render, but threads take tiles from a work stealing TileScheduler instead of rows.
+            void           RenderTiled( const Hittable& world, const MaterialTable& materials, const LightList& lights, RgbaImageView8& renderBuffer, SizeType maxBounces = 10, SizeType samplesPerPixel = 10, SizeType tileSize = 32, TileOrder tileOrder = TileOrder::Hilbert );
 
-            void           Render( const Hittable& world, RgbaImageView8& renderBuffer, SizeType maxBounces = 10, SizeType samplesPerPixel = 10 );
+            // Same image as Render, traced as a wavefront: the paths of a wave advance together through the stages of a
+            // bounce (extend to the next hit, shade, connect to the sampled light), sorted by ray octant for the
+            // traversals and by material type for shading, instead of every path running to its end before the next
+            // starts. Paths in flight take about 600 bytes each with double geometry, half of it for the copy they are
+            // compacted into at every bounce, and maxPathsInFlight 0 takes 4096 per thread.
+            void           RenderWavefront( const Hittable& world, const MaterialTable& materials, const LightList& lights, RgbaImageView8& renderBuffer, SizeType maxBounces = 10, SizeType samplesPerPixel = 10, SizeType maxPathsInFlight = 0 );
 
-            RgbD           RayColor( const RayD& ray, SizeType maxBounces, const Hittable& world ) const;
+            // Accumulate traced as a wavefront, see RenderWavefront.
+            void           AccumulateWavefront( const Hittable& world, const MaterialTable& materials, const LightList& lights, RgbImageD& accumulationBuffer, SizeType maxBounces = 10, SizeType samplesPerPixel = 1, SizeType firstSampleIndex = 0, SizeType maxPathsInFlight = 0 );
 
-            const Point3D& GetLookAt( ) const
+            RgbR           RayColor( const RayR& ray, SizeType maxBounces, const Hittable& world, const MaterialTable& materials, const LightList& lights, Sampler& sampler ) const;
+
+            const Point3R& GetLookAt( ) const
             {
                 return lookAt;
             }
 
-            void SetLookAt( const Point3D& p );
+            void SetLookAt( const Point3R& p );
+
+            uint64_t GetViewVersion( ) const
+            {
+                return viewVersion;
+            }
+
+            SizeType GetRussianRouletteStartDepth( ) const
+            {
+                return russianRouletteStartDepth;
+            }
+
+            void SetRussianRouletteStartDepth( SizeType depth );
+
+            bool GetPrimaryRayPackets( ) const
+            {
+                return primaryRayPackets;
+            }
+
+            // Packets give the same image up to rounding where the compiler fuses multiply-adds differently in the Simd and
+            // scalar paths, so this is for comparisons only.
+            void SetPrimaryRayPackets( bool enable );
+
+            const SharedPointer<Sampler>& GetSampler( ) const
+            {
+                return sampler;
+            }
+
+            // Every render thread draws from its own Clone of the sampler.
+            void SetSampler( const SharedPointer<Sampler>& sampler );
 
             void Rotate( Vec<double,2> rotationAnglesDeg );
 
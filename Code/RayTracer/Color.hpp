@@ -84,11 +84,25 @@ namespace RayTracer
     using Rgb8 = Rgb<uint8_t>;
     using RgbF = Rgb<float>;
     using RgbD = Rgb<double>;
+    using RgbR = Rgb<RealType>;
 
     Rgb8  ConvertToRgb8( const RgbD& color );
 
     RgbD  LinearToGamma( const RgbD& color, double gamma = 2.2 );
 
+    // Relative luminance of a linear color (Rec. 709 weights).
+    template <typename T>
+    inline T Luminance( const Rgb<T>& color )
+    {
+        return T( 0.2126 ) * color.r + T( 0.7152 ) * color.g + T( 0.0722 ) * color.b;
+    }
+
+    template <typename To, typename From>
+    inline Rgb<To> RgbCast( const Rgb<From>& color )
+    {
+        return Rgb<To>( To( color.r ), To( color.g ), To( color.b ) );
+    }
+
 
     template <class Type>
     class Rgba
@@ -1,66 +1,262 @@
 #include "Hittable.hpp"
+#include "Simd.hpp"
 
 namespace RayTracer
 {
 
-    Sphere::Sphere( const Point3D& center, double radius, SharedPointer<Material> material ) : center( center ), radius( std::fmax( 0, radius ) ), material( material )
+    namespace
+    {
+        // Lanes of a RayPacket tested by one Simd sequence.
+        constexpr SizeType packetSimdWidth = std::min( nativeSimdWidth<RealType>, RayPacket::Size );
+    } // namespace
+
+    bool Hittable::Hit( const RayR& ray, const IntervalR& rayParameterInterval, HitRecord& hitRecord ) const
+    {
+        Intersection intersection;
+
+        if ( !Intersect( ray, rayParameterInterval, intersection ) )
+        {
+            return false;
+        }
+
+        intersection.primitive->FinalizeHit( ray, intersection, hitRecord );
+
+        return true;
+    }
+
+    LaneMask Hittable::IntersectPacket( RayPacket& packet, LaneMask activeMask, Intersection* intersections ) const
+    {
+        LaneMask hits = 0;
+
+        for ( SizeType lane = 0; lane < RayPacket::Size; lane++ )
+        {
+            if ( ( activeMask & ( 1u << lane ) ) && Intersect( packet.GetRay( lane ), packet.GetInterval( lane ), intersections[ lane ] ) )
+            {
+                packet.tTo[ lane ]  = intersections[ lane ].t;
+                hits               |= 1u << lane;
+            }
+        }
+
+        return hits;
+    }
+
+    bool Hittable::Occluded( const RayR& ray, const IntervalR& rayParameterInterval ) const
+    {
+        Intersection intersection;
+
+        return Intersect( ray, rayParameterInterval, intersection );
+    }
+
+    Sphere::Sphere( const Point3R& center, RealType radius, MaterialId materialId ) : center( center ), radius( std::max( RealType( 0 ), radius ) ), materialId( materialId )
     {
     }
 
-    bool Sphere::Hit( const RayD& ray, const IntervalD& rayParameterInterval, HitRecord& hitRecord ) const
+    bool Sphere::FindRoot( const RayR& ray, const IntervalR& rayParameterInterval, RealType& root ) const
     {
+        const Vec3R& direction = ray.GetDirection( );
 
-        Vec3D oc           = this->center - ray.GetOrigin( );
-        auto  a            = ray.GetDirection( ).MagSquare( );
-        auto  h            = Dot( ray.GetDirection( ), oc );
-        auto  c            = oc.MagSquare( ) - radius * radius;
+        Vec3R        oc        = this->center - ray.GetOrigin( );
+        RealType     a         = Dot( direction, direction );
+        RealType     h         = Dot( direction, oc );
+        RealType     c         = Dot( oc, oc ) - radius * radius;
+
+        // h * h - a * c, written with the distance of the center from the line of the ray. The two products nearly cancel
+        // for spheres small compared to their distance, which loses most of the precision of h * h - a * c in single
+        // precision (Haines et al. 2019, "Precision Improvements for Ray/Sphere Intersection").
+        Vec3R        f            = oc - ( h / a ) * direction;
+        RealType     discriminant = a * ( radius * radius - Dot( f, f ) );
 
-        auto  discriminant = h * h - a * c;
         if ( discriminant < 0 )
         {
             return false;
         }
 
-        auto sqrtd = std::sqrt( discriminant );
+        // The roots are q / a and c / q. Neither subtracts nearly equal numbers, as ( h - sqrtd ) / a does for a ray
+        // leaving the surface.
+        RealType q        = h + std::copysign( std::sqrt( discriminant ), h );
+        RealType nearRoot = q / a;
+        RealType farRoot  = c / q;
+
+        if ( nearRoot > farRoot )
+        {
+            std::swap( nearRoot, farRoot );
+        }
 
         // Find the nearest root that lies in the acceptable range.
-        auto root = ( h - sqrtd ) / a;
+        root = nearRoot;
         if ( !rayParameterInterval.Surrounds( root ) )
         {
-            root = ( h + sqrtd ) / a;
+            root = farRoot;
             if ( !rayParameterInterval.Surrounds( root ) )
             {
                 return false;
             }
         }
 
-        hitRecord.t                = root;
-        hitRecord.point            = ray.GetPointAt( hitRecord.t );
-        Vec3D surfaceOutwardNormal = ( hitRecord.point - this->center ) / radius;
-        hitRecord.SetSurfaceNormal( ray, surfaceOutwardNormal );
-        hitRecord.material = material;
+        return true;
+    }
+
+    bool Sphere::Intersect( const RayR& ray, const IntervalR& rayParameterInterval, Intersection& intersection ) const
+    {
+        RealType root;
+
+        if ( !FindRoot( ray, rayParameterInterval, root ) )
+        {
+            return false;
+        }
+
+        intersection.t              = root;
+        intersection.primitive      = this;
+        intersection.primitiveIndex = 0;
 
         return true;
     }
 
-    bool HittableList::Hit( const RayD& ray, const IntervalD& rayParameterInterval, HitRecord& hitRecord ) const
+    LaneMask Sphere::IntersectPacket( RayPacket& packet, LaneMask activeMask, Intersection* intersections ) const
     {
-        HitRecord tempHitRecord;
-        bool      hitSomething = false;
-        auto      closest      = rayParameterInterval.GetTo( );
-        ;
+        using Pack = Simd<RealType, packetSimdWidth>;
+
+        const Pack     centerX       = Pack::Broadcast( center[ 0 ] );
+        const Pack     centerY       = Pack::Broadcast( center[ 1 ] );
+        const Pack     centerZ       = Pack::Broadcast( center[ 2 ] );
+        const Pack     radiusSquared = Pack::Broadcast( radius * radius );
+        const Pack     infinity      = Pack::Broadcast( std::numeric_limits<RealType>::infinity( ) );
+        const Pack     zero          = Pack::Broadcast( 0 );
+
+        const LaneMask groupMask     = ( 1u << packetSimdWidth ) - 1;
+        LaneMask       hits          = 0;
+
+        alignas( sizeof( Pack ) ) RealType tLanes[ packetSimdWidth ];
+
+        for ( SizeType first = 0; first < RayPacket::Size; first += packetSimdWidth )
+        {
+            if ( ( ( activeMask >> first ) & groupMask ) == 0 )
+            {
+                continue;
+            }
+
+            Pack     directionX   = Pack::Load( packet.directionX + first );
+            Pack     directionY   = Pack::Load( packet.directionY + first );
+            Pack     directionZ   = Pack::Load( packet.directionZ + first );
+            Pack     ocX          = centerX - Pack::Load( packet.originX + first );
+            Pack     ocY          = centerY - Pack::Load( packet.originY + first );
+            Pack     ocZ          = centerZ - Pack::Load( packet.originZ + first );
+
+            Pack     a            = directionX * directionX + directionY * directionY + directionZ * directionZ;
+            Pack     h            = directionX * ocX + directionY * ocY + directionZ * ocZ;
+            Pack     c            = ocX * ocX + ocY * ocY + ocZ * ocZ - radiusSquared;
+
+            Pack     hOverA       = h / a;
+            Pack     fX           = ocX - hOverA * directionX;
+            Pack     fY           = ocY - hOverA * directionY;
+            Pack     fZ           = ocZ - hOverA * directionZ;
+            Pack     discriminant = a * ( radiusSquared - ( fX * fX + fY * fY + fZ * fZ ) );
+            Pack     sqrtd        = Sqrt( Max( discriminant, zero ) );
+            Pack     q            = Select( h < zero, h - sqrtd, h + sqrtd );
+
+            Pack     tFrom        = Pack::Load( packet.tFrom + first );
+            Pack     tTo          = Pack::Load( packet.tTo + first );
+            Pack     nearRoot     = Min( q / a, c / q );
+            Pack     farRoot      = Max( q / a, c / q );
+            Pack     t            = Select( ( nearRoot > tFrom ) & ( nearRoot < tTo ), nearRoot, Select( ( farRoot > tFrom ) & ( farRoot < tTo ), farRoot, infinity ) );
+
+            LaneMask groupHits    = MoveMask( ( discriminant >= zero ) & ( t < tTo ) ) & ( activeMask >> first );
+
+            if ( groupHits == 0 )
+            {
+                continue;
+            }
+
+            t.Store( tLanes );
+
+            for ( SizeType lane = 0; lane < packetSimdWidth; lane++ )
+            {
+                if ( groupHits & ( 1u << lane ) )
+                {
+                    packet.tTo[ first + lane ]    = tLanes[ lane ];
+                    intersections[ first + lane ] = Intersection { tLanes[ lane ], this, 0 };
+                }
+            }
+
+            hits |= groupHits << first;
+        }
+
+        return hits;
+    }
+
+    void Sphere::FinalizeHit( const RayR& ray, const Intersection& intersection, HitRecord& hitRecord ) const
+    {
+        SetSphereHit( ray, intersection.t, center, radius, hitRecord );
+        hitRecord.materialId = materialId;
+        hitRecord.lightId    = lightId;
+    }
+
+    bool Sphere::Occluded( const RayR& ray, const IntervalR& rayParameterInterval ) const
+    {
+        RealType root;
+
+        return FindRoot( ray, rayParameterInterval, root );
+    }
+
+    AabbR Sphere::GetBoundingBox( ) const
+    {
+        Vec3R radiusVector { radius, radius, radius };
+
+        return AabbR( center - radiusVector, center + radiusVector );
+    }
+
+    bool HittableList::Intersect( const RayR& ray, const IntervalR& rayParameterInterval, Intersection& intersection ) const
+    {
+        bool hitSomething = false;
+        auto closest      = rayParameterInterval.GetTo( );
 
         for ( const auto& object : objects )
         {
-            if ( object->Hit( ray, Interval( rayParameterInterval.GetFrom( ), closest ), tempHitRecord ) )
+            if ( object->Intersect( ray, Interval( rayParameterInterval.GetFrom( ), closest ), intersection ) )
             {
                 hitSomething = true;
-                closest      = tempHitRecord.t;
-                hitRecord    = tempHitRecord;
+                closest      = intersection.t;
             }
         }
 
         return hitSomething;
     }
 
+    LaneMask HittableList::IntersectPacket( RayPacket& packet, LaneMask activeMask, Intersection* intersections ) const
+    {
+        LaneMask hits = 0;
+
+        for ( const auto& object : objects )
+        {
+            hits |= object->IntersectPacket( packet, activeMask, intersections );
+        }
+
+        return hits;
+    }
+
+    bool HittableList::Occluded( const RayR& ray, const IntervalR& rayParameterInterval ) const
+    {
+        for ( const auto& object : objects )
+        {
+            if ( object->Occluded( ray, rayParameterInterval ) )
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    AabbR HittableList::GetBoundingBox( ) const
+    {
+        AabbR boundingBox;
+
+        for ( const auto& object : objects )
+        {
+            boundingBox.Expand( object->GetBoundingBox( ) );
+        }
+
+        return boundingBox;
+    }
+
 } // namespace RayTracer
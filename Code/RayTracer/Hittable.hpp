@@ -1,31 +1,93 @@
 #pragma once
 
+#include "Aabb.hpp"
 #include "Common.hpp"
 #include "Interval.hpp"
 #include "Ray.hpp"
+#include "RayPacket.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <vector>
 
 
 namespace RayTracer
 {
-    class Material;
+    // Index of a material in the MaterialTable of the scene.
+    using MaterialId = uint32_t;
+
+    // Index of a light in the LightList of the scene, for emitters that are also sampled directly.
+    using LightId = uint32_t;
+
+    inline constexpr LightId noLightId = std::numeric_limits<LightId>::max( );
 
     struct HitRecord
     {
-            Point3D                 point;
-            Vec3D                   surfaceNormal;
-            double                  t;
-            bool                    frontFace;
-            SharedPointer<Material> material;
-
-            void                    SetSurfaceNormal( const RayD& ray, const Vec3D& surfaceOutwardNormal )
+            Point3R    point;
+            Vec3R      surfaceNormal;
+            RealType   t;
+            RealType   pointError; // Bound on the rounding error of every coordinate of point, see OffsetRayOrigin.
+            bool       frontFace;
+            MaterialId materialId;
+            Point2R    uv { 0.0, 0.0 }; // Texture coordinates of surfaces that have them.
+            LightId    lightId = noLightId; // Light that samples the surface hit, if any, for multiple importance sampling.
+
+            void       SetSurfaceNormal( const RayR& ray, const Vec3R& surfaceOutwardNormal )
             {
-                this->frontFace     = Dot( ray.GetDirection( ), surfaceOutwardNormal );
+                this->frontFace     = Dot( ray.GetDirection( ), surfaceOutwardNormal ) < 0;
                 this->surfaceNormal = this->frontFace ? surfaceOutwardNormal : -surfaceOutwardNormal;
             }
+
+            // Ray leaving the surface towards direction, to be traced from t = 0.
+            RayR       SpawnRay( const Vec3R& direction ) const
+            {
+                return RayR( OffsetRayOrigin( point, pointError, surfaceNormal, direction ), direction );
+            }
+
+            // Ray leaving the surface that reaches target at t = 1, for shadow rays. Measured from the offset origin, so
+            // that the offset does not move the end of the ray.
+            RayR       SpawnRayTo( const Point3R& target ) const
+            {
+                Point3R origin = OffsetRayOrigin( point, pointError, surfaceNormal, target - point );
+
+                return RayR( origin, target - origin );
+            }
     };
 
+    // Fills the geometry of a hit on a sphere. The point is projected onto the sphere, which leaves it with a rounding
+    // error proportional to its coordinates and the radius only, whatever the error of t.
+    inline void SetSphereHit( const RayR& ray, RealType t, const Point3R& center, RealType radius, HitRecord& hitRecord )
+    {
+        Vec3R fromCenter     = ray.GetPointAt( t ) - center;
+        fromCenter          *= radius / std::sqrt( Dot( fromCenter, fromCenter ) );
+
+        hitRecord.t          = t;
+        hitRecord.point      = center + fromCenter;
+        hitRecord.pointError = RealType( 8 ) * std::numeric_limits<RealType>::epsilon( )
+                             * ( radius + std::max( { std::abs( hitRecord.point[ 0 ] ), std::abs( hitRecord.point[ 1 ] ), std::abs( hitRecord.point[ 2 ] ) } ) );
+        hitRecord.SetSurfaceNormal( ray, fromCenter / radius );
+    }
+
+    class Hittable;
+
+    // Closest hit found by Hittable::Intersect: the ray parameter and the primitive, which computes the HitRecord from it
+    // with FinalizeHit.
+    struct Intersection
+    {
+            RealType        t;
+            const Hittable* primitive;
+            uint32_t        primitiveIndex; // Identifies the hit within primitive, e.g. the sphere of a SphereSet.
+
+            // Coordinates of the hit on the surface, for the primitives that find them anyway, e.g. the barycentric
+            // coordinates of vertices 1 and 2 of a triangle.
+            RealType        u;
+            RealType        v;
+    };
+
+    // Hits are found in two phases: Intersect searches for the closest hit and records only t and the primitive, then
+    // Hit fetches the shading data of that one hit through FinalizeHit.
     class Hittable
     {
 
@@ -33,8 +95,25 @@ namespace RayTracer
 
             virtual ~Hittable( ) = default;
 
-            //
-            virtual bool Hit( const RayD& ray, const IntervalD& rayParameterInterval, HitRecord& hitRecord ) const = 0;
+            // Leaves intersection unchanged if nothing is hit within the interval.
+            virtual bool     Intersect( const RayR& ray, const IntervalR& rayParameterInterval, Intersection& intersection ) const = 0;
+
+            // Intersect for the active lanes of packet at once. Lowers packet.tTo and sets intersections[ lane ] for the
+            // lanes hit, and returns them. The default intersects the rays one by one.
+            virtual LaneMask IntersectPacket( RayPacket& packet, LaneMask activeMask, Intersection* intersections ) const;
+
+            // Called on the primitive of an intersection only, so aggregates keep the default.
+            virtual void     FinalizeHit( const RayR& ray, const Intersection& intersection, HitRecord& hitRecord ) const
+            {
+            }
+
+            bool             Hit( const RayR& ray, const IntervalR& rayParameterInterval, HitRecord& hitRecord ) const;
+
+            // Whether anything is hit within the interval, for shadow rays. Returns at the first hit found and computes
+            // no hit record. The default falls back to Intersect.
+            virtual bool     Occluded( const RayR& ray, const IntervalR& rayParameterInterval ) const;
+
+            virtual AabbR    GetBoundingBox( ) const = 0;
     };
 
     class HittableList : public Hittable
@@ -45,7 +124,13 @@ namespace RayTracer
 
             //
 
-            bool Hit( const RayD& ray, const IntervalD& rayParameterInterval, HitRecord& hitRecord ) const override;
+            bool     Intersect( const RayR& ray, const IntervalR& rayParameterInterval, Intersection& intersection ) const override;
+
+            LaneMask IntersectPacket( RayPacket& packet, LaneMask activeMask, Intersection* intersections ) const override;
+
+            bool     Occluded( const RayR& ray, const IntervalR& rayParameterInterval ) const override;
+
+            AabbR    GetBoundingBox( ) const override;
     };
 
 
@@ -53,14 +138,47 @@ namespace RayTracer
     {
         private:
 
-            Point3D                 center;
-            double                  radius;
-            SharedPointer<Material> material;
+            Point3R    center;
+            RealType   radius;
+            MaterialId materialId;
+            LightId    lightId = noLightId;
+
+            bool       FindRoot( const RayR& ray, const IntervalR& rayParameterInterval, RealType& root ) const;
 
         public:
 
-            Sphere( const Point3D& center, double radius, SharedPointer<Material> material );
+            Sphere( const Point3R& center, RealType radius, MaterialId materialId );
+
+            bool     Intersect( const RayR& ray, const IntervalR& rayParameterInterval, Intersection& intersection ) const override;
+
+            // Tests Simd<RealType> wide groups of the rays of the packet with the same formulation as FindRoot.
+            LaneMask IntersectPacket( RayPacket& packet, LaneMask activeMask, Intersection* intersections ) const override;
+
+            void     FinalizeHit( const RayR& ray, const Intersection& intersection, HitRecord& hitRecord ) const override;
+
+            bool     Occluded( const RayR& ray, const IntervalR& rayParameterInterval ) const override;
+
+            AabbR    GetBoundingBox( ) const override;
 
-            bool Hit( const RayD& ray, const IntervalD& rayParameterInterval, HitRecord& hitRecord ) const override;
+            const Point3R& GetCenter( ) const
+            {
+                return center;
+            }
+
+            RealType       GetRadius( ) const
+            {
+                return radius;
+            }
+
+            MaterialId     GetMaterialId( ) const
+            {
+                return materialId;
+            }
+
+            // Set by LightList::Add, so that hits on the sphere find the light that samples it.
+            void           SetLightId( LightId lightId )
+            {
+                this->lightId = lightId;
+            }
     };
 } // namespace RayTracer
@@ -1,4 +1,27 @@
 #include "Image.hpp"
 
 
-template class RayTracer::Image<RayTracer::Rgb8>;
\ No newline at end of file
+template class RayTracer::Image<RayTracer::Rgb8>;
+template class RayTracer::Image<RayTracer::RgbD>;
+
+namespace RayTracer
+{
+
+    void Resolve( const RgbImageD& accumulationBuffer, SizeType sampleCount, RgbaImageView8& image )
+    {
+        double inverseSampleCount = 1.0 / double( std::max( sampleCount, SizeType( 1 ) ) );
+
+#pragma omp parallel for
+        for ( int j = 0; j < int( image.GetHeight( ) ); j++ )
+        {
+            auto sourceRow = accumulationBuffer.GetRowSpan( j );
+            auto imageRow  = image.GetRowSpan( j );
+
+            for ( SizeType i = 0; i < image.GetWidth( ); i++ )
+            {
+                imageRow[ i ] = ConvertToRgba8( LinearToGamma( inverseSampleCount * sourceRow[ i ] ) );
+            }
+        }
+    }
+
+} // namespace RayTracer
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "Color.hpp"
 #include "Common.hpp"
 
+#include <algorithm>
 #include <span>
 #include <vector>
 #include <fstream>
@@ -16,12 +17,14 @@ namespace RayTracer
     {
         private:
 
-            SizeType                    width;
-            SizeType                    height;
+            SizeType                    width  = 0;
+            SizeType                    height = 0;
             std::vector<PixelColorType> buffer;
 
         public:
 
+            Image( ) = default;
+
             Image( const SizeType& width, const SizeType& height ) : width( width ), height( height ), buffer( width * height )
             {
             }
@@ -55,10 +58,17 @@ namespace RayTracer
             {
                 return std::span<PixelColorType>( &buffer[ row * width ], width );
             }
+
+            void Fill( const PixelColorType& color )
+            {
+                std::fill( buffer.begin( ), buffer.end( ), color );
+            }
     };
 
     extern template class Image<Rgb8>;
+    extern template class Image<RgbD>;
     using RgbImage8 = Image<Rgb8>;
+    using RgbImageD = Image<RgbD>;
 
     template <class PixelColorType>
     class ImageView
@@ -116,6 +126,37 @@ namespace RayTracer
     extern template class ImageView<Rgba8>;
     using RgbaImageView8 = ImageView<Rgba8>;
 
+    // Writes the average of sampleCount accumulated samples per pixel to a displayable image.
+    void Resolve( const RgbImageD& accumulationBuffer, SizeType sampleCount, RgbaImageView8& image );
+
+    // Fills target with the nearest pixels of source, which may have any size.
+    template <class SourceImageType, class TargetImageType>
+    void ResizeNearest( const SourceImageType& source, TargetImageType& target )
+    {
+        if ( source.GetWidth( ) == 0 || source.GetHeight( ) == 0 )
+        {
+            return;
+        }
+
+        std::vector<SizeType> sourceColumns( target.GetWidth( ) );
+
+        for ( SizeType i = 0; i < target.GetWidth( ); i++ )
+        {
+            sourceColumns[ i ] = std::min( ( 2 * i + 1 ) * source.GetWidth( ) / ( 2 * target.GetWidth( ) ), source.GetWidth( ) - 1 );
+        }
+
+        for ( SizeType j = 0; j < target.GetHeight( ); j++ )
+        {
+            auto sourceRow = source.GetRowSpan( std::min( ( 2 * j + 1 ) * source.GetHeight( ) / ( 2 * target.GetHeight( ) ), source.GetHeight( ) - 1 ) );
+            auto targetRow = target.GetRowSpan( j );
+
+            for ( SizeType i = 0; i < target.GetWidth( ); i++ )
+            {
+                targetRow[ i ] = sourceRow[ sourceColumns[ i ] ];
+            }
+        }
+    }
+
 
     template <class ImageType>
     bool WritePPM( const ImageType& image, const char* fileName )
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Common.hpp"
+
 #include <algorithm>
 
 namespace RayTracer
@@ -50,6 +52,7 @@ namespace RayTracer
 
     using IntervalF = Interval<float>;
     using IntervalD = Interval<double>;
+    using IntervalR = Interval<RealType>;
 
 
 } // namespace RayTracer
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "Light.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace RayTracer
+{
+
+    namespace
+    {
+        // 1 - cos of the half angle of the cone that the light subtends from point, or 0 if point is inside.
+        RealType GetConeSolidAngleFactor( const SphereLight& light, const Point3R& point )
+        {
+            Vec3R    toCenter        = light.center - point;
+            RealType distanceSquared = Dot( toCenter, toCenter );
+            RealType radiusSquared   = light.radius * light.radius;
+
+            if ( distanceSquared <= radiusSquared )
+            {
+                return 0;
+            }
+
+            // Written without 1 - cos, which cancels for small and distant lights.
+            RealType sinSquaredMax   = radiusSquared / distanceSquared;
+            RealType cosMax          = std::sqrt( std::max( RealType( 0 ), 1 - sinSquaredMax ) );
+
+            return sinSquaredMax / ( 1 + cosMax );
+        }
+    } // namespace
+
+    bool LightList::Add( Sphere& sphere, const MaterialTable& materials )
+    {
+        // Radiance leaving the top of the sphere upwards.
+        Point3R   top       = sphere.GetCenter( ) + Vec3R { 0.0, sphere.GetRadius( ), 0.0 };
+        RayR      ray( top + Vec3R { 0.0, 1.0, 0.0 }, Vec3R { 0.0, -1.0, 0.0 } );
+        HitRecord hitRecord;
+
+        hitRecord.point      = top;
+        hitRecord.t          = 1;
+        hitRecord.pointError = 0;
+        hitRecord.materialId = sphere.GetMaterialId( );
+        hitRecord.SetSurfaceNormal( ray, Vec3R { 0.0, 1.0, 0.0 } );
+
+        RgbR      radiance  = materials.Emitted( sphere.GetMaterialId( ), ray, hitRecord );
+        RealType  power     = Luminance( radiance ) * sphere.GetRadius( ) * sphere.GetRadius( );
+
+        if ( power <= 0 )
+        {
+            return false;
+        }
+
+        sphere.SetLightId( LightId( lights.size( ) ) );
+
+        lights.push_back( SphereLight { sphere.GetCenter( ), sphere.GetRadius( ), radiance } );
+        cumulativePowers.push_back( ( cumulativePowers.empty( ) ? 0 : cumulativePowers.back( ) ) + power );
+
+        return true;
+    }
+
+    RealType LightList::GetSelectionProbability( SizeType lightIndex ) const
+    {
+        RealType previous = lightIndex == 0 ? 0 : cumulativePowers[ lightIndex - 1 ];
+
+        return ( cumulativePowers[ lightIndex ] - previous ) / cumulativePowers.back( );
+    }
+
+    bool LightList::Sample( const Point3R& point, RealType uLight, const Point2R& u, LightSample& lightSample ) const
+    {
+        if ( lights.empty( ) || cumulativePowers.back( ) <= 0 )
+        {
+            return false;
+        }
+
+        SizeType lightIndex = std::upper_bound( cumulativePowers.begin( ), cumulativePowers.end( ), uLight * cumulativePowers.back( ) ) - cumulativePowers.begin( );
+        lightIndex          = std::min( lightIndex, lights.size( ) - 1 );
+
+        const SphereLight& light       = lights[ lightIndex ];
+        RealType           coneFactor  = GetConeSolidAngleFactor( light, point );
+
+        if ( coneFactor <= 0 )
+        {
+            return false;
+        }
+
+        // Uniform direction within the cone around the center.
+        Vec3R    toCenter    = light.center - point;
+        RealType distance    = std::sqrt( Dot( toCenter, toCenter ) );
+        Vec3R    axis        = toCenter / distance;
+
+        RealType oneMinusCos = u[ 0 ] * coneFactor;
+        RealType cosTheta    = 1 - oneMinusCos;
+        RealType sinTheta    = std::sqrt( std::max( RealType( 0 ), oneMinusCos * ( 2 - oneMinusCos ) ) );
+        RealType phi         = RealType( 2 * pi ) * u[ 1 ];
+
+        Vec3R    b1;
+        Vec3R    b2;
+        CreateOrthonormalBasis( axis, b1, b2 );
+
+        lightSample.direction = b1 * ( sinTheta * std::cos( phi ) ) + b2 * ( sinTheta * std::sin( phi ) ) + axis * cosTheta;
+
+        // Nearest intersection of the direction with the sphere.
+        RealType halfChord    = std::sqrt( std::max( RealType( 0 ), light.radius * light.radius - distance * distance * sinTheta * sinTheta ) );
+
+        lightSample.distance  = distance * cosTheta - halfChord;
+        lightSample.pdf       = GetSelectionProbability( lightIndex ) / ( RealType( 2 * pi ) * coneFactor );
+        lightSample.radiance  = light.radiance;
+
+        return true;
+    }
+
+    RealType LightList::Pdf( const Point3R& point, LightId lightId ) const
+    {
+        if ( lightId >= lights.size( ) || cumulativePowers.back( ) <= 0 )
+        {
+            return 0;
+        }
+
+        RealType coneFactor = GetConeSolidAngleFactor( lights[ lightId ], point );
+
+        if ( coneFactor <= 0 )
+        {
+            return 0;
+        }
+
+        return GetSelectionProbability( lightId ) / ( RealType( 2 * pi ) * coneFactor );
+    }
+
+} // namespace RayTracer
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Algebra.hpp"
+#include "Color.hpp"
+#include "Common.hpp"
+#include "Hittable.hpp"
+#include "Material.hpp"
+
+#include <vector>
+
+namespace RayTracer
+{
+
+    // Direction from a shading point towards a point on a light, as chosen by LightList::Sample.
+    struct LightSample
+    {
+            Vec3R    direction;
+            RealType distance;
+
+            // Solid angle density, including the probability of picking the light.
+            RealType pdf;
+            RgbR     radiance;
+    };
+
+
+    // Sphere of the world that emits radiance uniformly from its surface, as seen by LightList::Sample.
+    struct SphereLight
+    {
+            Point3R  center;
+            RealType radius;
+            RgbR     radiance;
+    };
+
+
+    // Emitters of a scene, sampled directly at every diffuse bounce (next event estimation). A light is picked with a
+    // probability proportional to its power, and a direction within the cone it subtends from the shading point.
+    class LightList
+    {
+        private:
+
+            std::vector<SphereLight> lights;
+            std::vector<RealType>    cumulativePowers;
+
+            RealType                 GetSelectionProbability( SizeType lightIndex ) const;
+
+        public:
+
+            // Samples sphere, an emitter of the world, directly. The radiance is that of its material, which is assumed
+            // to emit uniformly, as DiffuseLight does. Sets the LightId of sphere, so that hits on it carry the light
+            // that sampled them, and a sphere belongs to one LightList only. Returns false, and leaves sphere unchanged,
+            // if its material emits nothing.
+            bool                            Add( Sphere& sphere, const MaterialTable& materials );
+
+            // uLight picks the light and u the direction. Returns false if point is inside the light.
+            bool                            Sample( const Point3R& point, RealType uLight, const Point2R& u, LightSample& lightSample ) const;
+
+            // Density with which Sample picks the direction from point towards a point on the surface of light lightId,
+            // the HitRecord::lightId of a hit on it. Emitters that Sample cannot pick, with noLightId, have density 0.
+            RealType                        Pdf( const Point3R& point, LightId lightId ) const;
+
+            bool IsEmpty( ) const
+            {
+                return lights.empty( );
+            }
+
+            const std::vector<SphereLight>& GetLights( ) const
+            {
+                return lights;
+            }
+    };
+
+} // namespace RayTracer
@@ -0,0 +1,126 @@
+#include "MappedFile.hpp"
+
+#if defined( _WIN32 )
+#    define NOMINMAX
+#    define WIN32_LEAN_AND_MEAN
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace RayTracer
+{
+
+    MappedFile::~MappedFile( )
+    {
+        Close( );
+    }
+
+    bool MappedFile::Open( const char* fileName )
+    {
+        Close( );
+
+        // The view keeps the file open, so the handles are closed as soon as it is mapped.
+#if defined( _WIN32 )
+        HANDLE file = CreateFileA( fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+
+        if ( file == INVALID_HANDLE_VALUE )
+        {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize;
+
+        if ( !GetFileSizeEx( file, &fileSize ) )
+        {
+            CloseHandle( file );
+
+            return false;
+        }
+
+        if ( fileSize.QuadPart == 0 )
+        {
+            CloseHandle( file );
+
+            return true;
+        }
+
+        HANDLE mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+        CloseHandle( file );
+
+        if ( mapping == nullptr )
+        {
+            return false;
+        }
+
+        void* view = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+        CloseHandle( mapping );
+
+        if ( view == nullptr )
+        {
+            return false;
+        }
+
+        data = static_cast<const char*>( view );
+        size = SizeType( fileSize.QuadPart );
+#else
+        int descriptor = open( fileName, O_RDONLY );
+
+        if ( descriptor < 0 )
+        {
+            return false;
+        }
+
+        struct stat status;
+
+        if ( fstat( descriptor, &status ) != 0 )
+        {
+            close( descriptor );
+
+            return false;
+        }
+
+        if ( status.st_size == 0 )
+        {
+            close( descriptor );
+
+            return true;
+        }
+
+        void* view = mmap( nullptr, SizeType( status.st_size ), PROT_READ, MAP_PRIVATE, descriptor, 0 );
+        close( descriptor );
+
+        if ( view == MAP_FAILED )
+        {
+            return false;
+        }
+
+        // The whole file is about to be parsed, so reading ahead of the threads pays off.
+        posix_madvise( view, SizeType( status.st_size ), POSIX_MADV_WILLNEED );
+
+        data = static_cast<const char*>( view );
+        size = SizeType( status.st_size );
+#endif
+
+        return true;
+    }
+
+    void MappedFile::Close( )
+    {
+        if ( data != nullptr )
+        {
+#if defined( _WIN32 )
+            UnmapViewOfFile( data );
+#else
+            munmap( const_cast<char*>( data ), size );
+#endif
+        }
+
+        data = nullptr;
+        size = 0;
+    }
+
+} // namespace RayTracer
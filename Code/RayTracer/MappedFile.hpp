@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Common.hpp"
+
+namespace RayTracer
+{
+
+    // Read only view of a whole file mapped into memory. Pages are read in by the operating system as they are touched,
+    // so threads parsing different parts of the file wait for their own parts only, and nothing is copied into a buffer.
+    class MappedFile
+    {
+        private:
+
+            const char* data = nullptr;
+            SizeType    size = 0;
+
+        public:
+
+            MappedFile( )
+            {
+            }
+
+            ~MappedFile( );
+
+            MappedFile( const MappedFile& )            = delete;
+            MappedFile& operator=( const MappedFile& ) = delete;
+
+            // Closes the file mapped before. An empty file opens with no data.
+            bool        Open( const char* fileName );
+
+            void        Close( );
+
+            const char* GetData( ) const
+            {
+                return data;
+            }
+
+            SizeType    GetSize( ) const
+            {
+                return size;
+            }
+    };
+
+} // namespace RayTracer
@@ -1,43 +1,119 @@
 #include "Material.hpp"
 
+#include <algorithm>
+
 namespace RayTracer
 {
 
-    Lambertian::Lambertian( const RgbD& albedo ) : albedo( albedo )
+    Lambertian::Lambertian( const RgbR& albedo ) : albedo( albedo )
     {
     }
 
-    bool Lambertian::Scatter( const RayD& incomingRay, const HitRecord& hitRecord, RgbD& attenuation, RayD& scatteredRay ) const
+    bool Lambertian::Scatter( const RayR& incomingRay, const HitRecord& hitRecord, RgbR& attenuation, RayR& scatteredRay, Sampler& sampler ) const
     {
-        auto scatterDirection = hitRecord.surfaceNormal + CreateRandomUnitVector<double>( );
-
-        // auto scatter_direction = random_on_hemisphere(rec.normal);
-
-        // Catch degenerate scatter direction
-        if ( NearZero( scatterDirection ) )
-        {
-            scatterDirection = hitRecord.surfaceNormal;
-        }
+        // Cosine weighted, so the cosine of the rendering equation cancels against the density and only the albedo remains.
+        auto scatterDirection = SampleCosineHemisphere( hitRecord.surfaceNormal, sampler.Get2D( ) );
 
-        scatteredRay = RayD( hitRecord.point, scatterDirection );
+        scatteredRay = hitRecord.SpawnRay( scatterDirection );
         attenuation  = albedo; // Todo: should we call attenuation albedo?
         // *dot(scatter_direction / scatter_direction.length(), rec.normal / rec.normal.length()); // Nasos: shouldn't abledo multiplied by cosine (through N.L as I am doing here?)
         return true;
     }
 
+    RgbR Lambertian::EvaluateScattering( const RayR& incomingRay, const HitRecord& hitRecord, const Vec3R& direction ) const
+    {
+        return ( std::max( RealType( 0 ), Dot( hitRecord.surfaceNormal, direction ) ) / RealType( pi ) ) * albedo;
+    }
+
+    RealType Lambertian::ScatteringPdf( const RayR& incomingRay, const HitRecord& hitRecord, const Vec3R& direction ) const
+    {
+        return std::max( RealType( 0 ), Dot( hitRecord.surfaceNormal, direction ) ) / RealType( pi );
+    }
 
-    Metal::Metal( const RgbD& albedo ) : albedo( albedo )
+
+    Metal::Metal( const RgbR& albedo ) : albedo( albedo )
     {
     }
 
-    bool Metal::Scatter( const RayD& incomingRay, const HitRecord& hitRecord, RgbD& attenuation, RayD& scatteredRay ) const
+    bool Metal::Scatter( const RayR& incomingRay, const HitRecord& hitRecord, RgbR& attenuation, RayR& scatteredRay, Sampler& sampler ) const
     {
-        Vec3D reflected = Reflect( incomingRay.GetDirection( ), hitRecord.surfaceNormal );
-        scatteredRay    = RayD( hitRecord.point, reflected );
+        Vec3R reflected = Reflect( incomingRay.GetDirection( ), hitRecord.surfaceNormal );
+        scatteredRay    = hitRecord.SpawnRay( reflected );
         attenuation     = albedo;
 
         return true;
     }
 
 
+    DiffuseLight::DiffuseLight( const RgbR& radiance ) : radiance( radiance )
+    {
+    }
+
+    RgbR DiffuseLight::Emitted( const RayR& incomingRay, const HitRecord& hitRecord ) const
+    {
+        return radiance;
+    }
+
+
+    MaterialId MaterialTable::Add( MaterialVariant material )
+    {
+        materials.push_back( std::move( material ) );
+
+        return MaterialId( materials.size( ) - 1 );
+    }
+
+    const Material& MaterialTable::Get( MaterialId materialId ) const
+    {
+        return Visit( materialId,
+                      []( const Material& material ) -> const Material&
+                      {
+                          return material;
+                      } );
+    }
+
+    bool MaterialTable::Scatter( MaterialId materialId, const RayR& incomingRay, const HitRecord& hitRecord, RgbR& attenuation, RayR& scatteredRay, Sampler& sampler ) const
+    {
+        return Visit( materialId,
+                      [ & ]( const auto& material )
+                      {
+                          return material.Scatter( incomingRay, hitRecord, attenuation, scatteredRay, sampler );
+                      } );
+    }
+
+    RgbR MaterialTable::Emitted( MaterialId materialId, const RayR& incomingRay, const HitRecord& hitRecord ) const
+    {
+        return Visit( materialId,
+                      [ & ]( const auto& material )
+                      {
+                          return material.Emitted( incomingRay, hitRecord );
+                      } );
+    }
+
+    bool MaterialTable::IsSpecular( MaterialId materialId ) const
+    {
+        return Visit( materialId,
+                      [ & ]( const auto& material )
+                      {
+                          return material.IsSpecular( );
+                      } );
+    }
+
+    RgbR MaterialTable::EvaluateScattering( MaterialId materialId, const RayR& incomingRay, const HitRecord& hitRecord, const Vec3R& direction ) const
+    {
+        return Visit( materialId,
+                      [ & ]( const auto& material )
+                      {
+                          return material.EvaluateScattering( incomingRay, hitRecord, direction );
+                      } );
+    }
+
+    RealType MaterialTable::ScatteringPdf( MaterialId materialId, const RayR& incomingRay, const HitRecord& hitRecord, const Vec3R& direction ) const
+    {
+        return Visit( materialId,
+                      [ & ]( const auto& material )
+                      {
+                          return material.ScatteringPdf( incomingRay, hitRecord, direction );
+                      } );
+    }
+
 } // namespace RayTracer
\ No newline at end of file
@@ -2,8 +2,13 @@
 
 #include "Color.hpp"
 #include "Hittable.hpp"
+#include "Sampler.hpp"
 #include "Ray.hpp"
 
+#include <type_traits>
+#include <variant>
+#include <vector>
+
 namespace RayTracer
 {
 
@@ -13,39 +18,151 @@ namespace RayTracer
 
             virtual ~Material( ) = default;
 
-            virtual bool Scatter( const RayD& incomingRay, const HitRecord& rec, RgbD& attenuation, RayD& scatteredRay ) const
+            virtual bool Scatter( const RayR& incomingRay, const HitRecord& rec, RgbR& attenuation, RayR& scatteredRay, Sampler& sampler ) const
             {
                 return false;
             }
+
+            // Radiance emitted from the hit point back along the incoming ray.
+            virtual RgbR Emitted( const RayR& incomingRay, const HitRecord& hitRecord ) const
+            {
+                return RgbR( 0, 0, 0 );
+            }
+
+            // Materials that do not override EvaluateScattering and ScatteringPdf can only be sampled through Scatter, so
+            // lights are not sampled from them, as for mirrors.
+            virtual bool IsSpecular( ) const
+            {
+                return true;
+            }
+
+            // Scattering function times the cosine with the normal, for light arriving from the unit direction.
+            virtual RgbR EvaluateScattering( const RayR& incomingRay, const HitRecord& hitRecord, const Vec3R& direction ) const
+            {
+                return RgbR( 0, 0, 0 );
+            }
+
+            // Solid angle density with which Scatter picks the unit direction.
+            virtual RealType ScatteringPdf( const RayR& incomingRay, const HitRecord& hitRecord, const Vec3R& direction ) const
+            {
+                return 0;
+            }
     };
 
 
-    class Lambertian : public Material
+    class Lambertian final : public Material
     {
         private:
 
-            RgbD albedo;
+            RgbR albedo;
 
 
         public:
 
-            Lambertian( const RgbD& albedo );
+            Lambertian( const RgbR& albedo );
+
+            bool     Scatter( const RayR& incomingRay, const HitRecord& hitRecord, RgbR& attenuation, RayR& scatteredRay, Sampler& sampler ) const override;
 
-            bool Scatter( const RayD& incomingRay, const HitRecord& hitRecord, RgbD& attenuation, RayD& scatteredRay ) const override;
+            bool     IsSpecular( ) const override
+            {
+                return false;
+            }
+
+            RgbR     EvaluateScattering( const RayR& incomingRay, const HitRecord& hitRecord, const Vec3R& direction ) const override;
+
+            RealType ScatteringPdf( const RayR& incomingRay, const HitRecord& hitRecord, const Vec3R& direction ) const override;
     };
 
 
-    class Metal : public Material
+    class Metal final : public Material
     {
         public:
 
-            Metal( const RgbD& albedo );
+            Metal( const RgbR& albedo );
+
+            bool Scatter( const RayR& incomingRay, const HitRecord& hitRecord, RgbR& attenuation, RayR& scatteredRay, Sampler& sampler ) const override;
+
+        private:
+
+            RgbR albedo;
+    };
 
-            bool Scatter( const RayD& incomingRay, const HitRecord& hitRecord, RgbD& attenuation, RayD& scatteredRay ) const override;
 
+    // Emits radiance from its surface and absorbs all light. Add the emitting spheres to a LightList too, so that they
+    // are sampled directly.
+    class DiffuseLight final : public Material
+    {
         private:
 
-            RgbD albedo;
+            RgbR radiance;
+
+        public:
+
+            DiffuseLight( const RgbR& radiance );
+
+            RgbR Emitted( const RayR& incomingRay, const HitRecord& hitRecord ) const override;
+    };
+
+
+    // The built in materials are stored by value and dispatched without virtual calls. Other Material subclasses go
+    // through the SharedPointer alternative.
+    using MaterialVariant = std::variant<Lambertian, Metal, DiffuseLight, SharedPointer<Material>>;
+
+
+    // Materials of a scene, stored contiguously. Hittables store the MaterialId returned by Add, so that hit records carry
+    // a plain index rather than a reference counted pointer.
+    class MaterialTable
+    {
+        private:
+
+            std::vector<MaterialVariant> materials;
+
+            // Calls function with the material as its concrete type. The built in materials are final, so their member
+            // calls are direct and can be inlined.
+            template <typename Function>
+            decltype( auto ) Visit( MaterialId materialId, Function&& function ) const
+            {
+                return std::visit(
+                    [ & ]( const auto& material ) -> decltype( auto )
+                    {
+                        if constexpr ( std::is_same_v<std::decay_t<decltype( material )>, SharedPointer<Material>> )
+                        {
+                            return function( *material );
+                        }
+                        else
+                        {
+                            return function( material );
+                        }
+                    },
+                    materials[ materialId ] );
+            }
+
+        public:
+
+            MaterialId      Add( MaterialVariant material );
+
+            const Material& Get( MaterialId materialId ) const;
+
+            bool            Scatter( MaterialId materialId, const RayR& incomingRay, const HitRecord& hitRecord, RgbR& attenuation, RayR& scatteredRay, Sampler& sampler ) const;
+
+            RgbR            Emitted( MaterialId materialId, const RayR& incomingRay, const HitRecord& hitRecord ) const;
+
+            bool            IsSpecular( MaterialId materialId ) const;
+
+            RgbR            EvaluateScattering( MaterialId materialId, const RayR& incomingRay, const HitRecord& hitRecord, const Vec3R& direction ) const;
+
+            RealType        ScatteringPdf( MaterialId materialId, const RayR& incomingRay, const HitRecord& hitRecord, const Vec3R& direction ) const;
+
+            // Alternative index in MaterialVariant. Rays can be sorted by it to shade one material type at a time.
+            SizeType GetKind( MaterialId materialId ) const
+            {
+                return materials[ materialId ].index( );
+            }
+
+            SizeType GetSize( ) const
+            {
+                return materials.size( );
+            }
     };
 
 } // namespace RayTracer
\ No newline at end of file
@@ -0,0 +1,1258 @@
+#include "MeshReader.hpp"
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace RayTracer
+{
+
+    namespace
+    {
+        // Index of a missing texture coordinate or normal, or of a vertex that does not exist, which TriangleMesh drops.
+        constexpr uint32_t noIndex = std::numeric_limits<uint32_t>::max( );
+
+        bool IsSpace( char c )
+        {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        const char* SkipSpaces( const char* p, const char* end )
+        {
+            while ( p < end && IsSpace( *p ) )
+            {
+                p++;
+            }
+
+            return p;
+        }
+
+        const char* GetLineEnd( const char* p, const char* end )
+        {
+            const char* lineEnd = static_cast<const char*>( std::memchr( p, '\n', SizeType( end - p ) ) );
+
+            return lineEnd != nullptr ? lineEnd : end;
+        }
+
+        enum class PlyType
+        {
+            Int8,
+            UInt8,
+            Int16,
+            UInt16,
+            Int32,
+            UInt32,
+            Float32,
+            Float64,
+            Invalid,
+        };
+
+        struct PlyProperty
+        {
+                std::string name;
+                PlyType     type      = PlyType::Invalid; // Stays invalid if the property line is malformed.
+                PlyType     countType = PlyType::Invalid; // Lists only: type of the item count in front of the items.
+        };
+
+        struct PlyElement
+        {
+                std::string              name;
+                SizeType                 count = 0;
+                std::vector<PlyProperty> properties;
+        };
+
+        // A scalar property of a fixed size element, at offset within every record.
+        struct PlyField
+        {
+                SizeType offset = 0;
+                PlyType  type   = PlyType::Invalid;
+        };
+
+        PlyType GetPlyType( std::string_view name )
+        {
+            const std::pair<std::string_view, PlyType> names[] = {
+                { "char", PlyType::Int8 },      { "int8", PlyType::Int8 },       { "uchar", PlyType::UInt8 },   { "uint8", PlyType::UInt8 },
+                { "short", PlyType::Int16 },    { "int16", PlyType::Int16 },     { "ushort", PlyType::UInt16 }, { "uint16", PlyType::UInt16 },
+                { "int", PlyType::Int32 },      { "int32", PlyType::Int32 },     { "uint", PlyType::UInt32 },   { "uint32", PlyType::UInt32 },
+                { "float", PlyType::Float32 },  { "float32", PlyType::Float32 }, { "double", PlyType::Float64 }, { "float64", PlyType::Float64 },
+            };
+
+            for ( const auto& [ typeName, type ] : names )
+            {
+                if ( name == typeName )
+                {
+                    return type;
+                }
+            }
+
+            return PlyType::Invalid;
+        }
+
+        SizeType GetPlyTypeSize( PlyType type )
+        {
+            switch ( type )
+            {
+                case PlyType::Int8:
+                case PlyType::UInt8:
+                    return 1;
+                case PlyType::Int16:
+                case PlyType::UInt16:
+                    return 2;
+                case PlyType::Int32:
+                case PlyType::UInt32:
+                case PlyType::Float32:
+                    return 4;
+                case PlyType::Float64:
+                    return 8;
+                default:
+                    return 0;
+            }
+        }
+
+        bool IsPlyInteger( PlyType type )
+        {
+            return type != PlyType::Float32 && type != PlyType::Float64 && type != PlyType::Invalid;
+        }
+
+        template <typename Type>
+        Type LoadPlyValue( const char* bytes, bool swapBytes )
+        {
+            char buffer[ sizeof( Type ) ];
+
+            if ( swapBytes )
+            {
+                std::reverse_copy( bytes, bytes + sizeof( Type ), buffer );
+            }
+            else
+            {
+                std::memcpy( buffer, bytes, sizeof( Type ) );
+            }
+
+            Type value;
+            std::memcpy( &value, buffer, sizeof( Type ) );
+
+            return value;
+        }
+
+        RealType ReadPlyReal( const char* bytes, PlyType type, bool swapBytes )
+        {
+            switch ( type )
+            {
+                case PlyType::Int8:
+                    return RealType( LoadPlyValue<int8_t>( bytes, swapBytes ) );
+                case PlyType::UInt8:
+                    return RealType( LoadPlyValue<uint8_t>( bytes, swapBytes ) );
+                case PlyType::Int16:
+                    return RealType( LoadPlyValue<int16_t>( bytes, swapBytes ) );
+                case PlyType::UInt16:
+                    return RealType( LoadPlyValue<uint16_t>( bytes, swapBytes ) );
+                case PlyType::Int32:
+                    return RealType( LoadPlyValue<int32_t>( bytes, swapBytes ) );
+                case PlyType::UInt32:
+                    return RealType( LoadPlyValue<uint32_t>( bytes, swapBytes ) );
+                case PlyType::Float32:
+                    return RealType( LoadPlyValue<float>( bytes, swapBytes ) );
+                case PlyType::Float64:
+                    return RealType( LoadPlyValue<double>( bytes, swapBytes ) );
+                default:
+                    return 0;
+            }
+        }
+
+        // Of integer types only. Negative values become noIndex.
+        uint32_t ReadPlyIndex( const char* bytes, PlyType type, bool swapBytes )
+        {
+            int64_t value = 0;
+
+            switch ( type )
+            {
+                case PlyType::Int8:
+                    value = LoadPlyValue<int8_t>( bytes, swapBytes );
+                    break;
+                case PlyType::UInt8:
+                    value = LoadPlyValue<uint8_t>( bytes, swapBytes );
+                    break;
+                case PlyType::Int16:
+                    value = LoadPlyValue<int16_t>( bytes, swapBytes );
+                    break;
+                case PlyType::UInt16:
+                    value = LoadPlyValue<uint16_t>( bytes, swapBytes );
+                    break;
+                case PlyType::Int32:
+                    value = LoadPlyValue<int32_t>( bytes, swapBytes );
+                    break;
+                case PlyType::UInt32:
+                    value = LoadPlyValue<uint32_t>( bytes, swapBytes );
+                    break;
+                default:
+                    break;
+            }
+
+            return value < 0 ? noIndex : uint32_t( value );
+        }
+
+        // Elements and byte order of a binary PLY file, and the size of its header.
+        bool ReadPlyHeader( const char* data, SizeType size, std::vector<PlyElement>& elements, bool& swapBytes, SizeType& headerSize )
+        {
+            const char* end      = data + size;
+            bool        isBinary = false;
+
+            if ( size < 4 || std::memcmp( data, "ply", 3 ) != 0 || !( data[ 3 ] == '\n' || data[ 3 ] == '\r' ) )
+            {
+                return false;
+            }
+
+            for ( const char* line = GetLineEnd( data, end ) + 1; line < end; )
+            {
+                const char*                   lineEnd = GetLineEnd( line, end );
+                std::vector<std::string_view> tokens;
+
+                for ( const char* p = SkipSpaces( line, lineEnd ); p < lineEnd; p = SkipSpaces( p, lineEnd ) )
+                {
+                    const char* tokenEnd = p;
+
+                    while ( tokenEnd < lineEnd && !IsSpace( *tokenEnd ) )
+                    {
+                        tokenEnd++;
+                    }
+
+                    tokens.emplace_back( p, SizeType( tokenEnd - p ) );
+                    p = tokenEnd;
+                }
+
+                line = lineEnd < end ? lineEnd + 1 : end;
+
+                if ( tokens.empty( ) )
+                {
+                    continue;
+                }
+
+                if ( tokens[ 0 ] == "format" && tokens.size( ) >= 2 )
+                {
+                    std::endian order = tokens[ 1 ] == "binary_little_endian" ? std::endian::little : std::endian::big;
+
+                    isBinary          = tokens[ 1 ] == "binary_little_endian" || tokens[ 1 ] == "binary_big_endian";
+                    swapBytes         = order != std::endian::native;
+                }
+                else if ( tokens[ 0 ] == "element" && tokens.size( ) == 3 )
+                {
+                    PlyElement element;
+                    element.name = std::string( tokens[ 1 ] );
+
+                    if ( std::from_chars( tokens[ 2 ].data( ), tokens[ 2 ].data( ) + tokens[ 2 ].size( ), element.count ).ec != std::errc( ) )
+                    {
+                        return false;
+                    }
+
+                    elements.push_back( element );
+                }
+                else if ( tokens[ 0 ] == "property" && !elements.empty( ) )
+                {
+                    PlyProperty property;
+
+                    if ( tokens.size( ) == 5 && tokens[ 1 ] == "list" )
+                    {
+                        property.countType = GetPlyType( tokens[ 2 ] );
+                        property.type      = GetPlyType( tokens[ 3 ] );
+                        property.name      = std::string( tokens[ 4 ] );
+
+                        if ( !IsPlyInteger( property.countType ) )
+                        {
+                            return false;
+                        }
+                    }
+                    else if ( tokens.size( ) == 3 )
+                    {
+                        property.type = GetPlyType( tokens[ 1 ] );
+                        property.name = std::string( tokens[ 2 ] );
+                    }
+
+                    if ( property.type == PlyType::Invalid )
+                    {
+                        return false;
+                    }
+
+                    elements.back( ).properties.push_back( property );
+                }
+                else if ( tokens[ 0 ] == "end_header" )
+                {
+                    headerSize = SizeType( line - data );
+
+                    return isBinary;
+                }
+            }
+
+            return false;
+        }
+
+        // Size of every record of an element without lists, otherwise 0.
+        SizeType GetPlyStride( const PlyElement& element )
+        {
+            SizeType stride = 0;
+
+            for ( const PlyProperty& property : element.properties )
+            {
+                if ( property.countType != PlyType::Invalid )
+                {
+                    return 0;
+                }
+
+                stride += GetPlyTypeSize( property.type );
+            }
+
+            return stride;
+        }
+
+        PlyField FindPlyField( const PlyElement& element, std::string_view name )
+        {
+            PlyField field;
+
+            for ( const PlyProperty& property : element.properties )
+            {
+                if ( property.name == name )
+                {
+                    field.type = property.type;
+
+                    return field;
+                }
+
+                field.offset += GetPlyTypeSize( property.type );
+            }
+
+            return PlyField( );
+        }
+
+        // Moves record past one record of an element with lists, or returns false if it ends past end.
+        bool SkipPlyRecord( const PlyElement& element, const char*& record, const char* end, bool swapBytes )
+        {
+            for ( const PlyProperty& property : element.properties )
+            {
+                SizeType itemCount = 1;
+
+                if ( property.countType != PlyType::Invalid )
+                {
+                    if ( SizeType( end - record ) < GetPlyTypeSize( property.countType ) )
+                    {
+                        return false;
+                    }
+
+                    itemCount  = ReadPlyIndex( record, property.countType, swapBytes );
+                    record    += GetPlyTypeSize( property.countType );
+                }
+
+                if ( itemCount == noIndex || SizeType( end - record ) < itemCount * GetPlyTypeSize( property.type ) )
+                {
+                    return false;
+                }
+
+                record += itemCount * GetPlyTypeSize( property.type );
+            }
+
+            return true;
+        }
+
+        bool SkipPlyElement( const PlyElement& element, const char*& position, const char* end, bool swapBytes )
+        {
+            SizeType stride = GetPlyStride( element );
+
+            if ( stride > 0 || element.properties.empty( ) )
+            {
+                if ( element.count > SizeType( end - position ) / std::max( stride, SizeType( 1 ) ) )
+                {
+                    return false;
+                }
+
+                position += element.count * stride;
+
+                return true;
+            }
+
+            for ( SizeType i = 0; i < element.count; i++ )
+            {
+                if ( !SkipPlyRecord( element, position, end, swapBytes ) )
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        bool ReadPlyVertices( const PlyElement& element, const char*& position, const char* end, bool swapBytes, TriangleMeshData& data )
+        {
+            SizeType stride = GetPlyStride( element );
+
+            if ( stride == 0 || element.count > SizeType( std::numeric_limits<int>::max( ) ) || element.count > SizeType( end - position ) / stride )
+            {
+                return false;
+            }
+
+            PlyField x  = FindPlyField( element, "x" );
+            PlyField y  = FindPlyField( element, "y" );
+            PlyField z  = FindPlyField( element, "z" );
+            PlyField nx = FindPlyField( element, "nx" );
+            PlyField ny = FindPlyField( element, "ny" );
+            PlyField nz = FindPlyField( element, "nz" );
+            PlyField u;
+            PlyField v;
+
+            for ( auto [ uName, vName ] : { std::pair { "u", "v" }, std::pair { "s", "t" }, std::pair { "texture_u", "texture_v" }, std::pair { "texture_s", "texture_t" } } )
+            {
+                if ( u.type == PlyType::Invalid || v.type == PlyType::Invalid )
+                {
+                    u = FindPlyField( element, uName );
+                    v = FindPlyField( element, vName );
+                }
+            }
+
+            if ( x.type == PlyType::Invalid || y.type == PlyType::Invalid || z.type == PlyType::Invalid )
+            {
+                return false;
+            }
+
+            const bool hasNormals  = nx.type != PlyType::Invalid && ny.type != PlyType::Invalid && nz.type != PlyType::Invalid;
+            const bool hasTextures = u.type != PlyType::Invalid && v.type != PlyType::Invalid;
+            const int  count       = int( element.count );
+
+            data.positionX.resize( element.count );
+            data.positionY.resize( element.count );
+            data.positionZ.resize( element.count );
+
+            if ( hasNormals )
+            {
+                data.normalX.resize( element.count );
+                data.normalY.resize( element.count );
+                data.normalZ.resize( element.count );
+            }
+
+            if ( hasTextures )
+            {
+                data.textureU.resize( element.count );
+                data.textureV.resize( element.count );
+            }
+
+#pragma omp parallel for
+            for ( int i = 0; i < count; i++ )
+            {
+                const char* record = position + SizeType( i ) * stride;
+
+                data.positionX[ i ] = ReadPlyReal( record + x.offset, x.type, swapBytes );
+                data.positionY[ i ] = ReadPlyReal( record + y.offset, y.type, swapBytes );
+                data.positionZ[ i ] = ReadPlyReal( record + z.offset, z.type, swapBytes );
+
+                if ( hasNormals )
+                {
+                    data.normalX[ i ] = ReadPlyReal( record + nx.offset, nx.type, swapBytes );
+                    data.normalY[ i ] = ReadPlyReal( record + ny.offset, ny.type, swapBytes );
+                    data.normalZ[ i ] = ReadPlyReal( record + nz.offset, nz.type, swapBytes );
+                }
+
+                if ( hasTextures )
+                {
+                    data.textureU[ i ] = ReadPlyReal( record + u.offset, u.type, swapBytes );
+                    data.textureV[ i ] = ReadPlyReal( record + v.offset, v.type, swapBytes );
+                }
+            }
+
+            position += element.count * stride;
+
+            return true;
+        }
+
+        bool ReadPlyFaces( const PlyElement& element, const char*& position, const char* end, bool swapBytes, TriangleMeshData& data )
+        {
+            SizeType indexProperty = element.properties.size( );
+
+            for ( SizeType k = 0; k < element.properties.size( ); k++ )
+            {
+                const PlyProperty& property = element.properties[ k ];
+
+                if ( ( property.name == "vertex_indices" || property.name == "vertex_index" ) && property.countType != PlyType::Invalid && IsPlyInteger( property.type ) )
+                {
+                    indexProperty = k;
+                }
+            }
+
+            if ( indexProperty == element.properties.size( ) )
+            {
+                return false;
+            }
+
+            // If every face has the item counts of the first one, the records are of one size, and the faces are read in
+            // parallel. That they are is checked on the way: the first face that differs counts as a mismatch, and so do
+            // those after it, since they are then read at wrong offsets.
+            struct PlyList
+            {
+                    SizeType countOffset;
+                    PlyType  countType;
+                    SizeType itemCount;
+            };
+
+            std::vector<PlyList> lists;
+            SizeType             cornerCount = 0;
+            SizeType             indexOffset = 0;
+            SizeType             stride      = 0;
+
+            for ( SizeType k = 0; k < element.properties.size( ); k++ )
+            {
+                const PlyProperty& property  = element.properties[ k ];
+                SizeType           itemCount = 1;
+
+                if ( property.countType != PlyType::Invalid )
+                {
+                    if ( SizeType( end - position ) < stride + GetPlyTypeSize( property.countType ) )
+                    {
+                        return false;
+                    }
+
+                    itemCount  = ReadPlyIndex( position + stride, property.countType, swapBytes );
+                    lists.push_back( PlyList { stride, property.countType, itemCount } );
+                    stride    += GetPlyTypeSize( property.countType );
+                }
+
+                if ( itemCount == noIndex || itemCount > SizeType( end - position ) )
+                {
+                    return false;
+                }
+
+                if ( k == indexProperty )
+                {
+                    cornerCount = itemCount;
+                    indexOffset = stride;
+                }
+
+                stride += itemCount * GetPlyTypeSize( property.type );
+            }
+
+            const PlyType  indexType = element.properties[ indexProperty ].type;
+            const SizeType indexSize = GetPlyTypeSize( indexType );
+            const SizeType fanSize   = cornerCount >= 3 ? 3 * ( cornerCount - 2 ) : 0;
+
+            if ( element.count <= SizeType( std::numeric_limits<int>::max( ) ) && element.count <= SizeType( end - position ) / stride )
+            {
+                const int count      = int( element.count );
+                int       mismatches = 0;
+
+                data.indices.resize( element.count * fanSize );
+
+#pragma omp parallel for reduction( + : mismatches )
+                for ( int f = 0; f < count; f++ )
+                {
+                    const char* record = position + SizeType( f ) * stride;
+
+                    for ( const PlyList& list : lists )
+                    {
+                        mismatches += ReadPlyIndex( record + list.countOffset, list.countType, swapBytes ) != list.itemCount ? 1 : 0;
+                    }
+
+                    uint32_t* triangles = data.indices.data( ) + SizeType( f ) * fanSize;
+                    uint32_t  first     = ReadPlyIndex( record + indexOffset, indexType, swapBytes );
+
+                    for ( SizeType c = 2; c < cornerCount; c++ )
+                    {
+                        *triangles++ = first;
+                        *triangles++ = ReadPlyIndex( record + indexOffset + ( c - 1 ) * indexSize, indexType, swapBytes );
+                        *triangles++ = ReadPlyIndex( record + indexOffset + c * indexSize, indexType, swapBytes );
+                    }
+                }
+
+                if ( mismatches == 0 )
+                {
+                    position += element.count * stride;
+
+                    return true;
+                }
+            }
+
+            // Faces of different sizes, read one after the other.
+            data.indices.clear( );
+
+            for ( SizeType f = 0; f < element.count; f++ )
+            {
+                const char* record = position;
+
+                if ( !SkipPlyRecord( element, position, end, swapBytes ) )
+                {
+                    return false;
+                }
+
+                for ( SizeType k = 0; k < indexProperty; k++ )
+                {
+                    const PlyProperty& property  = element.properties[ k ];
+                    SizeType           itemCount = 1;
+
+                    if ( property.countType != PlyType::Invalid )
+                    {
+                        itemCount  = ReadPlyIndex( record, property.countType, swapBytes );
+                        record    += GetPlyTypeSize( property.countType );
+                    }
+
+                    record += itemCount * GetPlyTypeSize( property.type );
+                }
+
+                SizeType faceCornerCount  = ReadPlyIndex( record, element.properties[ indexProperty ].countType, swapBytes );
+                record                   += GetPlyTypeSize( element.properties[ indexProperty ].countType );
+
+                for ( SizeType c = 2; c < faceCornerCount; c++ )
+                {
+                    data.indices.push_back( ReadPlyIndex( record, indexType, swapBytes ) );
+                    data.indices.push_back( ReadPlyIndex( record + ( c - 1 ) * indexSize, indexType, swapBytes ) );
+                    data.indices.push_back( ReadPlyIndex( record + c * indexSize, indexType, swapBytes ) );
+                }
+            }
+
+            return true;
+        }
+
+        enum class ObjLine
+        {
+            Position,
+            TextureCoordinate,
+            Normal,
+            Face,
+            Other,
+        };
+
+        // Type of the line at p, and p moved past its keyword.
+        ObjLine GetObjLine( const char*& p, const char* lineEnd )
+        {
+            p = SkipSpaces( p, lineEnd );
+
+            auto isKeyword = [ & ]( std::string_view keyword )
+            {
+                if ( SizeType( lineEnd - p ) > keyword.size( ) && std::string_view( p, keyword.size( ) ) == keyword && IsSpace( p[ keyword.size( ) ] ) )
+                {
+                    p += keyword.size( );
+
+                    return true;
+                }
+
+                return false;
+            };
+
+            if ( isKeyword( "v" ) )
+            {
+                return ObjLine::Position;
+            }
+
+            if ( isKeyword( "vt" ) )
+            {
+                return ObjLine::TextureCoordinate;
+            }
+
+            if ( isKeyword( "vn" ) )
+            {
+                return ObjLine::Normal;
+            }
+
+            return isKeyword( "f" ) ? ObjLine::Face : ObjLine::Other;
+        }
+
+        // Returns nullptr if there is no number at p, or if p is nullptr, so that the numbers of a line are parsed in a row
+        // and checked once.
+        const char* ParseObjReal( const char* p, const char* lineEnd, RealType& value )
+        {
+            if ( p == nullptr )
+            {
+                return nullptr;
+            }
+
+            p = SkipSpaces( p, lineEnd );
+
+            if ( p < lineEnd && *p == '+' )
+            {
+                p++;
+            }
+
+            auto [ next, error ] = std::from_chars( p, lineEnd, value );
+
+            return error == std::errc( ) ? next : nullptr;
+        }
+
+        // One based index of an element of count elements read so far, negative if relative to count, into a zero based
+        // one. Zero and out of range indices become noIndex.
+        const char* ParseObjIndex( const char* p, const char* lineEnd, SizeType count, uint32_t& index )
+        {
+            int64_t value        = 0;
+            auto [ next, error ] = std::from_chars( p, lineEnd, value );
+            int64_t zeroBased    = value < 0 ? int64_t( count ) + value : value - 1;
+
+            index                = zeroBased >= 0 && zeroBased < int64_t( noIndex ) ? uint32_t( zeroBased ) : noIndex;
+
+            return error == std::errc( ) ? next : nullptr;
+        }
+
+        // Lines of an OBJ file parsed by one thread. The counts are found first, and give where the elements of the chunk
+        // go in the arrays of the whole file.
+        struct ObjChunk
+        {
+                const char* begin                  = nullptr;
+                const char* end                    = nullptr;
+
+                SizeType    positionCount          = 0;
+                SizeType    textureCoordinateCount = 0;
+                SizeType    normalCount            = 0;
+                SizeType    triangleCount          = 0;
+
+                SizeType    firstPosition          = 0;
+                SizeType    firstTextureCoordinate = 0;
+                SizeType    firstNormal            = 0;
+                SizeType    firstTriangle          = 0;
+
+                bool        isValid                = true;
+        };
+
+        void CountObjChunk( ObjChunk& chunk )
+        {
+            for ( const char* line = chunk.begin; line < chunk.end; )
+            {
+                const char* lineEnd = GetLineEnd( line, chunk.end );
+                const char* p       = line;
+
+                switch ( GetObjLine( p, lineEnd ) )
+                {
+                    case ObjLine::Position:
+                        chunk.positionCount++;
+                        break;
+                    case ObjLine::TextureCoordinate:
+                        chunk.textureCoordinateCount++;
+                        break;
+                    case ObjLine::Normal:
+                        chunk.normalCount++;
+                        break;
+                    case ObjLine::Face:
+                    {
+                        SizeType cornerCount = 0;
+
+                        for ( p = SkipSpaces( p, lineEnd ); p < lineEnd; p = SkipSpaces( p, lineEnd ) )
+                        {
+                            while ( p < lineEnd && !IsSpace( *p ) )
+                            {
+                                p++;
+                            }
+
+                            cornerCount++;
+                        }
+
+                        chunk.triangleCount += cornerCount >= 3 ? cornerCount - 2 : 0;
+                        break;
+                    }
+                    default:
+                        break;
+                }
+
+                line = lineEnd < chunk.end ? lineEnd + 1 : chunk.end;
+            }
+        }
+
+        // The elements of an OBJ file, indexed separately by the corners of the faces.
+        struct ObjElements
+        {
+                std::vector<RealType> textureU;
+                std::vector<RealType> textureV;
+                std::vector<RealType> normalX;
+                std::vector<RealType> normalY;
+                std::vector<RealType> normalZ;
+
+                // Per corner of the triangles, as data.indices for the positions. Empty if the file has none.
+                std::vector<uint32_t> textureCoordinateIndices;
+                std::vector<uint32_t> normalIndices;
+        };
+
+        void ParseObjChunk( ObjChunk& chunk, TriangleMeshData& data, ObjElements& elements )
+        {
+            SizeType              position          = chunk.firstPosition;
+            SizeType              textureCoordinate = chunk.firstTextureCoordinate;
+            SizeType              normal            = chunk.firstNormal;
+            SizeType              corner            = 3 * chunk.firstTriangle;
+
+            std::vector<uint32_t> face[ 3 ];
+
+            for ( const char* line = chunk.begin; line < chunk.end && chunk.isValid; )
+            {
+                const char* lineEnd = GetLineEnd( line, chunk.end );
+                const char* p       = line;
+
+                line                = lineEnd < chunk.end ? lineEnd + 1 : chunk.end;
+
+                switch ( GetObjLine( p, lineEnd ) )
+                {
+                    case ObjLine::Position:
+                        p             = ParseObjReal( p, lineEnd, data.positionX[ position ] );
+                        p             = ParseObjReal( p, lineEnd, data.positionY[ position ] );
+                        p             = ParseObjReal( p, lineEnd, data.positionZ[ position ] );
+                        chunk.isValid = p != nullptr;
+                        position++;
+                        break;
+
+                    case ObjLine::TextureCoordinate:
+                        // The second coordinate is optional.
+                        p                                      = ParseObjReal( p, lineEnd, elements.textureU[ textureCoordinate ] );
+                        chunk.isValid                          = p != nullptr;
+                        elements.textureV[ textureCoordinate ] = 0;
+                        ParseObjReal( p, lineEnd, elements.textureV[ textureCoordinate ] );
+                        textureCoordinate++;
+                        break;
+
+                    case ObjLine::Normal:
+                        p             = ParseObjReal( p, lineEnd, elements.normalX[ normal ] );
+                        p             = ParseObjReal( p, lineEnd, elements.normalY[ normal ] );
+                        p             = ParseObjReal( p, lineEnd, elements.normalZ[ normal ] );
+                        chunk.isValid = p != nullptr;
+                        normal++;
+                        break;
+
+                    case ObjLine::Face:
+                    {
+                        // Corners are v, v/vt, v//vn or v/vt/vn.
+                        for ( auto& indices : face )
+                        {
+                            indices.clear( );
+                        }
+
+                        for ( p = SkipSpaces( p, lineEnd ); p < lineEnd && chunk.isValid; p = SkipSpaces( p, lineEnd ) )
+                        {
+                            uint32_t indices[ 3 ] = { noIndex, noIndex, noIndex };
+                            SizeType counts[ 3 ]  = { position, textureCoordinate, normal };
+
+                            p                     = ParseObjIndex( p, lineEnd, counts[ 0 ], indices[ 0 ] );
+
+                            for ( SizeType k = 1; k < 3 && p != nullptr && p < lineEnd && *p == '/'; k++ )
+                            {
+                                p++;
+
+                                if ( p < lineEnd && *p != '/' && !IsSpace( *p ) )
+                                {
+                                    p = ParseObjIndex( p, lineEnd, counts[ k ], indices[ k ] );
+                                }
+                            }
+
+                            chunk.isValid = p != nullptr && ( p == lineEnd || IsSpace( *p ) );
+
+                            for ( SizeType k = 0; k < 3; k++ )
+                            {
+                                face[ k ].push_back( indices[ k ] );
+                            }
+                        }
+
+                        for ( SizeType c = 2; c < face[ 0 ].size( ); c++ )
+                        {
+                            for ( SizeType k : { SizeType( 0 ), c - 1, c } )
+                            {
+                                data.indices[ corner ] = face[ 0 ][ k ];
+
+                                if ( !elements.textureCoordinateIndices.empty( ) )
+                                {
+                                    elements.textureCoordinateIndices[ corner ] = face[ 1 ][ k ];
+                                }
+
+                                if ( !elements.normalIndices.empty( ) )
+                                {
+                                    elements.normalIndices[ corner ] = face[ 2 ][ k ];
+                                }
+
+                                corner++;
+                            }
+                        }
+
+                        break;
+                    }
+
+                    default:
+                        break;
+                }
+            }
+        }
+
+        // Position, texture coordinate and normal of a corner.
+        struct ObjVertex
+        {
+                uint32_t position;
+                uint32_t textureCoordinate;
+                uint32_t normal;
+
+                bool     operator==( const ObjVertex& ) const = default;
+        };
+
+        struct ObjVertexHash
+        {
+                SizeType operator( )( const ObjVertex& vertex ) const
+                {
+                    return std::hash<uint64_t>( )( ( uint64_t( vertex.position ) << 32 ) ^ ( uint64_t( vertex.textureCoordinate ) << 16 ) ^ vertex.normal );
+                }
+        };
+
+        // Triangles per chunk of MergeObjVertices.
+        constexpr SizeType objMergeChunkSize = SizeType( 1 ) << 14;
+
+        // Corners of a chunk of triangles whose vertex is a copy of a position, with the distinct copies in the order they
+        // first appear.
+        struct ObjMergeChunk
+        {
+                std::vector<SizeType>  corners;
+                std::vector<uint32_t>  cornerCopies; // Per corner, into copies.
+                std::vector<ObjVertex> copies;
+        };
+
+        // Gives every corner a single index, as TriangleMesh expects. Files that use the same index for the position, the
+        // texture coordinates and the normal of every corner need no new vertices. Otherwise a position keeps its index for
+        // the texture coordinates and normal of the first corner that uses it, and is copied to a new vertex for every other
+        // pair, which happens along the seams of the texture and the creases of the normals. Chunks of triangles find their
+        // copies in parallel, and only these are merged in file order, so the copies are numbered as by one pass over the
+        // corners whatever the number of threads.
+        void MergeObjVertices( const ObjElements& elements, TriangleMeshData& data )
+        {
+            const bool             hasTextureCoordinates = !elements.textureCoordinateIndices.empty( );
+            const bool             hasNormals            = !elements.normalIndices.empty( );
+            const SizeType         positionCount         = data.GetVertexCount( );
+            const int              triangleCount         = int( data.GetTriangleCount( ) );
+
+            std::vector<ObjVertex> vertices( positionCount );
+            int                    differingCorners      = 0;
+
+            auto                   getVertex             = [ & ]( SizeType corner )
+            {
+                ObjVertex vertex { data.indices[ corner ], hasTextureCoordinates ? elements.textureCoordinateIndices[ corner ] : noIndex, hasNormals ? elements.normalIndices[ corner ] : noIndex };
+
+                vertex.textureCoordinate = vertex.textureCoordinate < elements.textureU.size( ) ? vertex.textureCoordinate : noIndex;
+                vertex.normal            = vertex.normal < elements.normalX.size( ) ? vertex.normal : noIndex;
+
+                return vertex;
+            };
+
+#pragma omp parallel for reduction( + : differingCorners )
+            for ( int triangle = 0; triangle < triangleCount; triangle++ )
+            {
+                for ( SizeType corner = 3 * SizeType( triangle ); corner < 3 * SizeType( triangle ) + 3; corner++ )
+                {
+                    differingCorners += ( hasTextureCoordinates && elements.textureCoordinateIndices[ corner ] != data.indices[ corner ] )
+                                              || ( hasNormals && elements.normalIndices[ corner ] != data.indices[ corner ] )
+                                          ? 1
+                                          : 0;
+                }
+            }
+
+            if ( differingCorners == 0 )
+            {
+#pragma omp parallel for
+                for ( int i = 0; i < int( positionCount ); i++ )
+                {
+                    vertices[ i ] = ObjVertex { uint32_t( i ), uint32_t( i ) < elements.textureU.size( ) ? uint32_t( i ) : noIndex, uint32_t( i ) < elements.normalX.size( ) ? uint32_t( i ) : noIndex };
+                }
+            }
+            else
+            {
+                // The first corner of every position. Corners past the positions are marked, since the copies appended to
+                // the positions could make their indices valid.
+                std::vector<std::atomic<uint64_t>> firstCorners( positionCount );
+
+#pragma omp parallel for
+                for ( int i = 0; i < int( positionCount ); i++ )
+                {
+                    firstCorners[ i ].store( std::numeric_limits<uint64_t>::max( ), std::memory_order_relaxed );
+                }
+
+#pragma omp parallel for
+                for ( int triangle = 0; triangle < triangleCount; triangle++ )
+                {
+                    for ( SizeType corner = 3 * SizeType( triangle ); corner < 3 * SizeType( triangle ) + 3; corner++ )
+                    {
+                        if ( data.indices[ corner ] >= positionCount )
+                        {
+                            data.indices[ corner ] = noIndex;
+                            continue;
+                        }
+
+                        std::atomic<uint64_t>& first = firstCorners[ data.indices[ corner ] ];
+                        uint64_t               value = first.load( std::memory_order_relaxed );
+
+                        while ( corner < value && !first.compare_exchange_weak( value, corner, std::memory_order_relaxed ) )
+                        {
+                        }
+                    }
+                }
+
+#pragma omp parallel for
+                for ( int i = 0; i < int( positionCount ); i++ )
+                {
+                    uint64_t first = firstCorners[ i ].load( std::memory_order_relaxed );
+
+                    vertices[ i ]  = first != std::numeric_limits<uint64_t>::max( ) ? getVertex( SizeType( first ) ) : ObjVertex { noIndex, noIndex, noIndex };
+                }
+
+                const int                  chunkCount = int( ( SizeType( triangleCount ) + objMergeChunkSize - 1 ) / objMergeChunkSize );
+                std::vector<ObjMergeChunk> chunks( chunkCount );
+
+#pragma omp parallel
+                {
+                    std::unordered_map<ObjVertex, uint32_t, ObjVertexHash> chunkCopies;
+
+#pragma omp for schedule( dynamic )
+                    for ( int c = 0; c < chunkCount; c++ )
+                    {
+                        ObjMergeChunk& chunk = chunks[ c ];
+                        SizeType       begin = 3 * SizeType( c ) * objMergeChunkSize;
+                        SizeType       end   = 3 * std::min( SizeType( triangleCount ), SizeType( c + 1 ) * objMergeChunkSize );
+
+                        chunkCopies.clear( );
+
+                        for ( SizeType corner = begin; corner < end; corner++ )
+                        {
+                            ObjVertex vertex = getVertex( corner );
+
+                            if ( vertex.position >= positionCount || vertices[ vertex.position ] == vertex )
+                            {
+                                continue;
+                            }
+
+                            auto [ copy, isNew ] = chunkCopies.try_emplace( vertex, uint32_t( chunk.copies.size( ) ) );
+
+                            if ( isNew )
+                            {
+                                chunk.copies.push_back( vertex );
+                            }
+
+                            chunk.corners.push_back( corner );
+                            chunk.cornerCopies.push_back( copy->second );
+                        }
+                    }
+                }
+
+                std::unordered_map<ObjVertex, uint32_t, ObjVertexHash> copies;
+                std::vector<uint32_t>                                  copyIndices;
+
+                for ( const ObjMergeChunk& chunk : chunks )
+                {
+                    copyIndices.resize( chunk.copies.size( ) );
+
+                    for ( SizeType k = 0; k < chunk.copies.size( ); k++ )
+                    {
+                        auto [ copy, isNew ] = copies.try_emplace( chunk.copies[ k ], uint32_t( vertices.size( ) ) );
+
+                        if ( isNew )
+                        {
+                            vertices.push_back( chunk.copies[ k ] );
+                        }
+
+                        copyIndices[ k ] = copy->second;
+                    }
+
+                    for ( SizeType k = 0; k < chunk.corners.size( ); k++ )
+                    {
+                        data.indices[ chunk.corners[ k ] ] = copyIndices[ chunk.cornerCopies[ k ] ];
+                    }
+                }
+            }
+
+            const int vertexCount = int( vertices.size( ) );
+
+            data.positionX.resize( vertices.size( ) );
+            data.positionY.resize( vertices.size( ) );
+            data.positionZ.resize( vertices.size( ) );
+            data.textureU.resize( hasTextureCoordinates ? vertices.size( ) : 0 );
+            data.textureV.resize( hasTextureCoordinates ? vertices.size( ) : 0 );
+            data.normalX.resize( hasNormals ? vertices.size( ) : 0 );
+            data.normalY.resize( hasNormals ? vertices.size( ) : 0 );
+            data.normalZ.resize( hasNormals ? vertices.size( ) : 0 );
+
+            // Corners without texture coordinates or normals get zeros, and the mesh shades them with the geometric normal.
+#pragma omp parallel for
+            for ( int i = 0; i < vertexCount; i++ )
+            {
+                const ObjVertex& vertex = vertices[ i ];
+
+                if ( SizeType( i ) >= positionCount )
+                {
+                    data.positionX[ i ] = data.positionX[ vertex.position ];
+                    data.positionY[ i ] = data.positionY[ vertex.position ];
+                    data.positionZ[ i ] = data.positionZ[ vertex.position ];
+                }
+
+                if ( hasTextureCoordinates )
+                {
+                    data.textureU[ i ] = vertex.textureCoordinate != noIndex ? elements.textureU[ vertex.textureCoordinate ] : 0;
+                    data.textureV[ i ] = vertex.textureCoordinate != noIndex ? elements.textureV[ vertex.textureCoordinate ] : 0;
+                }
+
+                if ( hasNormals )
+                {
+                    data.normalX[ i ] = vertex.normal != noIndex ? elements.normalX[ vertex.normal ] : 0;
+                    data.normalY[ i ] = vertex.normal != noIndex ? elements.normalY[ vertex.normal ] : 0;
+                    data.normalZ[ i ] = vertex.normal != noIndex ? elements.normalZ[ vertex.normal ] : 0;
+                }
+            }
+        }
+    } // namespace
+
+    bool ReadPly( const char* fileName, TriangleMeshData& data )
+    {
+        data = TriangleMeshData( );
+
+        MappedFile              file;
+        std::vector<PlyElement> elements;
+        bool                    swapBytes  = false;
+        SizeType                headerSize = 0;
+
+        if ( !file.Open( fileName ) || !ReadPlyHeader( file.GetData( ), file.GetSize( ), elements, swapBytes, headerSize ) )
+        {
+            return false;
+        }
+
+        const char* position = file.GetData( ) + headerSize;
+        const char* end      = file.GetData( ) + file.GetSize( );
+        bool        isValid  = true;
+
+        for ( const PlyElement& element : elements )
+        {
+            if ( element.name == "vertex" )
+            {
+                isValid = ReadPlyVertices( element, position, end, swapBytes, data );
+            }
+            else if ( element.name == "face" )
+            {
+                isValid = ReadPlyFaces( element, position, end, swapBytes, data );
+            }
+            else
+            {
+                isValid = SkipPlyElement( element, position, end, swapBytes );
+            }
+
+            if ( !isValid )
+            {
+                data = TriangleMeshData( );
+
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool ReadObj( const char* fileName, TriangleMeshData& data )
+    {
+        data = TriangleMeshData( );
+
+        MappedFile file;
+
+        if ( !file.Open( fileName ) )
+        {
+            return false;
+        }
+
+        if ( file.GetSize( ) == 0 )
+        {
+            return true;
+        }
+
+        // Chunks of about 4 MB, which gives every thread several of a large file, so that they stay busy when some chunks
+        // take longer to parse than others.
+        const char*           end        = file.GetData( ) + file.GetSize( );
+        const SizeType        chunkCount = std::max( SizeType( 1 ), file.GetSize( ) >> 22 );
+        std::vector<ObjChunk> chunks( chunkCount );
+
+        for ( SizeType c = 0; c < chunkCount; c++ )
+        {
+            const char* begin   = c == 0 ? file.GetData( ) : chunks[ c - 1 ].end;
+            const char* lineEnd = GetLineEnd( std::max( begin, file.GetData( ) + file.GetSize( ) * ( c + 1 ) / chunkCount ), end );
+
+            chunks[ c ].begin   = begin;
+            chunks[ c ].end     = lineEnd < end ? lineEnd + 1 : end;
+        }
+
+#pragma omp parallel for schedule( dynamic )
+        for ( int c = 0; c < int( chunkCount ); c++ )
+        {
+            CountObjChunk( chunks[ c ] );
+        }
+
+        ObjChunk totals;
+
+        for ( ObjChunk& chunk : chunks )
+        {
+            chunk.firstPosition            = totals.positionCount;
+            chunk.firstTextureCoordinate   = totals.textureCoordinateCount;
+            chunk.firstNormal              = totals.normalCount;
+            chunk.firstTriangle            = totals.triangleCount;
+
+            totals.positionCount          += chunk.positionCount;
+            totals.textureCoordinateCount += chunk.textureCoordinateCount;
+            totals.normalCount            += chunk.normalCount;
+            totals.triangleCount          += chunk.triangleCount;
+        }
+
+        // The threads count the vertices and triangles with int, as OpenMP 2 requires.
+        if ( totals.positionCount > SizeType( std::numeric_limits<int>::max( ) ) || totals.triangleCount > SizeType( std::numeric_limits<int>::max( ) ) )
+        {
+            return false;
+        }
+
+        ObjElements elements;
+
+        data.positionX.resize( totals.positionCount );
+        data.positionY.resize( totals.positionCount );
+        data.positionZ.resize( totals.positionCount );
+        data.indices.resize( 3 * totals.triangleCount );
+        elements.textureU.resize( totals.textureCoordinateCount );
+        elements.textureV.resize( totals.textureCoordinateCount );
+        elements.normalX.resize( totals.normalCount );
+        elements.normalY.resize( totals.normalCount );
+        elements.normalZ.resize( totals.normalCount );
+        elements.textureCoordinateIndices.resize( totals.textureCoordinateCount > 0 ? 3 * totals.triangleCount : 0 );
+        elements.normalIndices.resize( totals.normalCount > 0 ? 3 * totals.triangleCount : 0 );
+
+        int invalidChunks = 0;
+
+#pragma omp parallel for schedule( dynamic ) reduction( + : invalidChunks )
+        for ( int c = 0; c < int( chunkCount ); c++ )
+        {
+            ParseObjChunk( chunks[ c ], data, elements );
+            invalidChunks += chunks[ c ].isValid ? 0 : 1;
+        }
+
+        if ( invalidChunks > 0 )
+        {
+            data = TriangleMeshData( );
+
+            return false;
+        }
+
+        if ( !elements.textureCoordinateIndices.empty( ) || !elements.normalIndices.empty( ) )
+        {
+            MergeObjVertices( elements, data );
+        }
+
+        return true;
+    }
+
+    bool ReadMesh( const char* fileName, TriangleMeshData& data )
+    {
+        std::string_view name      = fileName;
+        std::string      extension = std::string( name.substr( std::min( name.rfind( '.' ), name.size( ) ) ) );
+
+        std::transform( extension.begin( ), extension.end( ), extension.begin( ), []( unsigned char c ) { return char( std::tolower( c ) ); } );
+
+        if ( extension == ".ply" )
+        {
+            return ReadPly( fileName, data );
+        }
+
+        if ( extension == ".obj" )
+        {
+            return ReadObj( fileName, data );
+        }
+
+        data = TriangleMeshData( );
+
+        return false;
+    }
+
+} // namespace RayTracer
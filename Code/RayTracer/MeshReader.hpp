@@ -0,0 +1,25 @@
+#pragma once
+
+#include "TriangleMesh.hpp"
+
+namespace RayTracer
+{
+
+    // Readers of mesh files into TriangleMeshData, for a TriangleMesh. The files are mapped into memory and parsed by all
+    // threads into the final arrays. Polygons are split into fans of triangles. The readers return false if the file
+    // cannot be opened or is malformed, and leave data empty then.
+
+    // Binary PLY, either byte order. Reads the vertex element, with x, y and z, and nx, ny and nz, and u and v (or s and t)
+    // if all of them are present, and the vertex_indices (or vertex_index) lists of the face element. Other elements and
+    // properties are skipped. Faces that are all triangles, as written by most tools, are read in parallel.
+    bool ReadPly( const char* fileName, TriangleMeshData& data );
+
+    // Wavefront OBJ. Reads the v, vt and vn lines and the f lines, with relative (negative) indices, and ignores the
+    // others. The file is split into chunks at line ends, which threads first count and then parse. Corners that pair a
+    // position with different texture coordinates or normals become separate vertices.
+    bool ReadObj( const char* fileName, TriangleMeshData& data );
+
+    // ReadPly or ReadObj, chosen by the extension of fileName.
+    bool ReadMesh( const char* fileName, TriangleMeshData& data );
+
+} // namespace RayTracer
@@ -0,0 +1,179 @@
+#include "PathState.hpp"
+
+#include "omp.h"
+
+namespace RayTracer
+{
+
+    void PathStates::Resize( SizeType size )
+    {
+        for ( auto* array : { &pixelX, &pixelY, &sampleIndices, &dimensions } )
+        {
+            array->resize( size );
+        }
+
+        for ( auto* array : { &originX, &originY, &originZ, &directionX, &directionY, &directionZ, &radianceR, &radianceG, &radianceB, &throughputR, &throughputG, &throughputB, &scatteringPdfs, &scatteringPointX, &scatteringPointY, &scatteringPointZ,
+                              &shadowOriginX, &shadowOriginY, &shadowOriginZ, &shadowDirectionX, &shadowDirectionY, &shadowDirectionZ, &shadowContributionR, &shadowContributionG, &shadowContributionB } )
+        {
+            array->resize( size );
+        }
+
+        for ( auto* array : { &sampledLights, &hits, &binKeys, &shadowBinKeys } )
+        {
+            array->resize( size );
+        }
+
+        hitRecords.resize( size );
+    }
+
+    RayR PathStates::GetRay( SizeType slot ) const
+    {
+        return RayR( Point3R { originX[ slot ], originY[ slot ], originZ[ slot ] }, Vec3R { directionX[ slot ], directionY[ slot ], directionZ[ slot ] } );
+    }
+
+    void PathStates::SetRay( SizeType slot, const RayR& ray )
+    {
+        originX[ slot ]    = ray.GetOrigin( )[ 0 ];
+        originY[ slot ]    = ray.GetOrigin( )[ 1 ];
+        originZ[ slot ]    = ray.GetOrigin( )[ 2 ];
+        directionX[ slot ] = ray.GetDirection( )[ 0 ];
+        directionY[ slot ] = ray.GetDirection( )[ 1 ];
+        directionZ[ slot ] = ray.GetDirection( )[ 2 ];
+    }
+
+    PathState PathStates::GetState( SizeType slot ) const
+    {
+        PathState state;
+        state.radiance        = RgbR( radianceR[ slot ], radianceG[ slot ], radianceB[ slot ] );
+        state.throughput      = RgbR( throughputR[ slot ], throughputG[ slot ], throughputB[ slot ] );
+        state.scatteringPdf   = scatteringPdfs[ slot ];
+        state.sampledLights   = sampledLights[ slot ] != 0;
+        state.scatteringPoint = Point3R { scatteringPointX[ slot ], scatteringPointY[ slot ], scatteringPointZ[ slot ] };
+
+        return state;
+    }
+
+    void PathStates::SetState( SizeType slot, const PathState& state )
+    {
+        radianceR[ slot ]        = state.radiance.r;
+        radianceG[ slot ]        = state.radiance.g;
+        radianceB[ slot ]        = state.radiance.b;
+        throughputR[ slot ]      = state.throughput.r;
+        throughputG[ slot ]      = state.throughput.g;
+        throughputB[ slot ]      = state.throughput.b;
+        scatteringPdfs[ slot ]   = state.scatteringPdf;
+        sampledLights[ slot ]    = state.sampledLights ? 1 : 0;
+        scatteringPointX[ slot ] = state.scatteringPoint[ 0 ];
+        scatteringPointY[ slot ] = state.scatteringPoint[ 1 ];
+        scatteringPointZ[ slot ] = state.scatteringPoint[ 2 ];
+    }
+
+    RayR PathStates::GetShadowRay( SizeType slot ) const
+    {
+        return RayR( Point3R { shadowOriginX[ slot ], shadowOriginY[ slot ], shadowOriginZ[ slot ] }, Vec3R { shadowDirectionX[ slot ], shadowDirectionY[ slot ], shadowDirectionZ[ slot ] } );
+    }
+
+    RgbR PathStates::GetShadowContribution( SizeType slot ) const
+    {
+        return RgbR( shadowContributionR[ slot ], shadowContributionG[ slot ], shadowContributionB[ slot ] );
+    }
+
+    void PathStates::SetShadowRay( SizeType slot, const ShadowRay& shadowRay )
+    {
+        shadowOriginX[ slot ]       = shadowRay.ray.GetOrigin( )[ 0 ];
+        shadowOriginY[ slot ]       = shadowRay.ray.GetOrigin( )[ 1 ];
+        shadowOriginZ[ slot ]       = shadowRay.ray.GetOrigin( )[ 2 ];
+        shadowDirectionX[ slot ]    = shadowRay.ray.GetDirection( )[ 0 ];
+        shadowDirectionY[ slot ]    = shadowRay.ray.GetDirection( )[ 1 ];
+        shadowDirectionZ[ slot ]    = shadowRay.ray.GetDirection( )[ 2 ];
+        shadowContributionR[ slot ] = shadowRay.contribution.r;
+        shadowContributionG[ slot ] = shadowRay.contribution.g;
+        shadowContributionB[ slot ] = shadowRay.contribution.b;
+    }
+
+    void PathStates::AddRadiance( SizeType slot, const RgbR& radiance )
+    {
+        radianceR[ slot ] += radiance.r;
+        radianceG[ slot ] += radiance.g;
+        radianceB[ slot ] += radiance.b;
+    }
+
+    void PathStates::CopyPath( SizeType slot, const PathStates& source, SizeType sourceSlot )
+    {
+        pixelX[ slot ]           = source.pixelX[ sourceSlot ];
+        pixelY[ slot ]           = source.pixelY[ sourceSlot ];
+        sampleIndices[ slot ]    = source.sampleIndices[ sourceSlot ];
+        dimensions[ slot ]       = source.dimensions[ sourceSlot ];
+
+        originX[ slot ]          = source.originX[ sourceSlot ];
+        originY[ slot ]          = source.originY[ sourceSlot ];
+        originZ[ slot ]          = source.originZ[ sourceSlot ];
+        directionX[ slot ]       = source.directionX[ sourceSlot ];
+        directionY[ slot ]       = source.directionY[ sourceSlot ];
+        directionZ[ slot ]       = source.directionZ[ sourceSlot ];
+
+        radianceR[ slot ]        = source.radianceR[ sourceSlot ];
+        radianceG[ slot ]        = source.radianceG[ sourceSlot ];
+        radianceB[ slot ]        = source.radianceB[ sourceSlot ];
+        throughputR[ slot ]      = source.throughputR[ sourceSlot ];
+        throughputG[ slot ]      = source.throughputG[ sourceSlot ];
+        throughputB[ slot ]      = source.throughputB[ sourceSlot ];
+        scatteringPdfs[ slot ]   = source.scatteringPdfs[ sourceSlot ];
+        scatteringPointX[ slot ] = source.scatteringPointX[ sourceSlot ];
+        scatteringPointY[ slot ] = source.scatteringPointY[ sourceSlot ];
+        scatteringPointZ[ slot ] = source.scatteringPointZ[ sourceSlot ];
+        sampledLights[ slot ]    = source.sampledLights[ sourceSlot ];
+    }
+
+    void SortPaths( const std::vector<uint32_t>& paths, const std::vector<uint8_t>& keys, SizeType binCount, std::vector<uint32_t>& sortedPaths, std::vector<SizeType>& binStarts )
+    {
+        const int             maxThreadCount = omp_get_max_threads( );
+
+        // Per thread counts of every bin, which become the positions where the thread moves its paths of the bin.
+        std::vector<SizeType> positions( SizeType( maxThreadCount ) * binCount, 0 );
+
+        sortedPaths.resize( paths.size( ) );
+        binStarts.assign( binCount + 1, 0 );
+
+#pragma omp parallel num_threads( maxThreadCount )
+        {
+            const SizeType threadCount     = SizeType( omp_get_num_threads( ) );
+            const SizeType thread          = SizeType( omp_get_thread_num( ) );
+            const SizeType first           = paths.size( ) * thread / threadCount;
+            const SizeType last            = paths.size( ) * ( thread + 1 ) / threadCount;
+            SizeType*      threadPositions = &positions[ thread * binCount ];
+
+            for ( SizeType p = first; p < last; p++ )
+            {
+                threadPositions[ keys[ paths[ p ] ] ]++;
+            }
+
+#pragma omp barrier
+#pragma omp single
+            {
+                // Bin by bin, and within a bin thread by thread, which keeps the order of paths.
+                SizeType position = 0;
+
+                for ( SizeType bin = 0; bin < binCount; bin++ )
+                {
+                    binStarts[ bin ] = position;
+
+                    for ( SizeType t = 0; t < threadCount; t++ )
+                    {
+                        SizeType count                  = positions[ t * binCount + bin ];
+                        positions[ t * binCount + bin ] = position;
+                        position                       += count;
+                    }
+                }
+
+                binStarts[ binCount ] = position;
+            }
+
+            for ( SizeType p = first; p < last; p++ )
+            {
+                sortedPaths[ threadPositions[ keys[ paths[ p ] ] ]++ ] = paths[ p ];
+            }
+        }
+    }
+
+} // namespace RayTracer
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "Algebra.hpp"
+#include "Color.hpp"
+#include "Common.hpp"
+#include "Hittable.hpp"
+#include "Ray.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace RayTracer
+{
+
+    // What a path carries from one bounce to the next, see Camera::ShadeHit.
+    struct PathState
+    {
+            RgbR     radiance   = RgbR( 0, 0, 0 );
+            RgbR     throughput = RgbR( 1, 1, 1 );
+
+            // Density of the last scatter direction and whether lights were also sampled there, for the weight of the light
+            // hit by it.
+            RealType scatteringPdf = 0;
+            bool     sampledLights = false;
+            Point3R  scatteringPoint { 0.0, 0.0, 0.0 };
+    };
+
+    // Light sample of a path, which adds contribution to its radiance unless ray is occluded before it reaches the light.
+    struct ShadowRay
+    {
+            RayR ray;
+            RgbR contribution;
+            bool isValid = false;
+    };
+
+    // Octant of a direction, from the signs of its components. Rays of the same octant visit the children of BVH nodes
+    // in the same order.
+    inline uint8_t GetOctant( const Vec3R& direction )
+    {
+        return uint8_t( ( direction[ 0 ] < 0 ? 1 : 0 ) | ( direction[ 1 ] < 0 ? 2 : 0 ) | ( direction[ 2 ] < 0 ? 4 : 0 ) );
+    }
+
+    // The paths in flight of Camera::RenderWavefront, one slot each, in structure of arrays layout so that every stage
+    // streams through the arrays it needs only. Hit records stay whole, since the materials take them as a unit. The
+    // paths are compacted into a second PathStates at every bounce, with CopyPath.
+    struct PathStates
+    {
+            // Pixel and sample index of every path, to resume its sampler.
+            std::vector<uint32_t>  pixelX;
+            std::vector<uint32_t>  pixelY;
+            std::vector<uint32_t>  sampleIndices;
+            std::vector<uint32_t>  dimensions;
+
+            std::vector<RealType>  originX;
+            std::vector<RealType>  originY;
+            std::vector<RealType>  originZ;
+            std::vector<RealType>  directionX;
+            std::vector<RealType>  directionY;
+            std::vector<RealType>  directionZ;
+
+            std::vector<RealType>  radianceR;
+            std::vector<RealType>  radianceG;
+            std::vector<RealType>  radianceB;
+            std::vector<RealType>  throughputR;
+            std::vector<RealType>  throughputG;
+            std::vector<RealType>  throughputB;
+            std::vector<RealType>  scatteringPdfs;
+            std::vector<RealType>  scatteringPointX;
+            std::vector<RealType>  scatteringPointY;
+            std::vector<RealType>  scatteringPointZ;
+            std::vector<uint8_t>   sampledLights;
+
+            std::vector<uint8_t>   hits;
+            std::vector<HitRecord> hitRecords;
+
+            std::vector<RealType>  shadowOriginX;
+            std::vector<RealType>  shadowOriginY;
+            std::vector<RealType>  shadowOriginZ;
+            std::vector<RealType>  shadowDirectionX;
+            std::vector<RealType>  shadowDirectionY;
+            std::vector<RealType>  shadowDirectionZ;
+            std::vector<RealType>  shadowContributionR;
+            std::vector<RealType>  shadowContributionG;
+            std::vector<RealType>  shadowContributionB;
+
+            // Bins of the path and of its shadow ray in the next SortPaths.
+            std::vector<uint8_t>   binKeys;
+            std::vector<uint8_t>   shadowBinKeys;
+
+            void                   Resize( SizeType size );
+
+            RayR                   GetRay( SizeType slot ) const;
+
+            void                   SetRay( SizeType slot, const RayR& ray );
+
+            PathState              GetState( SizeType slot ) const;
+
+            void                   SetState( SizeType slot, const PathState& state );
+
+            RayR                   GetShadowRay( SizeType slot ) const;
+
+            RgbR                   GetShadowContribution( SizeType slot ) const;
+
+            void                   SetShadowRay( SizeType slot, const ShadowRay& shadowRay );
+
+            void                   AddRadiance( SizeType slot, const RgbR& radiance );
+
+            // Copies what the path in sourceSlot of source carries from one bounce to the next into slot. Its hit and
+            // shadow ray are left behind, as the next bounce finds new ones.
+            void                   CopyPath( SizeType slot, const PathStates& source, SizeType sourceSlot );
+    };
+
+    // Stable counting sort of the slots in paths by keys[ slot ], which must be less than binCount. Bin b of sortedPaths is
+    // sortedPaths[ binStarts[ b ] ] to sortedPaths[ binStarts[ b + 1 ] - 1 ]. Threads count and move their own part of
+    // paths, so the sort does not hold up the stages around it.
+    void SortPaths( const std::vector<uint32_t>& paths, const std::vector<uint8_t>& keys, SizeType binCount, std::vector<uint32_t>& sortedPaths, std::vector<SizeType>& binStarts );
+
+} // namespace RayTracer
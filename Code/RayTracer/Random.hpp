@@ -0,0 +1,112 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace RayTracer
+{
+
+    // Finalizer of splitmix64. Turns structured integers such as pixel indices into well distributed seeds.
+    inline uint64_t MixBits( uint64_t v )
+    {
+        v ^= v >> 31;
+        v *= 0x7fb5d329728ea185ULL;
+        v ^= v >> 27;
+        v *= 0x81dadef4bc2dd44dULL;
+        v ^= v >> 33;
+
+        return v;
+    }
+
+    // Permuted congruential generator (PCG32, O'Neill 2014). Its state is two integers, so a generator is created per
+    // pixel or per thread instead of sharing global state between threads the way std::rand does.
+    class Pcg32
+    {
+        private:
+
+            uint64_t state     = 0x853c49e6748fea9bULL;
+            uint64_t increment = 0xda3e39cb94b95bdbULL;
+
+        public:
+
+            Pcg32( )
+            {
+            }
+
+            Pcg32( uint64_t sequenceIndex, uint64_t seed = 0x853c49e6748fea9bULL )
+            {
+                SetSequence( sequenceIndex, seed );
+            }
+
+            // Generators with different sequence indices produce independent streams.
+            void SetSequence( uint64_t sequenceIndex, uint64_t seed )
+            {
+                state     = 0;
+                increment = ( sequenceIndex << 1 ) | 1;
+                NextUInt32( );
+                state += seed;
+                NextUInt32( );
+            }
+
+            uint32_t NextUInt32( )
+            {
+                uint64_t oldState   = state;
+                state               = oldState * 0x5851f42d4c957f2dULL + increment;
+
+                uint32_t xorShifted = uint32_t( ( ( oldState >> 18 ) ^ oldState ) >> 27 );
+                uint32_t rotation   = uint32_t( oldState >> 59 );
+
+                return ( xorShifted >> rotation ) | ( xorShifted << ( ( ~rotation + 1 ) & 31 ) );
+            }
+
+            // Skips delta numbers, or goes back if delta is negative, in O(log delta) steps (Brown 1994, "Random Number
+            // Generation with Arbitrary Strides").
+            void Advance( int64_t delta )
+            {
+                uint64_t multiplier            = 0x5851f42d4c957f2dULL;
+                uint64_t addend                = increment;
+                uint64_t accumulatedMultiplier = 1;
+                uint64_t accumulatedAddend     = 0;
+
+                for ( uint64_t steps = uint64_t( delta ); steps > 0; steps >>= 1 )
+                {
+                    if ( steps & 1 )
+                    {
+                        accumulatedMultiplier *= multiplier;
+                        accumulatedAddend      = accumulatedAddend * multiplier + addend;
+                    }
+
+                    addend      = ( multiplier + 1 ) * addend;
+                    multiplier *= multiplier;
+                }
+
+                state = accumulatedMultiplier * state + accumulatedAddend;
+            }
+
+            // Uniform in [0, 1).
+            template <typename T>
+            T NextReal( )
+            {
+                constexpr T oneMinusEpsilon = T( 1 ) - std::numeric_limits<T>::epsilon( ) / T( 2 );
+
+                return std::min( oneMinusEpsilon, T( NextUInt32( ) ) * T( 0x1p-32 ) );
+            }
+    };
+
+    template <typename T>
+    inline T RandomReal( Pcg32& rng )
+    {
+        return rng.NextReal<T>( );
+    }
+
+    template <typename T>
+    inline T RandomReal( Pcg32& rng, T min, T max )
+    {
+        return min + ( max - min ) * RandomReal<T>( rng );
+    }
+
+} // namespace RayTracer
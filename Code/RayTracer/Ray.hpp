@@ -2,6 +2,9 @@
 
 #include "Algebra.hpp"
 
+#include <cmath>
+#include <limits>
+
 namespace RayTracer
 {
 
@@ -40,10 +43,45 @@ namespace RayTracer
     };
 
 
+    // Origin for a ray leaving a surface point towards direction. The true point lies within pointError of every
+    // coordinate of point, so the origin is moved along the normal, on the side of direction, past the box of possible
+    // points, and then rounded away from the surface. The ray can then start at t = 0 without hitting the surface it
+    // leaves, at any scale and in either precision, where a fixed minimum t is too short for single precision far from
+    // the origin and needlessly long close to it.
+    template <typename Type>
+    Point<Type, 3> OffsetRayOrigin( const Point<Type, 3>& point, Type pointError, const Vec<Type, 3>& normal, const Vec<Type, 3>& direction )
+    {
+        Type distance = pointError * ( std::abs( normal[ 0 ] ) + std::abs( normal[ 1 ] ) + std::abs( normal[ 2 ] ) );
+
+        if ( Dot( direction, normal ) < 0 )
+        {
+            distance = -distance;
+        }
+
+        Vec<Type, 3>   offset = distance * normal;
+        Point<Type, 3> origin = point + offset;
+
+        for ( SizeType i = 0; i < 3; i++ )
+        {
+            if ( offset[ i ] > 0 )
+            {
+                origin[ i ] = std::nextafter( origin[ i ], std::numeric_limits<Type>::infinity( ) );
+            }
+            else if ( offset[ i ] < 0 )
+            {
+                origin[ i ] = std::nextafter( origin[ i ], -std::numeric_limits<Type>::infinity( ) );
+            }
+        }
+
+        return origin;
+    }
+
+
     extern template class Ray<float>;
     extern template class Ray<double>;
 
     using RayF = Ray<float>;
     using RayD = Ray<double>;
+    using RayR = Ray<RealType>;
 
 } // namespace RayTracer
\ No newline at end of file
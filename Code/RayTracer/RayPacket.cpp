@@ -0,0 +1,146 @@
+#include "RayPacket.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+
+namespace RayTracer
+{
+
+    namespace
+    {
+        // Range of a * b over a in [aMin, aMax] and b in [bMin, bMax], which is reached at the corners.
+        void ProductRange( RealType aMin, RealType aMax, RealType bMin, RealType bMax, RealType& low, RealType& high )
+        {
+            RealType p0 = aMin * bMin;
+            RealType p1 = aMin * bMax;
+            RealType p2 = aMax * bMin;
+            RealType p3 = aMax * bMax;
+
+            low         = std::min( std::min( p0, p1 ), std::min( p2, p3 ) );
+            high        = std::max( std::max( p0, p1 ), std::max( p2, p3 ) );
+        }
+    } // namespace
+
+    PacketCoverage RayPacketBounds::Classify( const AabbR& box, RealType earliestEnd ) const
+    {
+        if ( !isValid )
+        {
+            return PacketCoverage::Some;
+        }
+
+        // The entry of every ray into the box lies between the latest of the lower and the latest of the upper bounds of
+        // its entries into the three slabs, and its exit likewise between the earliest bounds of its exits.
+        RealType entryLow  = tFrom;
+        RealType entryHigh = tFrom;
+        RealType exitLow   = earliestEnd;
+        RealType exitHigh  = tTo;
+
+        for ( SizeType axis = 0; axis < 3; axis++ )
+        {
+            RealType nearPlane = directionIsNegative[ axis ] ? box.GetMax( )[ axis ] : box.GetMin( )[ axis ];
+            RealType farPlane  = directionIsNegative[ axis ] ? box.GetMin( )[ axis ] : box.GetMax( )[ axis ];
+            RealType low;
+            RealType high;
+
+            ProductRange( nearPlane - originMax[ axis ], nearPlane - originMin[ axis ], inverseDirectionMin[ axis ], inverseDirectionMax[ axis ], low, high );
+            entryLow  = std::max( entryLow, low );
+            entryHigh = std::max( entryHigh, high );
+
+            ProductRange( farPlane - originMax[ axis ], farPlane - originMin[ axis ], inverseDirectionMin[ axis ], inverseDirectionMax[ axis ], low, high );
+            exitLow   = std::min( exitLow, low );
+            exitHigh  = std::min( exitHigh, high );
+        }
+
+        if ( entryLow > exitHigh )
+        {
+            return PacketCoverage::None;
+        }
+
+        // Rays that start late are let through as well, they are tested again further down.
+        return entryHigh <= exitLow ? PacketCoverage::All : PacketCoverage::Some;
+    }
+
+    void RayPacket::SetRay( SizeType lane, const RayR& ray, const IntervalR& rayParameterInterval )
+    {
+        originX[ lane ]    = ray.GetOrigin( )[ 0 ];
+        originY[ lane ]    = ray.GetOrigin( )[ 1 ];
+        originZ[ lane ]    = ray.GetOrigin( )[ 2 ];
+        directionX[ lane ] = ray.GetDirection( )[ 0 ];
+        directionY[ lane ] = ray.GetDirection( )[ 1 ];
+        directionZ[ lane ] = ray.GetDirection( )[ 2 ];
+        tFrom[ lane ]      = rayParameterInterval.GetFrom( );
+        tTo[ lane ]        = rayParameterInterval.GetTo( );
+    }
+
+    RayR RayPacket::GetRay( SizeType lane ) const
+    {
+        return RayR( Point3R { originX[ lane ], originY[ lane ], originZ[ lane ] }, Vec3R { directionX[ lane ], directionY[ lane ], directionZ[ lane ] } );
+    }
+
+    RealType RayPacket::GetEarliestEnd( LaneMask activeMask ) const
+    {
+        RealType earliestEnd = std::numeric_limits<RealType>::infinity( );
+
+        for ( SizeType lane = 0; lane < Size; lane++ )
+        {
+            if ( activeMask & ( 1u << lane ) )
+            {
+                earliestEnd = std::min( earliestEnd, tTo[ lane ] );
+            }
+        }
+
+        return earliestEnd;
+    }
+
+    RayPacketBounds RayPacket::GetBounds( LaneMask activeMask ) const
+    {
+        constexpr RealType infinity = std::numeric_limits<RealType>::infinity( );
+
+        RayPacketBounds    bounds;
+        bounds.isValid                  = activeMask != 0;
+        bounds.tFrom                    = infinity;
+        bounds.tTo                      = -infinity;
+
+        const SizeType  firstLane       = activeMask != 0 ? SizeType( std::countr_zero( activeMask ) ) : 0;
+        const RealType* origins[ 3 ]    = { originX, originY, originZ };
+        const RealType* directions[ 3 ] = { directionX, directionY, directionZ };
+
+        for ( SizeType axis = 0; axis < 3; axis++ )
+        {
+            bounds.directionIsNegative[ axis ] = directions[ axis ][ firstLane ] < 0;
+            bounds.originMin[ axis ]           = infinity;
+            bounds.originMax[ axis ]           = -infinity;
+            bounds.inverseDirectionMin[ axis ] = infinity;
+            bounds.inverseDirectionMax[ axis ] = -infinity;
+        }
+
+        for ( SizeType lane = 0; lane < Size; lane++ )
+        {
+            if ( !( activeMask & ( 1u << lane ) ) )
+            {
+                continue;
+            }
+
+            for ( SizeType axis = 0; axis < 3; axis++ )
+            {
+                RealType inverseDirection          = 1 / directions[ axis ][ lane ];
+
+                // The range of 1 / d is only an interval if d keeps its sign, and infinite bounds would make NaN products.
+                bounds.isValid                     = bounds.isValid && std::isfinite( inverseDirection ) && ( directions[ axis ][ lane ] < 0 ) == bounds.directionIsNegative[ axis ];
+
+                bounds.originMin[ axis ]           = std::min( bounds.originMin[ axis ], origins[ axis ][ lane ] );
+                bounds.originMax[ axis ]           = std::max( bounds.originMax[ axis ], origins[ axis ][ lane ] );
+                bounds.inverseDirectionMin[ axis ] = std::min( bounds.inverseDirectionMin[ axis ], inverseDirection );
+                bounds.inverseDirectionMax[ axis ] = std::max( bounds.inverseDirectionMax[ axis ], inverseDirection );
+            }
+
+            bounds.tFrom = std::min( bounds.tFrom, tFrom[ lane ] );
+            bounds.tTo   = std::max( bounds.tTo, tTo[ lane ] );
+        }
+
+        return bounds;
+    }
+
+} // namespace RayTracer
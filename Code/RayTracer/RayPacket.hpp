@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Aabb.hpp"
+#include "Common.hpp"
+#include "Interval.hpp"
+#include "Ray.hpp"
+
+#include <cstdint>
+
+#if !defined( RAYTRACER_RAY_PACKET_SIZE )
+#    define RAYTRACER_RAY_PACKET_SIZE 8
+#endif
+
+namespace RayTracer
+{
+
+    // Rays per packet, chosen with the RAYTRACER_RAY_PACKET_SIZE build option. Camera traces the primary rays of blocks
+    // of rayPacketWidth x rayPacketHeight pixels as one packet.
+    constexpr SizeType rayPacketSize   = RAYTRACER_RAY_PACKET_SIZE;
+    constexpr SizeType rayPacketWidth  = rayPacketSize == 4 ? 2 : 4;
+    constexpr SizeType rayPacketHeight = rayPacketSize / rayPacketWidth;
+
+    static_assert( rayPacketSize == 4 || rayPacketSize == 8 || rayPacketSize == 16, "Ray packets hold 4, 8 or 16 rays" );
+
+    // One bit per lane of a RayPacket.
+    using LaneMask = uint32_t;
+
+    // Which of the rays of a packet pass through a box, see RayPacketBounds::Classify.
+    enum class PacketCoverage
+    {
+        None, // No ray hits the box.
+        Some, // The rays have to be tested one by one.
+        All,  // Every ray hits the box.
+    };
+
+    // Ranges of the origins and inverse directions of the active rays of a packet, which bound the slab test of a box
+    // for all of them at once (interval arithmetic, Boulos et al. 2007). Valid only if the direction signs of the rays
+    // agree on every axis, as for the primary rays of a pixel block, otherwise every box is classified Some.
+    struct RayPacketBounds
+    {
+            bool           isValid;
+            bool           directionIsNegative[ 3 ];
+            RealType       originMin[ 3 ];
+            RealType       originMax[ 3 ];
+            RealType       inverseDirectionMin[ 3 ];
+            RealType       inverseDirectionMax[ 3 ];
+            RealType       tFrom; // Earliest start of the intervals of the rays.
+            RealType       tTo;   // Latest end of the intervals of the rays.
+
+            // earliestEnd is the smallest tTo of the rays at the time of the test, which shrinks as hits are found.
+            PacketCoverage Classify( const AabbR& box, RealType earliestEnd ) const;
+    };
+
+    // Rays traced together, in structure of arrays layout so that primitives test several of them with one Simd sequence.
+    // Every lane has its own interval, and IntersectPacket lowers tTo of the lanes it hits to their closest hit so far,
+    // as Intersect does with the interval it is passed.
+    struct RayPacket
+    {
+            static constexpr SizeType Size = rayPacketSize;
+
+            alignas( 64 ) RealType originX[ Size ];
+            alignas( 64 ) RealType originY[ Size ];
+            alignas( 64 ) RealType originZ[ Size ];
+            alignas( 64 ) RealType directionX[ Size ];
+            alignas( 64 ) RealType directionY[ Size ];
+            alignas( 64 ) RealType directionZ[ Size ];
+            alignas( 64 ) RealType tFrom[ Size ];
+            alignas( 64 ) RealType tTo[ Size ];
+
+            void            SetRay( SizeType lane, const RayR& ray, const IntervalR& rayParameterInterval );
+
+            RayR            GetRay( SizeType lane ) const;
+
+            IntervalR       GetInterval( SizeType lane ) const
+            {
+                return IntervalR( tFrom[ lane ], tTo[ lane ] );
+            }
+
+            RayPacketBounds GetBounds( LaneMask activeMask ) const;
+
+            // Smallest tTo of the active lanes.
+            RealType        GetEarliestEnd( LaneMask activeMask ) const;
+    };
+
+} // namespace RayTracer
@@ -0,0 +1,537 @@
+#include "Sampler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace RayTracer
+{
+
+    namespace
+    {
+        constexpr RealType oneMinusEpsilon = RealType( 1 ) - std::numeric_limits<RealType>::epsilon( ) / RealType( 2 );
+
+        uint64_t           HashPixel( SizeType i, SizeType j, uint64_t seed )
+        {
+            return MixBits( ( uint64_t( j ) << 32 | uint64_t( i ) ) ^ MixBits( seed + 0x9e3779b97f4a7c15ULL ) );
+        }
+
+        uint64_t HashDimension( uint64_t pixelSeed, uint32_t dimension )
+        {
+            return MixBits( pixelSeed ^ MixBits( uint64_t( dimension ) + 1 ) );
+        }
+
+        // Samples are computed in double and rounded to RealType, which can round values just below 1 up to 1.
+        RealType ToReal( double v )
+        {
+            return std::min( oneMinusEpsilon, RealType( v ) );
+        }
+
+        RealType ToUnit( uint32_t v )
+        {
+            return ToReal( double( v ) * 0x1p-32 );
+        }
+
+        uint32_t ReverseBits( uint32_t v )
+        {
+            v = ( ( v >> 1 ) & 0x55555555u ) | ( ( v & 0x55555555u ) << 1 );
+            v = ( ( v >> 2 ) & 0x33333333u ) | ( ( v & 0x33333333u ) << 2 );
+            v = ( ( v >> 4 ) & 0x0f0f0f0fu ) | ( ( v & 0x0f0f0f0fu ) << 4 );
+            v = ( ( v >> 8 ) & 0x00ff00ffu ) | ( ( v & 0x00ff00ffu ) << 8 );
+
+            return ( v >> 16 ) | ( v << 16 );
+        }
+
+        // Element index of a random permutation of [0, n) selected by seed, without storing the permutation (Kensler 2013,
+        // "Correlated Multi-Jittered Sampling").
+        uint32_t PermutationElement( uint32_t index, uint32_t n, uint32_t seed )
+        {
+            uint32_t w = n - 1;
+            w |= w >> 1;
+            w |= w >> 2;
+            w |= w >> 4;
+            w |= w >> 8;
+            w |= w >> 16;
+
+            do
+            {
+                index ^= seed;
+                index *= 0xe170893du;
+                index ^= seed >> 16;
+                index ^= ( index & w ) >> 4;
+                index ^= seed >> 8;
+                index *= 0x0929eb3fu;
+                index ^= seed >> 23;
+                index ^= ( index & w ) >> 1;
+                index *= 1 | seed >> 27;
+                index *= 0x6935fa69u;
+                index ^= ( index & w ) >> 11;
+                index *= 0x74dcb303u;
+                index ^= ( index & w ) >> 2;
+                index *= 0x9e501cc3u;
+                index ^= ( index & w ) >> 2;
+                index *= 0xc860a3dfu;
+                index &= w;
+                index ^= index >> 5;
+            } while ( index >= n );
+
+            return ( index + seed ) % n;
+        }
+
+        // Owen scrambling of the bits of v, most significant first, as a hash (Burley 2020).
+        uint32_t NestedUniformScramble( uint32_t v, uint32_t seed )
+        {
+            v  = ReverseBits( v );
+
+            v += seed;
+            v ^= v * 0x6c50b47cu;
+            v ^= v * 0xb82f1e52u;
+            v ^= v * 0xc7afe638u;
+            v ^= v * 0x8d22f6e6u;
+
+            return ReverseBits( v );
+        }
+
+        // The second Sobol dimension; the first is the bit reversed index.
+        uint32_t SobolSecondDimension( uint32_t index )
+        {
+            uint32_t v      = 0x80000000u;
+            uint32_t result = 0;
+
+            for ( ; index != 0; index >>= 1, v ^= v >> 1 )
+            {
+                if ( index & 1 )
+                {
+                    result ^= v;
+                }
+            }
+
+            return result;
+        }
+
+        constexpr uint32_t primes[] = { 2,   3,   5,   7,   11,  13,  17,  19,  23,  29,  31,  37,  41,  43,  47,  53,
+                                        59,  61,  67,  71,  73,  79,  83,  89,  97,  101, 103, 107, 109, 113, 127, 131,
+                                        137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193, 197, 199, 211, 223,
+                                        227, 229, 233, 239, 241, 251, 257, 263, 269, 271, 277, 281, 283, 293, 307, 311 };
+
+        constexpr uint32_t primeCount = uint32_t( sizeof( primes ) / sizeof( primes[ 0 ] ) );
+
+        // Radical inverse with every digit passed through a random permutation that depends on the digits below it.
+        RealType ScrambledRadicalInverse( uint64_t index, uint32_t base, uint64_t seed )
+        {
+            const double inverseBase = 1.0 / double( base );
+            double       scale       = 1.0;
+            double       result      = 0.0;
+            uint64_t     prefix      = 0;
+
+            // Continue past the last nonzero digit for as long as the digits still change the double result.
+            while ( scale * inverseBase > std::numeric_limits<double>::epsilon( ) )
+            {
+                uint32_t digit     = uint32_t( index % base );
+                uint32_t permuted  = PermutationElement( digit, base, uint32_t( MixBits( seed ^ prefix ) ) );
+
+                scale             *= inverseBase;
+                result            += double( permuted ) * scale;
+                prefix             = prefix * base + digit + 1;
+                index             /= base;
+            }
+
+            return ToReal( result );
+        }
+
+        std::vector<float> GenerateBlueNoiseMask( SizeType size )
+        {
+            const SizeType mask  = size - 1;
+            const SizeType n     = size * size;
+            const double   sigma = 1.5;
+
+            // Gaussian energy of a point at a toroidal offset.
+            std::vector<double> kernel( n );
+
+            for ( SizeType y = 0; y < size; y++ )
+            {
+                for ( SizeType x = 0; x < size; x++ )
+                {
+                    double dx                = double( std::min( x, size - x ) );
+                    double dy                = double( std::min( y, size - y ) );
+
+                    kernel[ y * size + x ] = std::exp( -( dx * dx + dy * dy ) / ( 2.0 * sigma * sigma ) );
+                }
+            }
+
+            std::vector<uint8_t> pattern( n, 0 );
+            std::vector<double>  energy( n, 0.0 );
+
+            auto                 splat = [ & ]( SizeType index, double sign )
+            {
+                SizeType x0 = index % size;
+                SizeType y0 = index / size;
+
+                for ( SizeType y = 0; y < size; y++ )
+                {
+                    for ( SizeType x = 0; x < size; x++ )
+                    {
+                        energy[ y * size + x ] += sign * kernel[ ( ( y - y0 ) & mask ) * size + ( ( x - x0 ) & mask ) ];
+                    }
+                }
+            };
+
+            auto find = [ & ]( uint8_t value, bool tightestCluster )
+            {
+                SizeType best = n;
+
+                for ( SizeType k = 0; k < n; k++ )
+                {
+                    if ( pattern[ k ] == value && ( best == n || ( tightestCluster ? energy[ k ] > energy[ best ] : energy[ k ] < energy[ best ] ) ) )
+                    {
+                        best = k;
+                    }
+                }
+
+                return best;
+            };
+
+            // Initial binary pattern: random points, relaxed by moving the tightest cluster into the largest void.
+            Pcg32    rng( 0x626c7565 );
+            SizeType onesCount = n / 10;
+
+            for ( SizeType placed = 0; placed < onesCount; )
+            {
+                SizeType k = rng.NextUInt32( ) % n;
+
+                if ( pattern[ k ] == 0 )
+                {
+                    pattern[ k ] = 1;
+                    splat( k, 1.0 );
+                    placed++;
+                }
+            }
+
+            for ( ;; )
+            {
+                SizeType cluster   = find( 1, true );
+                pattern[ cluster ] = 0;
+                splat( cluster, -1.0 );
+
+                SizeType largestVoid = find( 0, false );
+                pattern[ largestVoid ] = 1;
+                splat( largestVoid, 1.0 );
+
+                if ( largestVoid == cluster )
+                {
+                    break;
+                }
+            }
+
+            const std::vector<uint8_t> initialPattern = pattern;
+            const std::vector<double>  initialEnergy  = energy;
+
+            std::vector<SizeType>      ranks( n );
+
+            // Ranks below the initial pattern: remove the tightest clusters.
+            for ( SizeType rank = onesCount; rank-- > 0; )
+            {
+                SizeType cluster   = find( 1, true );
+                pattern[ cluster ] = 0;
+                splat( cluster, -1.0 );
+                ranks[ cluster ]   = rank;
+            }
+
+            // Ranks up to half: fill the largest voids.
+            pattern = initialPattern;
+            energy  = initialEnergy;
+
+            SizeType rank = onesCount;
+
+            for ( ; rank < n / 2; rank++ )
+            {
+                SizeType largestVoid   = find( 0, false );
+                pattern[ largestVoid ] = 1;
+                splat( largestVoid, 1.0 );
+                ranks[ largestVoid ]   = rank;
+            }
+
+            // Remaining ranks: the zeros are now the minority, so fill the tightest clusters of zeros.
+            std::fill( energy.begin( ), energy.end( ), 0.0 );
+
+            for ( SizeType k = 0; k < n; k++ )
+            {
+                if ( pattern[ k ] == 0 )
+                {
+                    splat( k, 1.0 );
+                }
+            }
+
+            for ( ; rank < n; rank++ )
+            {
+                SizeType cluster   = find( 0, true );
+                pattern[ cluster ] = 1;
+                splat( cluster, -1.0 );
+                ranks[ cluster ]   = rank;
+            }
+
+            std::vector<float> result( n );
+
+            for ( SizeType k = 0; k < n; k++ )
+            {
+                result[ k ] = float( ( double( ranks[ k ] ) + 0.5 ) / double( n ) );
+            }
+
+            return result;
+        }
+    } // namespace
+
+    //
+    // IndependentSampler
+    //
+    SharedPointer<Sampler> IndependentSampler::Clone( ) const
+    {
+        return std::make_shared<IndependentSampler>( *this );
+    }
+
+    void IndependentSampler::StartPixelSample( SizeType i, SizeType j, SizeType sampleIndex, uint64_t seed )
+    {
+        rng.SetSequence( HashPixel( i, j, seed ), MixBits( sampleIndex ) );
+        dimension = 0;
+    }
+
+    RealType IndependentSampler::Get1D( )
+    {
+        dimension++;
+
+        return rng.NextReal<RealType>( );
+    }
+
+    Point2R IndependentSampler::Get2D( )
+    {
+        RealType u  = rng.NextReal<RealType>( );
+        RealType v  = rng.NextReal<RealType>( );
+        dimension  += 2;
+
+        return Point2R { u, v };
+    }
+
+    uint32_t IndependentSampler::GetDimension( ) const
+    {
+        return dimension;
+    }
+
+    // Every dimension is one number of the generator.
+    void IndependentSampler::SetDimension( uint32_t dimension )
+    {
+        rng.Advance( int64_t( dimension ) - int64_t( this->dimension ) );
+        this->dimension = dimension;
+    }
+
+    //
+    // StratifiedSampler
+    //
+    StratifiedSampler::StratifiedSampler( SizeType samplesPerPixel ) : samplesPerPixel( std::max( SizeType( 1 ), samplesPerPixel ) )
+    {
+    }
+
+    SharedPointer<Sampler> StratifiedSampler::Clone( ) const
+    {
+        return std::make_shared<StratifiedSampler>( *this );
+    }
+
+    void StratifiedSampler::StartPixelSample( SizeType i, SizeType j, SizeType sampleIndex, uint64_t seed )
+    {
+        this->pixelSeed   = HashPixel( i, j, seed );
+        this->sampleIndex = sampleIndex;
+        this->dimension   = 0;
+
+        rng.SetSequence( pixelSeed, MixBits( sampleIndex ) );
+    }
+
+    RealType StratifiedSampler::Get1D( )
+    {
+        uint32_t n       = uint32_t( samplesPerPixel );
+        uint32_t stratum = PermutationElement( uint32_t( sampleIndex % n ), n, uint32_t( HashDimension( pixelSeed, dimension++ ) ) );
+
+        return ToReal( ( double( stratum ) + rng.NextReal<double>( ) ) / double( n ) );
+    }
+
+    Point2R StratifiedSampler::Get2D( )
+    {
+        uint32_t columns = uint32_t( std::ceil( std::sqrt( double( samplesPerPixel ) ) ) );
+        uint32_t rows    = uint32_t( ( samplesPerPixel + columns - 1 ) / columns );
+        uint32_t n       = columns * rows;
+
+        uint32_t stratum = PermutationElement( uint32_t( sampleIndex % n ), n, uint32_t( HashDimension( pixelSeed, dimension ) ) );
+        dimension       += 2;
+
+        double u         = ( double( stratum % columns ) + rng.NextReal<double>( ) ) / double( columns );
+        double v         = ( double( stratum / columns ) + rng.NextReal<double>( ) ) / double( rows );
+
+        return Point2R { ToReal( u ), ToReal( v ) };
+    }
+
+    uint32_t StratifiedSampler::GetDimension( ) const
+    {
+        return dimension;
+    }
+
+    // The jitter of every dimension is one number of the generator.
+    void StratifiedSampler::SetDimension( uint32_t dimension )
+    {
+        rng.Advance( int64_t( dimension ) - int64_t( this->dimension ) );
+        this->dimension = dimension;
+    }
+
+    //
+    // SobolSampler
+    //
+    SharedPointer<Sampler> SobolSampler::Clone( ) const
+    {
+        return std::make_shared<SobolSampler>( *this );
+    }
+
+    void SobolSampler::StartPixelSample( SizeType i, SizeType j, SizeType sampleIndex, uint64_t seed )
+    {
+        this->pixelSeed   = HashPixel( i, j, seed );
+        this->sampleIndex = uint32_t( sampleIndex );
+        this->dimension   = 0;
+    }
+
+    RealType SobolSampler::Get1D( )
+    {
+        uint64_t hash  = HashDimension( pixelSeed, dimension++ );
+        uint32_t index = NestedUniformScramble( sampleIndex, uint32_t( hash ) );
+
+        return ToUnit( NestedUniformScramble( ReverseBits( index ), uint32_t( hash >> 32 ) ) );
+    }
+
+    Point2R SobolSampler::Get2D( )
+    {
+        uint64_t hash  = HashDimension( pixelSeed, dimension );
+        dimension     += 2;
+
+        uint32_t index = NestedUniformScramble( sampleIndex, uint32_t( hash ) );
+        uint64_t seeds = MixBits( hash );
+
+        return Point2R { ToUnit( NestedUniformScramble( ReverseBits( index ), uint32_t( hash >> 32 ) ) ),
+                         ToUnit( NestedUniformScramble( SobolSecondDimension( index ), uint32_t( seeds ) ) ) };
+    }
+
+    uint32_t SobolSampler::GetDimension( ) const
+    {
+        return dimension;
+    }
+
+    void SobolSampler::SetDimension( uint32_t dimension )
+    {
+        this->dimension = dimension;
+    }
+
+    //
+    // HaltonSampler
+    //
+    SharedPointer<Sampler> HaltonSampler::Clone( ) const
+    {
+        return std::make_shared<HaltonSampler>( *this );
+    }
+
+    void HaltonSampler::StartPixelSample( SizeType i, SizeType j, SizeType sampleIndex, uint64_t seed )
+    {
+        this->pixelSeed   = HashPixel( i, j, seed );
+        this->sampleIndex = sampleIndex;
+        this->dimension   = 0;
+    }
+
+    RealType HaltonSampler::Get1D( )
+    {
+        // Past the last prime the bases repeat, with different scrambles.
+        uint32_t d = dimension++;
+
+        return ScrambledRadicalInverse( sampleIndex, primes[ d % primeCount ], HashDimension( pixelSeed, d ) );
+    }
+
+    Point2R HaltonSampler::Get2D( )
+    {
+        RealType u = Get1D( );
+        RealType v = Get1D( );
+
+        return Point2R { u, v };
+    }
+
+    uint32_t HaltonSampler::GetDimension( ) const
+    {
+        return dimension;
+    }
+
+    void HaltonSampler::SetDimension( uint32_t dimension )
+    {
+        this->dimension = dimension;
+    }
+
+    //
+    // BlueNoiseSampler
+    //
+    BlueNoiseSampler::BlueNoiseSampler( ) : mask( &GetMask( ) )
+    {
+    }
+
+    const std::vector<float>& BlueNoiseSampler::GetMask( )
+    {
+        static const std::vector<float> blueNoiseMask = GenerateBlueNoiseMask( maskSize );
+
+        return blueNoiseMask;
+    }
+
+    SharedPointer<Sampler> BlueNoiseSampler::Clone( ) const
+    {
+        return std::make_shared<BlueNoiseSampler>( *this );
+    }
+
+    void BlueNoiseSampler::StartPixelSample( SizeType i, SizeType j, SizeType sampleIndex, uint64_t seed )
+    {
+        this->i           = i;
+        this->j           = j;
+        this->sampleIndex = sampleIndex;
+        this->seed        = seed;
+        this->dimension   = 0;
+    }
+
+    // The offset depends on the dimension and seed only, so neighbouring pixels keep the blue noise relation of the mask.
+    double BlueNoiseSampler::GetMaskValue( )
+    {
+        uint64_t offset = HashDimension( MixBits( seed ), dimension++ );
+        SizeType x      = ( i + SizeType( offset ) ) & ( maskSize - 1 );
+        SizeType y      = ( j + SizeType( offset >> 32 ) ) & ( maskSize - 1 );
+
+        return double( ( *mask )[ y * maskSize + x ] );
+    }
+
+    RealType BlueNoiseSampler::Get1D( )
+    {
+        constexpr double goldenRatioConjugate = 0.6180339887498949;
+
+        double           v                    = GetMaskValue( ) + double( sampleIndex ) * goldenRatioConjugate;
+
+        return ToReal( v - std::floor( v ) );
+    }
+
+    Point2R BlueNoiseSampler::Get2D( )
+    {
+        // Reciprocals of the plastic number and its square, the R2 sequence of Roberts 2018.
+        constexpr double r2X = 0.7548776662466927;
+        constexpr double r2Y = 0.5698402909980532;
+
+        double           u   = GetMaskValue( ) + double( sampleIndex ) * r2X;
+        double           v   = GetMaskValue( ) + double( sampleIndex ) * r2Y;
+
+        return Point2R { ToReal( u - std::floor( u ) ), ToReal( v - std::floor( v ) ) };
+    }
+
+    uint32_t BlueNoiseSampler::GetDimension( ) const
+    {
+        return dimension;
+    }
+
+    void BlueNoiseSampler::SetDimension( uint32_t dimension )
+    {
+        this->dimension = dimension;
+    }
+
+} // namespace RayTracer
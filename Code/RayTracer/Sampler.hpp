@@ -0,0 +1,194 @@
+#pragma once
+
+#include "Algebra.hpp"
+#include "Common.hpp"
+#include "Random.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace RayTracer
+{
+
+    // Source of the random numbers of a path. Camera calls StartPixelSample before every sample of a pixel, after which
+    // the path draws one dimension per Get1D call and two per Get2D call, always in the same order (pixel position, then
+    // per bounce). Samplers that know the sample index and the dimension can spread each dimension evenly over the samples
+    // of a pixel, which converges faster than independent random numbers.
+    //
+    // A sampler holds the state of one path, so every thread works on its own Clone.
+    class Sampler
+    {
+        public:
+
+            virtual ~Sampler( ) = default;
+
+            virtual SharedPointer<Sampler> Clone( ) const = 0;
+
+            // The seed changes between renders so that successive frames draw different samples.
+            virtual void                   StartPixelSample( SizeType i, SizeType j, SizeType sampleIndex, uint64_t seed ) = 0;
+
+            // Uniform in [0, 1).
+            virtual RealType               Get1D( ) = 0;
+
+            // Uniform in [0, 1)^2.
+            virtual Point2R                Get2D( ) = 0;
+
+            // Dimensions drawn since StartPixelSample.
+            virtual uint32_t               GetDimension( ) const = 0;
+
+            // Continues the current pixel sample as if dimension dimensions had been drawn since StartPixelSample. A path
+            // can then be set aside and resumed on another Clone, as Camera::RenderWavefront does between stages.
+            virtual void                   SetDimension( uint32_t dimension ) = 0;
+    };
+
+
+    // Independent uniform random numbers from a Pcg32 per pixel sample.
+    class IndependentSampler final : public Sampler
+    {
+        private:
+
+            Pcg32    rng;
+            uint32_t dimension = 0;
+
+        public:
+
+            SharedPointer<Sampler> Clone( ) const override;
+
+            void                   StartPixelSample( SizeType i, SizeType j, SizeType sampleIndex, uint64_t seed ) override;
+
+            RealType               Get1D( ) override;
+
+            Point2R                Get2D( ) override;
+
+            uint32_t               GetDimension( ) const override;
+
+            void                   SetDimension( uint32_t dimension ) override;
+    };
+
+
+    // Jittered strata: each dimension is split into samplesPerPixel strata (a grid of about that many cells in 2D), and
+    // every pixel visits them in its own random order.
+    class StratifiedSampler final : public Sampler
+    {
+        private:
+
+            SizeType samplesPerPixel;
+
+            uint64_t pixelSeed   = 0;
+            SizeType sampleIndex = 0;
+            uint32_t dimension   = 0;
+            Pcg32    rng;
+
+        public:
+
+            StratifiedSampler( SizeType samplesPerPixel );
+
+            SharedPointer<Sampler> Clone( ) const override;
+
+            void                   StartPixelSample( SizeType i, SizeType j, SizeType sampleIndex, uint64_t seed ) override;
+
+            RealType               Get1D( ) override;
+
+            Point2R                Get2D( ) override;
+
+            uint32_t               GetDimension( ) const override;
+
+            void                   SetDimension( uint32_t dimension ) override;
+    };
+
+
+    // Owen scrambled Sobol points. Every call uses the first one or two Sobol dimensions, with the sample index shuffled
+    // and the result scrambled by hashes of the pixel and the dimension (Burley 2020, "Practical Hash-based Owen
+    // Scrambling"). Any number of samples per pixel works, but powers of two are best stratified.
+    class SobolSampler final : public Sampler
+    {
+        private:
+
+            uint64_t pixelSeed   = 0;
+            uint32_t sampleIndex = 0;
+            uint32_t dimension   = 0;
+
+        public:
+
+            SharedPointer<Sampler> Clone( ) const override;
+
+            void                   StartPixelSample( SizeType i, SizeType j, SizeType sampleIndex, uint64_t seed ) override;
+
+            RealType               Get1D( ) override;
+
+            Point2R                Get2D( ) override;
+
+            uint32_t               GetDimension( ) const override;
+
+            void                   SetDimension( uint32_t dimension ) override;
+    };
+
+
+    // Halton points, the radical inverse of the sample index in a different prime base per dimension, with the digits
+    // randomly permuted per pixel and dimension.
+    class HaltonSampler final : public Sampler
+    {
+        private:
+
+            uint64_t pixelSeed   = 0;
+            uint64_t sampleIndex = 0;
+            uint32_t dimension   = 0;
+
+        public:
+
+            SharedPointer<Sampler> Clone( ) const override;
+
+            void                   StartPixelSample( SizeType i, SizeType j, SizeType sampleIndex, uint64_t seed ) override;
+
+            RealType               Get1D( ) override;
+
+            Point2R                Get2D( ) override;
+
+            uint32_t               GetDimension( ) const override;
+
+            void                   SetDimension( uint32_t dimension ) override;
+    };
+
+
+    // Screen space blue noise. Each dimension reads a tiled void and cluster blue noise mask at an offset of its own and
+    // steps through the samples of a pixel with the golden ratio (R1) or plastic number (R2) sequence. The error of
+    // neighbouring pixels is then uncorrelated, which looks like fine grain rather than blotches at low sample counts.
+    class BlueNoiseSampler final : public Sampler
+    {
+        public:
+
+            static constexpr SizeType maskSize = 64;
+
+        private:
+
+            const std::vector<float>* mask;
+
+            SizeType                  i           = 0;
+            SizeType                  j           = 0;
+            SizeType                  sampleIndex = 0;
+            uint64_t                  seed        = 0;
+            uint32_t                  dimension   = 0;
+
+            double                    GetMaskValue( );
+
+        public:
+
+            BlueNoiseSampler( );
+
+            SharedPointer<Sampler> Clone( ) const override;
+
+            void                   StartPixelSample( SizeType i, SizeType j, SizeType sampleIndex, uint64_t seed ) override;
+
+            RealType               Get1D( ) override;
+
+            Point2R                Get2D( ) override;
+
+            uint32_t               GetDimension( ) const override;
+
+            void                   SetDimension( uint32_t dimension ) override;
+
+            // maskSize x maskSize ranks in (0, 1), generated once with the void and cluster method (Ulichney 1993).
+            static const std::vector<float>& GetMask( );
+    };
+
+} // namespace RayTracer
@@ -0,0 +1,536 @@
+#pragma once
+
+#include "Common.hpp"
+#include "ConstexprFor.hpp"
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+#if defined( __AVX512F__ )
+#    define RAYTRACER_SIMD_AVX512 1
+#endif
+
+#if defined( __AVX__ )
+#    define RAYTRACER_SIMD_AVX 1
+#endif
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#    define RAYTRACER_SIMD_SSE2 1
+#endif
+
+#if defined( RAYTRACER_SIMD_SSE2 ) || defined( RAYTRACER_SIMD_AVX ) || defined( RAYTRACER_SIMD_AVX512 )
+#    include <immintrin.h>
+#endif
+
+namespace RayTracer
+{
+
+    // Fixed width pack of Width lanes of T. The generic version operates lane by lane and is specialized below for the
+    // instruction sets enabled at compile time. Comparisons return packs whose lanes have all bits set or cleared, which
+    // can be fed to Select and MoveMask.
+    template <typename T, SizeType Width>
+    struct Simd
+    {
+            alignas( Width * sizeof( T ) ) T lanes[ Width ];
+
+            static Simd Load( const T* p )
+            {
+                Simd s;
+
+                Constexpr_For<SizeType, 0, Width>(
+                    [ &s, p ]( auto i )
+                    {
+                        s.lanes[ i ] = p[ i ];
+                    } );
+
+                return s;
+            }
+
+            static Simd Broadcast( const T& value )
+            {
+                Simd s;
+
+                Constexpr_For<SizeType, 0, Width>(
+                    [ &s, &value ]( auto i )
+                    {
+                        s.lanes[ i ] = value;
+                    } );
+
+                return s;
+            }
+
+            void Store( T* p ) const
+            {
+                Constexpr_For<SizeType, 0, Width>(
+                    [ this, p ]( auto i )
+                    {
+                        p[ i ] = lanes[ i ];
+                    } );
+            }
+    };
+
+    namespace Detail
+    {
+        template <typename T>
+        using SimdLaneBits = std::conditional_t<sizeof( T ) == 8, uint64_t, uint32_t>;
+
+        template <typename T, SizeType Width, class Operation>
+        inline Simd<T, Width> SimdApply( const Simd<T, Width>& a, const Simd<T, Width>& b, Operation operation )
+        {
+            Simd<T, Width> r;
+
+            Constexpr_For<SizeType, 0, Width>(
+                [ &r, &a, &b, &operation ]( auto i )
+                {
+                    r.lanes[ i ] = operation( a.lanes[ i ], b.lanes[ i ] );
+                } );
+
+            return r;
+        }
+
+        template <typename T>
+        inline T SimdMaskLane( bool set )
+        {
+            return std::bit_cast<T>( set ? ~SimdLaneBits<T>( 0 ) : SimdLaneBits<T>( 0 ) );
+        }
+    } // namespace Detail
+
+    template <typename T, SizeType Width>
+    inline Simd<T, Width> operator+( const Simd<T, Width>& a, const Simd<T, Width>& b )
+    {
+        return Detail::SimdApply( a, b,
+            []( T x, T y )
+            {
+                return x + y;
+            } );
+    }
+
+    template <typename T, SizeType Width>
+    inline Simd<T, Width> operator-( const Simd<T, Width>& a, const Simd<T, Width>& b )
+    {
+        return Detail::SimdApply( a, b,
+            []( T x, T y )
+            {
+                return x - y;
+            } );
+    }
+
+    template <typename T, SizeType Width>
+    inline Simd<T, Width> operator*( const Simd<T, Width>& a, const Simd<T, Width>& b )
+    {
+        return Detail::SimdApply( a, b,
+            []( T x, T y )
+            {
+                return x * y;
+            } );
+    }
+
+    template <typename T, SizeType Width>
+    inline Simd<T, Width> operator/( const Simd<T, Width>& a, const Simd<T, Width>& b )
+    {
+        return Detail::SimdApply( a, b,
+            []( T x, T y )
+            {
+                return x / y;
+            } );
+    }
+
+    template <typename T, SizeType Width>
+    inline Simd<T, Width> Min( const Simd<T, Width>& a, const Simd<T, Width>& b )
+    {
+        return Detail::SimdApply( a, b,
+            []( T x, T y )
+            {
+                return x < y ? x : y;
+            } );
+    }
+
+    template <typename T, SizeType Width>
+    inline Simd<T, Width> Max( const Simd<T, Width>& a, const Simd<T, Width>& b )
+    {
+        return Detail::SimdApply( a, b,
+            []( T x, T y )
+            {
+                return x > y ? x : y;
+            } );
+    }
+
+    template <typename T, SizeType Width>
+    inline Simd<T, Width> Sqrt( const Simd<T, Width>& a )
+    {
+        return Detail::SimdApply( a, a,
+            []( T x, T )
+            {
+                return std::sqrt( x );
+            } );
+    }
+
+    template <typename T, SizeType Width>
+    inline Simd<T, Width> operator<( const Simd<T, Width>& a, const Simd<T, Width>& b )
+    {
+        return Detail::SimdApply( a, b,
+            []( T x, T y )
+            {
+                return Detail::SimdMaskLane<T>( x < y );
+            } );
+    }
+
+    template <typename T, SizeType Width>
+    inline Simd<T, Width> operator<=( const Simd<T, Width>& a, const Simd<T, Width>& b )
+    {
+        return Detail::SimdApply( a, b,
+            []( T x, T y )
+            {
+                return Detail::SimdMaskLane<T>( x <= y );
+            } );
+    }
+
+    template <typename T, SizeType Width>
+    inline Simd<T, Width> operator>( const Simd<T, Width>& a, const Simd<T, Width>& b )
+    {
+        return b < a;
+    }
+
+    template <typename T, SizeType Width>
+    inline Simd<T, Width> operator>=( const Simd<T, Width>& a, const Simd<T, Width>& b )
+    {
+        return b <= a;
+    }
+
+    template <typename T, SizeType Width>
+    inline Simd<T, Width> operator&( const Simd<T, Width>& a, const Simd<T, Width>& b )
+    {
+        using Bits = Detail::SimdLaneBits<T>;
+        return Detail::SimdApply( a, b,
+            []( T x, T y )
+            {
+                return std::bit_cast<T>( Bits( std::bit_cast<Bits>( x ) & std::bit_cast<Bits>( y ) ) );
+            } );
+    }
+
+    template <typename T, SizeType Width>
+    inline Simd<T, Width> operator|( const Simd<T, Width>& a, const Simd<T, Width>& b )
+    {
+        using Bits = Detail::SimdLaneBits<T>;
+        return Detail::SimdApply( a, b,
+            []( T x, T y )
+            {
+                return std::bit_cast<T>( Bits( std::bit_cast<Bits>( x ) | std::bit_cast<Bits>( y ) ) );
+            } );
+    }
+
+    // Lanes of a where mask is set, lanes of b elsewhere.
+    template <typename T, SizeType Width>
+    inline Simd<T, Width> Select( const Simd<T, Width>& mask, const Simd<T, Width>& a, const Simd<T, Width>& b )
+    {
+        Simd<T, Width> r;
+
+        Constexpr_For<SizeType, 0, Width>(
+            [ &r, &mask, &a, &b ]( auto i )
+            {
+                r.lanes[ i ] = std::signbit( mask.lanes[ i ] ) ? a.lanes[ i ] : b.lanes[ i ];
+            } );
+
+        return r;
+    }
+
+    // One bit per lane, set where the sign bit of the lane is set.
+    template <typename T, SizeType Width>
+    inline uint32_t MoveMask( const Simd<T, Width>& mask )
+    {
+        uint32_t bits = 0;
+
+        Constexpr_For<SizeType, 0, Width>(
+            [ &bits, &mask ]( auto i )
+            {
+                bits |= uint32_t( std::signbit( mask.lanes[ i ] ) ) << i;
+            } );
+
+        return bits;
+    }
+
+
+#define RAYTRACER_SIMD_SPECIALIZATION( T, Width, Register, Prefix, Suffix )                   \
+    template <>                                                                               \
+    struct Simd<T, Width>                                                                     \
+    {                                                                                         \
+            Register          v;                                                              \
+                                                                                              \
+            static Simd       Load( const T* p )                                              \
+            {                                                                                 \
+                return Simd { Prefix##_load_##Suffix( p ) };                                  \
+            }                                                                                 \
+                                                                                              \
+            static Simd       Broadcast( const T& value )                                     \
+            {                                                                                 \
+                return Simd { Prefix##_set1_##Suffix( value ) };                              \
+            }                                                                                 \
+                                                                                              \
+            void              Store( T* p ) const                                             \
+            {                                                                                 \
+                Prefix##_store_##Suffix( p, v );                                              \
+            }                                                                                 \
+    };                                                                                        \
+                                                                                              \
+    inline Simd<T, Width> operator+( const Simd<T, Width>& a, const Simd<T, Width>& b )       \
+    {                                                                                         \
+        return { Prefix##_add_##Suffix( a.v, b.v ) };                                         \
+    }                                                                                         \
+    inline Simd<T, Width> operator-( const Simd<T, Width>& a, const Simd<T, Width>& b )       \
+    {                                                                                         \
+        return { Prefix##_sub_##Suffix( a.v, b.v ) };                                         \
+    }                                                                                         \
+    inline Simd<T, Width> operator*( const Simd<T, Width>& a, const Simd<T, Width>& b )       \
+    {                                                                                         \
+        return { Prefix##_mul_##Suffix( a.v, b.v ) };                                         \
+    }                                                                                         \
+    inline Simd<T, Width> operator/( const Simd<T, Width>& a, const Simd<T, Width>& b )       \
+    {                                                                                         \
+        return { Prefix##_div_##Suffix( a.v, b.v ) };                                         \
+    }                                                                                         \
+    inline Simd<T, Width> Min( const Simd<T, Width>& a, const Simd<T, Width>& b )             \
+    {                                                                                         \
+        return { Prefix##_min_##Suffix( a.v, b.v ) };                                         \
+    }                                                                                         \
+    inline Simd<T, Width> Max( const Simd<T, Width>& a, const Simd<T, Width>& b )             \
+    {                                                                                         \
+        return { Prefix##_max_##Suffix( a.v, b.v ) };                                         \
+    }                                                                                         \
+    inline Simd<T, Width> Sqrt( const Simd<T, Width>& a )                                     \
+    {                                                                                         \
+        return { Prefix##_sqrt_##Suffix( a.v ) };                                             \
+    }                                                                                         \
+    inline Simd<T, Width> operator&( const Simd<T, Width>& a, const Simd<T, Width>& b )       \
+    {                                                                                         \
+        return { Prefix##_and_##Suffix( a.v, b.v ) };                                         \
+    }                                                                                         \
+    inline Simd<T, Width> operator|( const Simd<T, Width>& a, const Simd<T, Width>& b )       \
+    {                                                                                         \
+        return { Prefix##_or_##Suffix( a.v, b.v ) };                                          \
+    }                                                                                         \
+    inline Simd<T, Width> Select( const Simd<T, Width>& mask, const Simd<T, Width>& a, const Simd<T, Width>& b ) \
+    {                                                                                         \
+        return { Prefix##_or_##Suffix( Prefix##_and_##Suffix( mask.v, a.v ), Prefix##_andnot_##Suffix( mask.v, b.v ) ) }; \
+    }                                                                                         \
+    inline uint32_t MoveMask( const Simd<T, Width>& mask )                                    \
+    {                                                                                         \
+        return uint32_t( Prefix##_movemask_##Suffix( mask.v ) );                              \
+    }
+
+#define RAYTRACER_SIMD_SSE_COMPARISONS( T, Width, Suffix )                                    \
+    inline Simd<T, Width> operator<( const Simd<T, Width>& a, const Simd<T, Width>& b )       \
+    {                                                                                         \
+        return { _mm_cmplt_##Suffix( a.v, b.v ) };                                            \
+    }                                                                                         \
+    inline Simd<T, Width> operator<=( const Simd<T, Width>& a, const Simd<T, Width>& b )      \
+    {                                                                                         \
+        return { _mm_cmple_##Suffix( a.v, b.v ) };                                            \
+    }                                                                                         \
+    inline Simd<T, Width> operator>( const Simd<T, Width>& a, const Simd<T, Width>& b )       \
+    {                                                                                         \
+        return { _mm_cmpgt_##Suffix( a.v, b.v ) };                                            \
+    }                                                                                         \
+    inline Simd<T, Width> operator>=( const Simd<T, Width>& a, const Simd<T, Width>& b )      \
+    {                                                                                         \
+        return { _mm_cmpge_##Suffix( a.v, b.v ) };                                            \
+    }
+
+#define RAYTRACER_SIMD_AVX_COMPARISONS( T, Width, Suffix )                                    \
+    inline Simd<T, Width> operator<( const Simd<T, Width>& a, const Simd<T, Width>& b )       \
+    {                                                                                         \
+        return { _mm256_cmp_##Suffix( a.v, b.v, _CMP_LT_OQ ) };                               \
+    }                                                                                         \
+    inline Simd<T, Width> operator<=( const Simd<T, Width>& a, const Simd<T, Width>& b )      \
+    {                                                                                         \
+        return { _mm256_cmp_##Suffix( a.v, b.v, _CMP_LE_OQ ) };                               \
+    }                                                                                         \
+    inline Simd<T, Width> operator>( const Simd<T, Width>& a, const Simd<T, Width>& b )       \
+    {                                                                                         \
+        return { _mm256_cmp_##Suffix( a.v, b.v, _CMP_GT_OQ ) };                               \
+    }                                                                                         \
+    inline Simd<T, Width> operator>=( const Simd<T, Width>& a, const Simd<T, Width>& b )      \
+    {                                                                                         \
+        return { _mm256_cmp_##Suffix( a.v, b.v, _CMP_GE_OQ ) };                               \
+    }
+
+// AVX-512 comparisons produce mask registers. They are expanded back to all bits set lanes so that the packs behave like
+// the SSE and AVX ones. Only AVX512F instructions are used, hence the bitwise operations on the integer view.
+#define RAYTRACER_SIMD_AVX512_MASK_TO_PACK( Suffix, IntegerSuffix, bits ) \
+    { _mm512_castsi512_##Suffix( _mm512_maskz_set1_##IntegerSuffix( bits, -1 ) ) }
+
+#define RAYTRACER_SIMD_AVX512_SPECIALIZATION( T, Width, Register, Suffix, IntegerSuffix )     \
+    template <>                                                                               \
+    struct Simd<T, Width>                                                                     \
+    {                                                                                         \
+            Register          v;                                                              \
+                                                                                              \
+            static Simd       Load( const T* p )                                              \
+            {                                                                                 \
+                return Simd { _mm512_load_##Suffix( p ) };                                    \
+            }                                                                                 \
+                                                                                              \
+            static Simd       Broadcast( const T& value )                                     \
+            {                                                                                 \
+                return Simd { _mm512_set1_##Suffix( value ) };                                \
+            }                                                                                 \
+                                                                                              \
+            void              Store( T* p ) const                                             \
+            {                                                                                 \
+                _mm512_store_##Suffix( p, v );                                                \
+            }                                                                                 \
+    };                                                                                        \
+                                                                                              \
+    inline Simd<T, Width> operator+( const Simd<T, Width>& a, const Simd<T, Width>& b )       \
+    {                                                                                         \
+        return { _mm512_add_##Suffix( a.v, b.v ) };                                           \
+    }                                                                                         \
+    inline Simd<T, Width> operator-( const Simd<T, Width>& a, const Simd<T, Width>& b )       \
+    {                                                                                         \
+        return { _mm512_sub_##Suffix( a.v, b.v ) };                                           \
+    }                                                                                         \
+    inline Simd<T, Width> operator*( const Simd<T, Width>& a, const Simd<T, Width>& b )       \
+    {                                                                                         \
+        return { _mm512_mul_##Suffix( a.v, b.v ) };                                           \
+    }                                                                                         \
+    inline Simd<T, Width> operator/( const Simd<T, Width>& a, const Simd<T, Width>& b )       \
+    {                                                                                         \
+        return { _mm512_div_##Suffix( a.v, b.v ) };                                           \
+    }                                                                                         \
+    inline Simd<T, Width> Min( const Simd<T, Width>& a, const Simd<T, Width>& b )             \
+    {                                                                                         \
+        return { _mm512_min_##Suffix( a.v, b.v ) };                                           \
+    }                                                                                         \
+    inline Simd<T, Width> Max( const Simd<T, Width>& a, const Simd<T, Width>& b )             \
+    {                                                                                         \
+        return { _mm512_max_##Suffix( a.v, b.v ) };                                           \
+    }                                                                                         \
+    inline Simd<T, Width> Sqrt( const Simd<T, Width>& a )                                     \
+    {                                                                                         \
+        return { _mm512_sqrt_##Suffix( a.v ) };                                               \
+    }                                                                                         \
+    inline Simd<T, Width> operator&( const Simd<T, Width>& a, const Simd<T, Width>& b )       \
+    {                                                                                         \
+        return { _mm512_castsi512_##Suffix( _mm512_and_si512( _mm512_cast##Suffix##_si512( a.v ), _mm512_cast##Suffix##_si512( b.v ) ) ) }; \
+    }                                                                                         \
+    inline Simd<T, Width> operator|( const Simd<T, Width>& a, const Simd<T, Width>& b )       \
+    {                                                                                         \
+        return { _mm512_castsi512_##Suffix( _mm512_or_si512( _mm512_cast##Suffix##_si512( a.v ), _mm512_cast##Suffix##_si512( b.v ) ) ) }; \
+    }                                                                                         \
+    inline uint32_t MoveMask( const Simd<T, Width>& mask )                                    \
+    {                                                                                         \
+        return uint32_t( _mm512_cmplt_##IntegerSuffix##_mask( _mm512_cast##Suffix##_si512( mask.v ), _mm512_setzero_si512( ) ) ); \
+    }                                                                                         \
+    inline Simd<T, Width> Select( const Simd<T, Width>& mask, const Simd<T, Width>& a, const Simd<T, Width>& b ) \
+    {                                                                                         \
+        return { _mm512_mask_blend_##Suffix( MoveMask( mask ), b.v, a.v ) };                  \
+    }                                                                                         \
+    inline Simd<T, Width> operator<( const Simd<T, Width>& a, const Simd<T, Width>& b )       \
+    {                                                                                         \
+        return RAYTRACER_SIMD_AVX512_MASK_TO_PACK( Suffix, IntegerSuffix, _mm512_cmp_##Suffix##_mask( a.v, b.v, _CMP_LT_OQ ) ); \
+    }                                                                                         \
+    inline Simd<T, Width> operator<=( const Simd<T, Width>& a, const Simd<T, Width>& b )      \
+    {                                                                                         \
+        return RAYTRACER_SIMD_AVX512_MASK_TO_PACK( Suffix, IntegerSuffix, _mm512_cmp_##Suffix##_mask( a.v, b.v, _CMP_LE_OQ ) ); \
+    }                                                                                         \
+    inline Simd<T, Width> operator>( const Simd<T, Width>& a, const Simd<T, Width>& b )       \
+    {                                                                                         \
+        return RAYTRACER_SIMD_AVX512_MASK_TO_PACK( Suffix, IntegerSuffix, _mm512_cmp_##Suffix##_mask( a.v, b.v, _CMP_GT_OQ ) ); \
+    }                                                                                         \
+    inline Simd<T, Width> operator>=( const Simd<T, Width>& a, const Simd<T, Width>& b )      \
+    {                                                                                         \
+        return RAYTRACER_SIMD_AVX512_MASK_TO_PACK( Suffix, IntegerSuffix, _mm512_cmp_##Suffix##_mask( a.v, b.v, _CMP_GE_OQ ) ); \
+    }
+
+
+#if defined( RAYTRACER_SIMD_SSE2 )
+    RAYTRACER_SIMD_SPECIALIZATION( float, 4, __m128, _mm, ps )
+    RAYTRACER_SIMD_SSE_COMPARISONS( float, 4, ps )
+
+    RAYTRACER_SIMD_SPECIALIZATION( double, 2, __m128d, _mm, pd )
+    RAYTRACER_SIMD_SSE_COMPARISONS( double, 2, pd )
+#endif
+
+#if defined( RAYTRACER_SIMD_AVX )
+    RAYTRACER_SIMD_SPECIALIZATION( float, 8, __m256, _mm256, ps )
+    RAYTRACER_SIMD_AVX_COMPARISONS( float, 8, ps )
+
+    RAYTRACER_SIMD_SPECIALIZATION( double, 4, __m256d, _mm256, pd )
+    RAYTRACER_SIMD_AVX_COMPARISONS( double, 4, pd )
+#endif
+
+#if defined( RAYTRACER_SIMD_AVX512 )
+    RAYTRACER_SIMD_AVX512_SPECIALIZATION( float, 16, __m512, ps, epi32 )
+    RAYTRACER_SIMD_AVX512_SPECIALIZATION( double, 8, __m512d, pd, epi64 )
+#endif
+
+    // Lane permutation and sum of the first three lanes of four lane packs, for the three component vectors of
+    // Algebra.hpp, which are padded to four lanes. The generic versions go through memory.
+    template <SizeType I0, SizeType I1, SizeType I2, SizeType I3, typename T>
+    inline Simd<T, 4> Permute( const Simd<T, 4>& a )
+    {
+        alignas( 4 * sizeof( T ) ) T lanes[ 4 ];
+        a.Store( lanes );
+
+        alignas( 4 * sizeof( T ) ) T permuted[ 4 ] = { lanes[ I0 ], lanes[ I1 ], lanes[ I2 ], lanes[ I3 ] };
+
+        return Simd<T, 4>::Load( permuted );
+    }
+
+    template <typename T>
+    inline T ReduceAdd3( const Simd<T, 4>& a )
+    {
+        alignas( 4 * sizeof( T ) ) T lanes[ 4 ];
+        a.Store( lanes );
+
+        return lanes[ 0 ] + lanes[ 1 ] + lanes[ 2 ];
+    }
+
+#if defined( RAYTRACER_SIMD_SSE2 )
+    template <SizeType I0, SizeType I1, SizeType I2, SizeType I3>
+    inline Simd<float, 4> Permute( const Simd<float, 4>& a )
+    {
+        return { _mm_shuffle_ps( a.v, a.v, _MM_SHUFFLE( I3, I2, I1, I0 ) ) };
+    }
+
+    inline float ReduceAdd3( const Simd<float, 4>& a )
+    {
+        __m128 y = _mm_shuffle_ps( a.v, a.v, _MM_SHUFFLE( 1, 1, 1, 1 ) );
+        __m128 z = _mm_movehl_ps( a.v, a.v );
+
+        return _mm_cvtss_f32( _mm_add_ss( _mm_add_ss( a.v, y ), z ) );
+    }
+#endif
+
+#if defined( RAYTRACER_SIMD_AVX )
+    inline double ReduceAdd3( const Simd<double, 4>& a )
+    {
+        __m128d xy = _mm256_castpd256_pd128( a.v );
+        __m128d zw = _mm256_extractf128_pd( a.v, 1 );
+
+        return _mm_cvtsd_f64( _mm_add_sd( _mm_add_sd( xy, _mm_unpackhi_pd( xy, xy ) ), zw ) );
+    }
+#endif
+
+#if defined( __AVX2__ )
+    template <SizeType I0, SizeType I1, SizeType I2, SizeType I3>
+    inline Simd<double, 4> Permute( const Simd<double, 4>& a )
+    {
+        return { _mm256_permute4x64_pd( a.v, _MM_SHUFFLE( I3, I2, I1, I0 ) ) };
+    }
+#endif
+
+    // Widest pack of T supported by the enabled instruction sets.
+#if defined( RAYTRACER_SIMD_AVX512 )
+    template <typename T>
+    constexpr SizeType nativeSimdWidth = 64 / sizeof( T );
+#elif defined( RAYTRACER_SIMD_AVX )
+    template <typename T>
+    constexpr SizeType nativeSimdWidth = 32 / sizeof( T );
+#else
+    template <typename T>
+    constexpr SizeType nativeSimdWidth = 16 / sizeof( T );
+#endif
+
+} // namespace RayTracer
@@ -0,0 +1,170 @@
+#include "SphereSet.hpp"
+
+#include <cmath>
+#include <limits>
+
+namespace RayTracer
+{
+
+    void SphereSet::Add( const Point3R& center, RealType radius, MaterialId materialId )
+    {
+        SizeType lane = sphereCount % Width;
+
+        if ( lane == 0 )
+        {
+            // Unused lanes have NaN centers, which fail every comparison of the intersection test.
+            Block block;
+
+            for ( SizeType i = 0; i < Width; i++ )
+            {
+                block.centerX[ i ]     = block.centerY[ i ] = block.centerZ[ i ] = std::numeric_limits<RealType>::quiet_NaN( );
+                block.radii[ i ]       = 0;
+                block.materialIds[ i ] = 0;
+            }
+
+            blocks.push_back( block );
+        }
+
+        Block& block              = blocks.back( );
+        block.centerX[ lane ]     = center[ 0 ];
+        block.centerY[ lane ]     = center[ 1 ];
+        block.centerZ[ lane ]     = center[ 2 ];
+        block.radii[ lane ]       = std::max( RealType( 0 ), radius );
+        block.materialIds[ lane ] = materialId;
+
+        Vec3R radiusVector { block.radii[ lane ], block.radii[ lane ], block.radii[ lane ] };
+        boundingBox.Expand( AabbR( center - radiusVector, center + radiusVector ) );
+
+        sphereCount++;
+    }
+
+    template <bool AnyHit>
+    bool SphereSet::IntersectBlocks( const RayR& ray, const IntervalR& rayParameterInterval, Intersection& intersection ) const
+    {
+        using Pack = Simd<RealType, Width>;
+
+        const Vec3R&   direction         = ray.GetDirection( );
+        const Point3R& origin            = ray.GetOrigin( );
+
+        const Pack     originX           = Pack::Broadcast( origin[ 0 ] );
+        const Pack     originY           = Pack::Broadcast( origin[ 1 ] );
+        const Pack     originZ           = Pack::Broadcast( origin[ 2 ] );
+        const Pack     directionX        = Pack::Broadcast( direction[ 0 ] );
+        const Pack     directionY        = Pack::Broadcast( direction[ 1 ] );
+        const Pack     directionZ        = Pack::Broadcast( direction[ 2 ] );
+        const Pack     a                 = Pack::Broadcast( Dot( direction, direction ) );
+        const Pack     inverseA          = Pack::Broadcast( 1 / Dot( direction, direction ) );
+        const Pack     tFrom             = Pack::Broadcast( rayParameterInterval.GetFrom( ) );
+        const Pack     infinity          = Pack::Broadcast( std::numeric_limits<RealType>::infinity( ) );
+        const Pack     zero              = Pack::Broadcast( 0 );
+
+        RealType       closest           = rayParameterInterval.GetTo( );
+        SizeType       closestBlock      = 0;
+        SizeType       closestLane       = Width;
+
+        alignas( sizeof( Pack ) ) RealType tLanes[ Width ];
+
+        for ( SizeType b = 0; b < blocks.size( ); b++ )
+        {
+            const Block& block        = blocks[ b ];
+
+            Pack         ocX          = Pack::Load( block.centerX ) - originX;
+            Pack         ocY          = Pack::Load( block.centerY ) - originY;
+            Pack         ocZ          = Pack::Load( block.centerZ ) - originZ;
+            Pack         radius       = Pack::Load( block.radii );
+
+            Pack         h            = directionX * ocX + directionY * ocY + directionZ * ocZ;
+
+            // Same formulation as Sphere::FindRoot: the discriminant from the distance of the center from the line of
+            // the ray, and the roots q / a and c / q.
+            Pack         hOverA       = h * inverseA;
+            Pack         fX           = ocX - hOverA * directionX;
+            Pack         fY           = ocY - hOverA * directionY;
+            Pack         fZ           = ocZ - hOverA * directionZ;
+            Pack         discriminant = a * ( radius * radius - ( fX * fX + fY * fY + fZ * fZ ) );
+            Pack         hitsLine     = discriminant >= zero;
+
+            // Most blocks miss with every lane, as most spheres miss in Sphere::FindRoot, which then stops here too.
+            if ( MoveMask( hitsLine ) == 0 )
+            {
+                continue;
+            }
+
+            Pack         c            = ocX * ocX + ocY * ocY + ocZ * ocZ - radius * radius;
+            Pack         sqrtd        = Sqrt( Max( discriminant, zero ) );
+            Pack         q            = Select( h < zero, h - sqrtd, h + sqrtd );
+            Pack         qRoot        = q * inverseA;
+            Pack         cRoot        = c / q;
+
+            // Nearest root inside the interval, as in Sphere::Hit. Lanes without a valid root get an infinite t.
+            Pack         tClosest     = Pack::Broadcast( closest );
+            Pack         nearRoot     = Min( qRoot, cRoot );
+            Pack         farRoot      = Max( qRoot, cRoot );
+            Pack         t            = Select( ( nearRoot > tFrom ) & ( nearRoot < tClosest ), nearRoot, Select( ( farRoot > tFrom ) & ( farRoot < tClosest ), farRoot, infinity ) );
+
+            uint32_t     hits         = MoveMask( hitsLine & ( t < tClosest ) );
+
+            if ( hits == 0 )
+            {
+                continue;
+            }
+
+            if constexpr ( AnyHit )
+            {
+                return true;
+            }
+
+            t.Store( tLanes );
+
+            for ( SizeType lane = 0; lane < Width; lane++ )
+            {
+                if ( ( hits & ( 1u << lane ) ) && tLanes[ lane ] < closest )
+                {
+                    closest      = tLanes[ lane ];
+                    closestBlock = b;
+                    closestLane  = lane;
+                }
+            }
+        }
+
+        if ( closestLane == Width )
+        {
+            return false;
+        }
+
+        intersection.t              = closest;
+        intersection.primitive      = this;
+        intersection.primitiveIndex = uint32_t( closestBlock * Width + closestLane );
+
+        return true;
+    }
+
+    bool SphereSet::Intersect( const RayR& ray, const IntervalR& rayParameterInterval, Intersection& intersection ) const
+    {
+        return IntersectBlocks<false>( ray, rayParameterInterval, intersection );
+    }
+
+    void SphereSet::FinalizeHit( const RayR& ray, const Intersection& intersection, HitRecord& hitRecord ) const
+    {
+        const Block& block  = blocks[ intersection.primitiveIndex / Width ];
+        SizeType     lane   = intersection.primitiveIndex % Width;
+        Point3R      center { block.centerX[ lane ], block.centerY[ lane ], block.centerZ[ lane ] };
+
+        SetSphereHit( ray, intersection.t, center, block.radii[ lane ], hitRecord );
+        hitRecord.materialId = block.materialIds[ lane ];
+        hitRecord.lightId    = noLightId;
+    }
+
+    bool SphereSet::Occluded( const RayR& ray, const IntervalR& rayParameterInterval ) const
+    {
+        Intersection unused;
+
+        return IntersectBlocks<true>( ray, rayParameterInterval, unused );
+    }
+
+    AabbR SphereSet::GetBoundingBox( ) const
+    {
+        return boundingBox;
+    }
+
+} // namespace RayTracer
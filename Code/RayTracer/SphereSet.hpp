@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Hittable.hpp"
+#include "Simd.hpp"
+
+#include <vector>
+
+namespace RayTracer
+{
+
+    // Spheres stored as structure of arrays in blocks of Width, so that a ray is tested against a whole block with one
+    // Simd<RealType, Width> sequence. Only the closest hit of all the spheres is turned into a HitRecord, by FinalizeHit.
+    class SphereSet : public Hittable
+    {
+        public:
+
+            static constexpr SizeType Width = nativeSimdWidth<RealType>;
+
+            struct alignas( 64 ) Block
+            {
+                    RealType   centerX[ Width ];
+                    RealType   centerY[ Width ];
+                    RealType   centerZ[ Width ];
+                    RealType   radii[ Width ];
+
+                    MaterialId materialIds[ Width ];
+            };
+
+        private:
+
+            std::vector<Block> blocks;
+            SizeType           sphereCount = 0;
+            AabbR              boundingBox;
+
+            // Shared by Intersect and Occluded. With AnyHit, returns at the first block with a hit.
+            template <bool AnyHit>
+            bool               IntersectBlocks( const RayR& ray, const IntervalR& rayParameterInterval, Intersection& intersection ) const;
+
+        public:
+
+            SphereSet( )
+            {
+            }
+
+            void     Add( const Point3R& center, RealType radius, MaterialId materialId );
+
+            bool     Intersect( const RayR& ray, const IntervalR& rayParameterInterval, Intersection& intersection ) const override;
+
+            void     FinalizeHit( const RayR& ray, const Intersection& intersection, HitRecord& hitRecord ) const override;
+
+            bool     Occluded( const RayR& ray, const IntervalR& rayParameterInterval ) const override;
+
+            AabbR    GetBoundingBox( ) const override;
+
+            SizeType GetSize( ) const
+            {
+                return sphereCount;
+            }
+
+            const std::vector<Block>& GetBlocks( ) const
+            {
+                return blocks;
+            }
+    };
+
+} // namespace RayTracer
@@ -0,0 +1,156 @@
+#include "TileScheduler.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace RayTracer
+{
+
+    namespace
+    {
+        uint32_t SpreadBitsBy2( uint32_t v )
+        {
+            v = ( v | ( v << 8 ) ) & 0x00ff00ffu;
+            v = ( v | ( v << 4 ) ) & 0x0f0f0f0fu;
+            v = ( v | ( v << 2 ) ) & 0x33333333u;
+            v = ( v | ( v << 1 ) ) & 0x55555555u;
+
+            return v;
+        }
+
+        uint32_t MortonIndex( uint32_t x, uint32_t y )
+        {
+            return SpreadBitsBy2( x ) | ( SpreadBitsBy2( y ) << 1 );
+        }
+
+        // Distance along the Hilbert curve filling a side x side grid, side being a power of two.
+        uint32_t HilbertIndex( uint32_t side, uint32_t x, uint32_t y )
+        {
+            uint32_t index = 0;
+
+            for ( uint32_t s = side / 2; s > 0; s /= 2 )
+            {
+                uint32_t rx = ( x & s ) > 0;
+                uint32_t ry = ( y & s ) > 0;
+                index += s * s * ( ( 3 * rx ) ^ ry );
+
+                // Rotates the quadrant so that the sub curve is traversed in the right orientation.
+                if ( ry == 0 )
+                {
+                    if ( rx == 1 )
+                    {
+                        x = side - 1 - x;
+                        y = side - 1 - y;
+                    }
+
+                    std::swap( x, y );
+                }
+            }
+
+            return index;
+        }
+    } // namespace
+
+    TileScheduler::TileScheduler( SizeType imageWidth, SizeType imageHeight, SizeType tileSize, TileOrder order )
+    {
+        tileSize                   = std::max( tileSize, SizeType( 1 ) );
+
+        const uint32_t tileColumns = uint32_t( ( imageWidth + tileSize - 1 ) / tileSize );
+        const uint32_t tileRows    = uint32_t( ( imageHeight + tileSize - 1 ) / tileSize );
+        const uint32_t side        = std::bit_ceil( std::max( tileColumns, tileRows ) );
+
+        std::vector<std::pair<uint32_t, Tile>> keyedTiles;
+        keyedTiles.reserve( SizeType( tileColumns ) * tileRows );
+
+        for ( uint32_t row = 0; row < tileRows; row++ )
+        {
+            for ( uint32_t column = 0; column < tileColumns; column++ )
+            {
+                Tile tile;
+                tile.x      = column * tileSize;
+                tile.y      = row * tileSize;
+                tile.width  = std::min( tileSize, imageWidth - tile.x );
+                tile.height = std::min( tileSize, imageHeight - tile.y );
+
+                uint32_t key;
+
+                switch ( order )
+                {
+                    case TileOrder::Morton:
+                        key = MortonIndex( column, row );
+                        break;
+                    case TileOrder::Hilbert:
+                        key = HilbertIndex( side, column, row );
+                        break;
+                    default:
+                        key = row * tileColumns + column;
+                        break;
+                }
+
+                keyedTiles.emplace_back( key, tile );
+            }
+        }
+
+        std::sort( keyedTiles.begin( ), keyedTiles.end( ),
+            []( const auto& a, const auto& b )
+            {
+                return a.first < b.first;
+            } );
+
+        tiles.reserve( keyedTiles.size( ) );
+
+        for ( const auto& keyedTile : keyedTiles )
+        {
+            tiles.push_back( keyedTile.second );
+        }
+    }
+
+    void TileScheduler::Distribute( SizeType workerCount )
+    {
+        this->workerCount = std::max( workerCount, SizeType( 1 ) );
+        queues            = std::make_unique<WorkerQueue[]>( this->workerCount );
+
+        for ( SizeType worker = 0; worker < this->workerCount; worker++ )
+        {
+            SizeType begin = tiles.size( ) * worker / this->workerCount;
+            SizeType end   = tiles.size( ) * ( worker + 1 ) / this->workerCount;
+
+            for ( SizeType t = begin; t < end; t++ )
+            {
+                queues[ worker ].tileIndices.push_back( uint32_t( t ) );
+            }
+        }
+    }
+
+    bool TileScheduler::Next( SizeType worker, Tile& tile )
+    {
+        {
+            WorkerQueue&                own = queues[ worker ];
+            std::lock_guard<std::mutex> lock( own.mutex );
+
+            if ( !own.tileIndices.empty( ) )
+            {
+                tile = tiles[ own.tileIndices.front( ) ];
+                own.tileIndices.pop_front( );
+                return true;
+            }
+        }
+
+        // Steals the tile furthest along the curve from the victim, away from the tiles it is about to render.
+        for ( SizeType offset = 1; offset < workerCount; offset++ )
+        {
+            WorkerQueue&                victim = queues[ ( worker + offset ) % workerCount ];
+            std::lock_guard<std::mutex> lock( victim.mutex );
+
+            if ( !victim.tileIndices.empty( ) )
+            {
+                tile = tiles[ victim.tileIndices.back( ) ];
+                victim.tileIndices.pop_back( );
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+} // namespace RayTracer
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace RayTracer
+{
+
+    struct Tile
+    {
+            SizeType x;
+            SizeType y;
+            SizeType width;
+            SizeType height;
+    };
+
+    enum class TileOrder
+    {
+        Scanline,
+        Morton,
+        Hilbert
+    };
+
+    // Splits an image into square tiles, ordered along a space filling curve so that consecutive tiles touch similar
+    // parts of the scene. Each worker owns a contiguous run of the curve in its own deque and takes tiles from its front.
+    // A worker whose deque is empty steals from the back of the deque of another worker, which keeps all threads busy
+    // when the cost of the tiles is uneven.
+    class TileScheduler
+    {
+        private:
+
+            struct alignas( 64 ) WorkerQueue
+            {
+                    std::mutex           mutex;
+                    std::deque<uint32_t> tileIndices;
+            };
+
+            std::vector<Tile>              tiles;
+            std::unique_ptr<WorkerQueue[]> queues;
+            SizeType                       workerCount = 0;
+
+        public:
+
+            TileScheduler( SizeType imageWidth, SizeType imageHeight, SizeType tileSize = 32, TileOrder order = TileOrder::Hilbert );
+
+            // Deals the tiles out to workerCount deques. Must be called before any worker calls Next.
+            void                     Distribute( SizeType workerCount );
+
+            // Returns false once every tile has been handed out.
+            bool                     Next( SizeType worker, Tile& tile );
+
+            const std::vector<Tile>& GetTiles( ) const
+            {
+                return tiles;
+            }
+    };
+
+} // namespace RayTracer
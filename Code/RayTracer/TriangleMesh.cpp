@@ -0,0 +1,311 @@
+#include "TriangleMesh.hpp"
+
+#include "omp.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+namespace RayTracer
+{
+
+    TriangleMesh::TriangleMesh( TriangleMeshData data, MaterialId materialId, Kernel kernel, Bvh::BuildMethod buildMethod ) :
+        data( std::move( data ) ), materialId( materialId ), kernel( kernel )
+    {
+        TriangleMeshData& d           = this->data;
+        SizeType          vertexCount = std::min( { d.positionX.size( ), d.positionY.size( ), d.positionZ.size( ) } );
+
+        d.positionX.resize( vertexCount );
+        d.positionY.resize( vertexCount );
+        d.positionZ.resize( vertexCount );
+
+        if ( d.normalX.size( ) != vertexCount || d.normalY.size( ) != vertexCount || d.normalZ.size( ) != vertexCount )
+        {
+            d.normalX.clear( );
+            d.normalY.clear( );
+            d.normalZ.clear( );
+        }
+
+        if ( d.textureU.size( ) != vertexCount || d.textureV.size( ) != vertexCount )
+        {
+            d.textureU.clear( );
+            d.textureV.clear( );
+        }
+
+        // Moves the valid triangles to the front of the index buffer, which also drops a trailing partial triangle.
+        SizeType validIndexCount = 0;
+
+        for ( SizeType i = 0; i + 2 < d.indices.size( ); i += 3 )
+        {
+            if ( d.indices[ i ] < vertexCount && d.indices[ i + 1 ] < vertexCount && d.indices[ i + 2 ] < vertexCount )
+            {
+                d.indices[ validIndexCount++ ] = d.indices[ i ];
+                d.indices[ validIndexCount++ ] = d.indices[ i + 1 ];
+                d.indices[ validIndexCount++ ] = d.indices[ i + 2 ];
+            }
+        }
+
+        d.indices.resize( validIndexCount );
+        d.indices.shrink_to_fit( );
+
+        const int          triangleCount = int( d.GetTriangleCount( ) );
+        std::vector<AabbR> boundingBoxes( triangleCount );
+
+#pragma omp parallel for
+        for ( int i = 0; i < triangleCount; i++ )
+        {
+            for ( SizeType corner = 0; corner < 3; corner++ )
+            {
+                boundingBoxes[ i ].Expand( GetPosition( d.indices[ 3 * SizeType( i ) + corner ] ) );
+            }
+        }
+
+        // The leaves of the tree refer to runs of triangles, so the index buffer is put in leaf order.
+        std::vector<uint32_t> triangleOrder;
+        Bvh                   binaryBvh( boundingBoxes, triangleOrder, buildMethod );
+        std::vector<uint32_t> orderedIndices( d.indices.size( ) );
+
+#pragma omp parallel for
+        for ( int i = 0; i < triangleCount; i++ )
+        {
+            for ( SizeType corner = 0; corner < 3; corner++ )
+            {
+                orderedIndices[ 3 * SizeType( i ) + corner ] = d.indices[ 3 * SizeType( triangleOrder[ i ] ) + corner ];
+            }
+        }
+
+        d.indices.swap( orderedIndices );
+
+        bvh = SceneBvh( std::move( binaryBvh ) );
+    }
+
+    bool TriangleMesh::IntersectMollerTrumbore( SizeType triangle, const RayR& ray, const IntervalR& rayParameterInterval, RealType& t, RealType& b1, RealType& b2 ) const
+    {
+        const uint32_t* vertices = &data.indices[ 3 * triangle ];
+
+        Point3R         p0       = GetPosition( vertices[ 0 ] );
+        Vec3R           edge1    = GetPosition( vertices[ 1 ] ) - p0;
+        Vec3R           edge2    = GetPosition( vertices[ 2 ] ) - p0;
+
+        Vec3R           p        = Cross( ray.GetDirection( ), edge2 );
+        RealType        det      = Dot( edge1, p );
+
+        // Both faces are hit. A zero determinant means a ray parallel to the plane of the triangle, or a degenerate one.
+        if ( det == 0 )
+        {
+            return false;
+        }
+
+        RealType inverseDet = RealType( 1 ) / det;
+        Vec3R    fromP0     = ray.GetOrigin( ) - p0;
+
+        b1                  = Dot( fromP0, p ) * inverseDet;
+        if ( b1 < 0 || b1 > 1 )
+        {
+            return false;
+        }
+
+        Vec3R q = Cross( fromP0, edge1 );
+
+        b2      = Dot( ray.GetDirection( ), q ) * inverseDet;
+        if ( b2 < 0 || b1 + b2 > 1 )
+        {
+            return false;
+        }
+
+        t = Dot( edge2, q ) * inverseDet;
+
+        return rayParameterInterval.Surrounds( t );
+    }
+
+    bool TriangleMesh::IntersectWatertight( SizeType triangle, const RayR& ray, const IntervalR& rayParameterInterval, RealType& t, RealType& b1, RealType& b2 ) const
+    {
+        const uint32_t* vertices  = &data.indices[ 3 * triangle ];
+        const Vec3R&    direction = ray.GetDirection( );
+
+        // Vertices relative to the ray origin, with the axes permuted so that the largest component of the direction is z.
+        SizeType        kz        = std::abs( direction[ 0 ] ) > std::abs( direction[ 1 ] ) ? ( std::abs( direction[ 0 ] ) > std::abs( direction[ 2 ] ) ? 0 : 2 )
+                                                                                             : ( std::abs( direction[ 1 ] ) > std::abs( direction[ 2 ] ) ? 1 : 2 );
+        SizeType        kx        = kz == 2 ? 0 : kz + 1;
+        SizeType        ky        = kx == 2 ? 0 : kx + 1;
+
+        RealType        x[ 3 ];
+        RealType        y[ 3 ];
+        RealType        z[ 3 ];
+
+        for ( SizeType i = 0; i < 3; i++ )
+        {
+            Vec3R p = GetPosition( vertices[ i ] ) - ray.GetOrigin( );
+            x[ i ]  = p[ kx ];
+            y[ i ]  = p[ ky ];
+            z[ i ]  = p[ kz ];
+        }
+
+        // Shear that takes the direction to the z axis. The 2D edge functions then tell on which side of each edge the
+        // ray passes, and rays through a shared edge see the same function of it with opposite signs.
+        RealType shearX = -direction[ kx ] / direction[ kz ];
+        RealType shearY = -direction[ ky ] / direction[ kz ];
+        RealType shearZ = RealType( 1 ) / direction[ kz ];
+
+        for ( SizeType i = 0; i < 3; i++ )
+        {
+            x[ i ] += shearX * z[ i ];
+            y[ i ] += shearY * z[ i ];
+        }
+
+        // Every edge function is evaluated from its end points in the same order in both triangles of the edge, and negated
+        // if needed, since multiplications fused into the subtraction would otherwise round the two differently.
+        auto     edgeFunction = [ &x, &y ]( SizeType a, SizeType b )
+        {
+            return x[ a ] < x[ b ] || ( x[ a ] == x[ b ] && y[ a ] < y[ b ] ) ? x[ a ] * y[ b ] - y[ a ] * x[ b ] : -( x[ b ] * y[ a ] - y[ b ] * x[ a ] );
+        };
+
+        RealType e0           = edgeFunction( 1, 2 );
+        RealType e1           = edgeFunction( 2, 0 );
+        RealType e2           = edgeFunction( 0, 1 );
+
+        // An edge function that rounds to zero in single precision is recomputed in double, which decides the side exactly.
+        if constexpr ( std::is_same_v<RealType, float> )
+        {
+            if ( e0 == 0 || e1 == 0 || e2 == 0 )
+            {
+                e0 = float( double( x[ 1 ] ) * double( y[ 2 ] ) - double( y[ 1 ] ) * double( x[ 2 ] ) );
+                e1 = float( double( x[ 2 ] ) * double( y[ 0 ] ) - double( y[ 2 ] ) * double( x[ 0 ] ) );
+                e2 = float( double( x[ 0 ] ) * double( y[ 1 ] ) - double( y[ 0 ] ) * double( x[ 1 ] ) );
+            }
+        }
+
+        if ( ( e0 < 0 || e1 < 0 || e2 < 0 ) && ( e0 > 0 || e1 > 0 || e2 > 0 ) )
+        {
+            return false;
+        }
+
+        RealType det = e0 + e1 + e2;
+
+        if ( det == 0 )
+        {
+            return false;
+        }
+
+        RealType inverseDet = RealType( 1 ) / det;
+
+        t                   = ( e0 * z[ 0 ] + e1 * z[ 1 ] + e2 * z[ 2 ] ) * shearZ * inverseDet;
+        b1                  = e1 * inverseDet;
+        b2                  = e2 * inverseDet;
+
+        return rayParameterInterval.Surrounds( t );
+    }
+
+    void TriangleMesh::FinalizeHit( const RayR& ray, const Intersection& intersection, HitRecord& hitRecord ) const
+    {
+        const uint32_t* vertices = &data.indices[ 3 * SizeType( intersection.primitiveIndex ) ];
+        const RealType  b[ 3 ]   = { RealType( 1 ) - intersection.u - intersection.v, intersection.u, intersection.v };
+
+        // The point is interpolated from the vertices rather than moved along the ray, so that its error does not grow
+        // with t.
+        const std::vector<RealType>* positions[ 3 ] = { &data.positionX, &data.positionY, &data.positionZ };
+        RealType                     maxMagnitude   = 0;
+
+        for ( SizeType axis = 0; axis < 3; axis++ )
+        {
+            const std::vector<RealType>& coordinates = *positions[ axis ];
+
+            hitRecord.point[ axis ] = b[ 0 ] * coordinates[ vertices[ 0 ] ] + b[ 1 ] * coordinates[ vertices[ 1 ] ] + b[ 2 ] * coordinates[ vertices[ 2 ] ];
+            maxMagnitude            = std::max( maxMagnitude, std::abs( b[ 0 ] * coordinates[ vertices[ 0 ] ] ) + std::abs( b[ 1 ] * coordinates[ vertices[ 1 ] ] )
+                                                                  + std::abs( b[ 2 ] * coordinates[ vertices[ 2 ] ] ) );
+        }
+
+        Point3R p0           = GetPosition( vertices[ 0 ] );
+        Vec3R   normal       = Normalize( Cross( GetPosition( vertices[ 1 ] ) - p0, GetPosition( vertices[ 2 ] ) - p0 ) );
+
+        hitRecord.t          = intersection.t;
+        hitRecord.pointError = RealType( 8 ) * std::numeric_limits<RealType>::epsilon( ) * maxMagnitude;
+        hitRecord.materialId = materialId;
+        hitRecord.lightId    = noLightId;
+        hitRecord.SetSurfaceNormal( ray, normal );
+
+        // Interpolated normals shade the mesh as a smooth surface, but stay on the side of the triangle the ray came from.
+        if ( !data.normalX.empty( ) )
+        {
+            Vec3R shadingNormal { 0.0, 0.0, 0.0 };
+
+            for ( SizeType i = 0; i < 3; i++ )
+            {
+                shadingNormal += b[ i ] * Vec3R { data.normalX[ vertices[ i ] ], data.normalY[ vertices[ i ] ], data.normalZ[ vertices[ i ] ] };
+            }
+
+            RealType length = shadingNormal.Magnitude( );
+
+            if ( length > 0 )
+            {
+                shadingNormal /= length;
+
+                hitRecord.surfaceNormal = Dot( shadingNormal, hitRecord.surfaceNormal ) < 0 ? -shadingNormal : shadingNormal;
+            }
+        }
+
+        // Without texture coordinates, the barycentric coordinates of vertices 1 and 2 parameterize the triangle.
+        if ( data.textureU.empty( ) )
+        {
+            hitRecord.uv = Point2R { b[ 1 ], b[ 2 ] };
+        }
+        else
+        {
+            hitRecord.uv = Point2R { b[ 0 ] * data.textureU[ vertices[ 0 ] ] + b[ 1 ] * data.textureU[ vertices[ 1 ] ] + b[ 2 ] * data.textureU[ vertices[ 2 ] ],
+                                     b[ 0 ] * data.textureV[ vertices[ 0 ] ] + b[ 1 ] * data.textureV[ vertices[ 1 ] ] + b[ 2 ] * data.textureV[ vertices[ 2 ] ] };
+        }
+    }
+
+    bool TriangleMesh::Intersect( const RayR& ray, const IntervalR& rayParameterInterval, Intersection& intersection ) const
+    {
+        return bvh.TraverseLeaves<false>( ray, rayParameterInterval,
+                                          [ & ]( uint32_t first, SizeType count, RealType& closest )
+                                          {
+                                              bool hitLeaf = false;
+
+                                              for ( uint32_t triangle = first; triangle < first + count; triangle++ )
+                                              {
+                                                  RealType t;
+                                                  RealType b1;
+                                                  RealType b2;
+
+                                                  if ( IntersectTriangle( triangle, ray, IntervalR( rayParameterInterval.GetFrom( ), closest ), t, b1, b2 ) )
+                                                  {
+                                                      intersection = Intersection { t, this, triangle, b1, b2 };
+                                                      closest      = t;
+                                                      hitLeaf      = true;
+                                                  }
+                                              }
+
+                                              return hitLeaf;
+                                          } );
+    }
+
+    bool TriangleMesh::Occluded( const RayR& ray, const IntervalR& rayParameterInterval ) const
+    {
+        return bvh.TraverseLeaves<true>( ray, rayParameterInterval,
+                                         [ & ]( uint32_t first, SizeType count, RealType& )
+                                         {
+                                             for ( uint32_t triangle = first; triangle < first + count; triangle++ )
+                                             {
+                                                 RealType t;
+                                                 RealType b1;
+                                                 RealType b2;
+
+                                                 if ( IntersectTriangle( triangle, ray, rayParameterInterval, t, b1, b2 ) )
+                                                 {
+                                                     return true;
+                                                 }
+                                             }
+
+                                             return false;
+                                         } );
+    }
+
+    AabbR TriangleMesh::GetBoundingBox( ) const
+    {
+        return bvh.GetBoundingBox( );
+    }
+
+} // namespace RayTracer
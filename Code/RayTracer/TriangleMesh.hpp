@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Hittable.hpp"
+#include "WideBvh.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace RayTracer
+{
+
+    // Vertex and index buffers of a TriangleMesh, in structure of arrays layout. Normals and texture coordinates are
+    // either empty or hold one entry per vertex.
+    struct TriangleMeshData
+    {
+            std::vector<RealType> positionX;
+            std::vector<RealType> positionY;
+            std::vector<RealType> positionZ;
+            std::vector<RealType> normalX;
+            std::vector<RealType> normalY;
+            std::vector<RealType> normalZ;
+            std::vector<RealType> textureU;
+            std::vector<RealType> textureV;
+
+            // Three vertex indices per triangle, counter clockwise seen from the front.
+            std::vector<uint32_t> indices;
+
+            SizeType              GetVertexCount( ) const
+            {
+                return positionX.size( );
+            }
+
+            SizeType              GetTriangleCount( ) const
+            {
+                return indices.size( ) / 3;
+            }
+    };
+
+    // Indexed triangle mesh. Vertices are stored once and shared by the triangles, which hold three indices each, so a
+    // triangle takes 12 bytes of index buffer plus its share of the vertices and of the SceneBvh of the mesh. The mesh is
+    // one object of the scene. Its SceneBvh is built over the bounding boxes of the triangles and its leaves index the
+    // index buffer directly, which the mesh keeps in leaf order.
+    class TriangleMesh : public Hittable
+    {
+        public:
+
+            enum class Kernel
+            {
+                MollerTrumbore, // Edge vectors and determinant (Moller and Trumbore 1997). Rays through the shared edges
+                                // and vertices of triangles may miss all of them because of rounding.
+                Watertight,     // Edge functions in a space sheared along the ray (Woop et al. 2013), where every ray
+                                // hits at least one of the triangles sharing an edge or vertex. A little slower.
+            };
+
+        private:
+
+            TriangleMeshData data;
+            MaterialId       materialId;
+            Kernel           kernel;
+            SceneBvh         bvh;
+
+            // Ray parameter and barycentric coordinates of vertices 1 and 2 of the hit of triangle within the interval.
+            bool             IntersectMollerTrumbore( SizeType triangle, const RayR& ray, const IntervalR& rayParameterInterval, RealType& t, RealType& b1, RealType& b2 ) const;
+
+            bool             IntersectWatertight( SizeType triangle, const RayR& ray, const IntervalR& rayParameterInterval, RealType& t, RealType& b1, RealType& b2 ) const;
+
+            bool             IntersectTriangle( SizeType triangle, const RayR& ray, const IntervalR& rayParameterInterval, RealType& t, RealType& b1, RealType& b2 ) const
+            {
+                return kernel == Kernel::Watertight ? IntersectWatertight( triangle, ray, rayParameterInterval, t, b1, b2 ) : IntersectMollerTrumbore( triangle, ray, rayParameterInterval, t, b1, b2 );
+            }
+
+            Point3R          GetPosition( uint32_t vertex ) const
+            {
+                return Point3R { data.positionX[ vertex ], data.positionY[ vertex ], data.positionZ[ vertex ] };
+            }
+
+        public:
+
+            // Triangles with indices past the vertices are dropped, as are normals and texture coordinates whose count
+            // differs from the vertex count. The remaining triangles are reordered to the leaves of the SceneBvh.
+            TriangleMesh( TriangleMeshData data, MaterialId materialId, Kernel kernel = Kernel::MollerTrumbore, Bvh::BuildMethod buildMethod = Bvh::BuildMethod::Sah );
+
+            // Records the barycentric coordinates of the hit in intersection, for FinalizeHit.
+            bool  Intersect( const RayR& ray, const IntervalR& rayParameterInterval, Intersection& intersection ) const override;
+
+            void  FinalizeHit( const RayR& ray, const Intersection& intersection, HitRecord& hitRecord ) const override;
+
+            bool  Occluded( const RayR& ray, const IntervalR& rayParameterInterval ) const override;
+
+            AabbR GetBoundingBox( ) const override;
+
+            const TriangleMeshData& GetData( ) const
+            {
+                return data;
+            }
+
+            Kernel GetKernel( ) const
+            {
+                return kernel;
+            }
+    };
+
+} // namespace RayTracer
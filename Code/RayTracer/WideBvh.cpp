@@ -0,0 +1,415 @@
+#include "WideBvh.hpp"
+#include "Simd.hpp"
+
+#include <bit>
+#include <cmath>
+#include <limits>
+
+namespace RayTracer
+{
+
+    namespace
+    {
+        float RoundDown( double v )
+        {
+            float f = float( v );
+            return double( f ) > v ? std::nextafter( f, -std::numeric_limits<float>::infinity( ) ) : f;
+        }
+
+        float RoundUp( double v )
+        {
+            float f = float( v );
+            return double( f ) < v ? std::nextafter( f, std::numeric_limits<float>::infinity( ) ) : f;
+        }
+
+        // Range of a * b over a in [aMin, aMax] and b in [bMin, bMax] lane by lane, as in RayPacketBounds::Classify.
+        template <class Pack>
+        void ProductRange( const Pack& aMin, const Pack& aMax, const Pack& bMin, const Pack& bMax, Pack& low, Pack& high )
+        {
+            Pack p0 = aMin * bMin;
+            Pack p1 = aMin * bMax;
+            Pack p2 = aMax * bMin;
+            Pack p3 = aMax * bMax;
+
+            low     = Min( Min( p0, p1 ), Min( p2, p3 ) );
+            high    = Max( Max( p0, p1 ), Max( p2, p3 ) );
+        }
+    } // namespace
+
+    template <SizeType Width>
+    WideBvh<Width>::WideBvh( const Bvh& bvh ) : primitives( bvh.GetPrimitives( ) ), boundingBox( bvh.GetBoundingBox( ) )
+    {
+        if ( bvh.GetNodes( ).empty( ) )
+        {
+            return;
+        }
+
+        nodes.reserve( bvh.GetNodes( ).size( ) / ( Width - 1 ) + 1 );
+        CollapseNode( bvh.GetNodes( ), 0 );
+    }
+
+    template <SizeType Width>
+    WideBvh<Width>::WideBvh( const HittableList& list, Bvh::BuildMethod buildMethod ) : WideBvh( Bvh( list, buildMethod ) )
+    {
+    }
+
+    template <SizeType Width>
+    uint32_t WideBvh<Width>::CollapseNode( const std::vector<Bvh::Node>& binaryNodes, uint32_t binaryNodeIndex )
+    {
+        uint32_t nodeIndex = uint32_t( nodes.size( ) );
+        nodes.emplace_back( );
+
+        // Gather the children by repeatedly opening the interior slot with the largest surface area.
+        uint32_t slots[ Width ];
+        SizeType slotCount = 0;
+
+        if ( binaryNodes[ binaryNodeIndex ].IsLeaf( ) )
+        {
+            slots[ slotCount++ ] = binaryNodeIndex;
+        }
+        else
+        {
+            slots[ slotCount++ ] = binaryNodeIndex + 1;
+            slots[ slotCount++ ] = binaryNodes[ binaryNodeIndex ].offset;
+        }
+
+        while ( slotCount < Width )
+        {
+            SizeType bestSlot = Width;
+            double   bestArea = -1.0;
+
+            for ( SizeType s = 0; s < slotCount; s++ )
+            {
+                const Bvh::Node& candidate = binaryNodes[ slots[ s ] ];
+
+                if ( !candidate.IsLeaf( ) && candidate.boundingBox.GetSurfaceArea( ) > bestArea )
+                {
+                    bestSlot = s;
+                    bestArea = candidate.boundingBox.GetSurfaceArea( );
+                }
+            }
+
+            if ( bestSlot == Width )
+            {
+                break;
+            }
+
+            uint32_t opened        = slots[ bestSlot ];
+            slots[ bestSlot ]      = opened + 1;
+            slots[ slotCount++ ]   = binaryNodes[ opened ].offset;
+        }
+
+        Node node;
+
+        for ( SizeType s = 0; s < Width; s++ )
+        {
+            node.minX[ s ] = node.minY[ s ] = node.minZ[ s ] = std::numeric_limits<float>::infinity( );
+            node.maxX[ s ] = node.maxY[ s ] = node.maxZ[ s ] = -std::numeric_limits<float>::infinity( );
+            node.children[ s ]        = 0;
+            node.primitiveCounts[ s ] = 0;
+        }
+
+        for ( SizeType s = 0; s < slotCount; s++ )
+        {
+            const Bvh::Node& child = binaryNodes[ slots[ s ] ];
+
+            node.minX[ s ]         = RoundDown( child.boundingBox.GetMin( )[ 0 ] );
+            node.minY[ s ]         = RoundDown( child.boundingBox.GetMin( )[ 1 ] );
+            node.minZ[ s ]         = RoundDown( child.boundingBox.GetMin( )[ 2 ] );
+            node.maxX[ s ]         = RoundUp( child.boundingBox.GetMax( )[ 0 ] );
+            node.maxY[ s ]         = RoundUp( child.boundingBox.GetMax( )[ 1 ] );
+            node.maxZ[ s ]         = RoundUp( child.boundingBox.GetMax( )[ 2 ] );
+
+            if ( child.IsLeaf( ) )
+            {
+                node.children[ s ]        = child.offset;
+                node.primitiveCounts[ s ] = child.primitiveCount;
+            }
+            else
+            {
+                node.children[ s ] = CollapseNode( binaryNodes, slots[ s ] );
+            }
+        }
+
+        // The near to far order of the slots for a direction octant follows from the split axes of the opened binary nodes.
+        for ( uint32_t octant = 0; octant < 8; octant++ )
+        {
+            uint32_t order         = 0;
+            SizeType position      = 0;
+
+            auto     appendInOrder = [ & ]( auto& self, uint32_t binaryIndex ) -> void
+            {
+                for ( SizeType s = 0; s < slotCount; s++ )
+                {
+                    if ( slots[ s ] == binaryIndex )
+                    {
+                        order |= uint32_t( s ) << ( 4 * position++ );
+                        return;
+                    }
+                }
+
+                const Bvh::Node& opened = binaryNodes[ binaryIndex ];
+                bool             flip   = ( octant >> opened.splitAxis ) & 1;
+
+                self( self, flip ? opened.offset : binaryIndex + 1 );
+                self( self, flip ? binaryIndex + 1 : opened.offset );
+            };
+
+            appendInOrder( appendInOrder, binaryNodeIndex );
+
+            for ( SizeType s = slotCount; s < Width; s++ )
+            {
+                order |= uint32_t( s ) << ( 4 * position++ );
+            }
+
+            node.traversalOrders[ octant ] = order;
+        }
+
+        nodes[ nodeIndex ] = node;
+
+        return nodeIndex;
+    }
+
+    template <SizeType Width>
+    template <bool AnyHit>
+    bool WideBvh<Width>::Traverse( const RayR& ray, const IntervalR& rayParameterInterval, Intersection& intersection ) const
+    {
+        return TraverseLeaves<AnyHit>( ray, rayParameterInterval,
+                                       [ & ]( uint32_t first, SizeType count, RealType& closest )
+                                       {
+                                           bool hitLeaf = false;
+
+                                           for ( SizeType i = 0; i < count; i++ )
+                                           {
+                                               if constexpr ( AnyHit )
+                                               {
+                                                   if ( primitives[ first + i ]->Occluded( ray, rayParameterInterval ) )
+                                                   {
+                                                       return true;
+                                                   }
+                                               }
+                                               else if ( primitives[ first + i ]->Intersect( ray, IntervalR( rayParameterInterval.GetFrom( ), closest ), intersection ) )
+                                               {
+                                                   hitLeaf = true;
+                                                   closest = intersection.t;
+                                               }
+                                           }
+
+                                           return hitLeaf;
+                                       } );
+    }
+
+    template <SizeType Width>
+    bool WideBvh<Width>::Intersect( const RayR& ray, const IntervalR& rayParameterInterval, Intersection& intersection ) const
+    {
+        return Traverse<false>( ray, rayParameterInterval, intersection );
+    }
+
+    template <SizeType Width>
+    LaneMask WideBvh<Width>::IntersectPacket( RayPacket& packet, LaneMask activeMask, Intersection* intersections ) const
+    {
+        if ( nodes.empty( ) || activeMask == 0 )
+        {
+            return 0;
+        }
+
+        using Pack = Simd<float, Width>;
+
+        struct StackEntry
+        {
+                uint32_t index;
+                uint32_t primitiveCount;
+                LaneMask activeMask;
+        };
+
+        struct LaneRay
+        {
+                Pack originX;
+                Pack originY;
+                Pack originZ;
+                Pack inverseDirectionX;
+                Pack inverseDirectionY;
+                Pack inverseDirectionZ;
+                Pack tFrom;
+                bool directionIsNegative[ 3 ];
+        };
+
+        LaneRay laneRays[ RayPacket::Size ];
+
+        for ( SizeType lane = 0; lane < RayPacket::Size; lane++ )
+        {
+            if ( activeMask & ( 1u << lane ) )
+            {
+                laneRays[ lane ] = LaneRay { Pack::Broadcast( float( packet.originX[ lane ] ) ),
+                                             Pack::Broadcast( float( packet.originY[ lane ] ) ),
+                                             Pack::Broadcast( float( packet.originZ[ lane ] ) ),
+                                             Pack::Broadcast( float( 1.0 / packet.directionX[ lane ] ) ),
+                                             Pack::Broadcast( float( 1.0 / packet.directionY[ lane ] ) ),
+                                             Pack::Broadcast( float( 1.0 / packet.directionZ[ lane ] ) ),
+                                             Pack::Broadcast( float( packet.tFrom[ lane ] ) ),
+                                             { std::signbit( packet.directionX[ lane ] ), std::signbit( packet.directionY[ lane ] ), std::signbit( packet.directionZ[ lane ] ) } };
+            }
+        }
+
+        // Packet bounds rounded outwards to single precision, like the child boxes.
+        const RayPacketBounds bounds = packet.GetBounds( activeMask );
+
+        Pack                  originMin[ 3 ];
+        Pack                  originMax[ 3 ];
+        Pack                  inverseDirectionMin[ 3 ];
+        Pack                  inverseDirectionMax[ 3 ];
+
+        for ( SizeType axis = 0; axis < 3; axis++ )
+        {
+            originMin[ axis ]           = Pack::Broadcast( RoundDown( bounds.originMin[ axis ] ) );
+            originMax[ axis ]           = Pack::Broadcast( RoundUp( bounds.originMax[ axis ] ) );
+            inverseDirectionMin[ axis ] = Pack::Broadcast( RoundDown( bounds.inverseDirectionMin[ axis ] ) );
+            inverseDirectionMax[ axis ] = Pack::Broadcast( RoundUp( bounds.inverseDirectionMax[ axis ] ) );
+        }
+
+        const Pack boundsFrom = Pack::Broadcast( RoundDown( bounds.tFrom ) );
+        const Pack boundsTo   = Pack::Broadcast( RoundUp( bounds.tTo ) );
+
+        // Widens the far distances by a few ulps to compensate for the single precision slab computation, as in Traverse.
+        const Pack farScale   = Pack::Broadcast( 1.0f + 4.0f * std::numeric_limits<float>::epsilon( ) );
+
+        // Children are visited in the order of the first ray, which suits all of them in a coherent packet.
+        const SizeType firstLane = std::countr_zero( activeMask );
+        const uint32_t octant    = uint32_t( std::signbit( packet.directionX[ firstLane ] ) ) | uint32_t( std::signbit( packet.directionY[ firstLane ] ) ) << 1
+                                 | uint32_t( std::signbit( packet.directionZ[ firstLane ] ) ) << 2;
+
+        StackEntry     stack[ maxWideBvhDepth * ( Width - 1 ) + 1 ];
+        SizeType       stackSize = 0;
+        stack[ stackSize++ ]     = StackEntry { 0, 0, activeMask };
+
+        LaneMask       hits      = 0;
+
+        while ( stackSize > 0 )
+        {
+            const StackEntry entry = stack[ --stackSize ];
+
+            if ( entry.primitiveCount > 0 )
+            {
+                for ( SizeType i = 0; i < entry.primitiveCount; i++ )
+                {
+                    hits |= primitives[ entry.index + i ]->IntersectPacket( packet, entry.activeMask, intersections );
+                }
+
+                continue;
+            }
+
+            const Node& node                = nodes[ entry.index ];
+            LaneMask    childMasks[ Width ] = { };
+
+            // Children hit by none of the rays, and children hit by all of them, according to the packet bounds.
+            uint32_t    candidates = ( 1u << Width ) - 1;
+            uint32_t    allHit     = 0;
+
+            if ( bounds.isValid )
+            {
+                const float* nearPlanes[ 3 ] = { bounds.directionIsNegative[ 0 ] ? node.maxX : node.minX, bounds.directionIsNegative[ 1 ] ? node.maxY : node.minY, bounds.directionIsNegative[ 2 ] ? node.maxZ : node.minZ };
+                const float* farPlanes[ 3 ]  = { bounds.directionIsNegative[ 0 ] ? node.minX : node.maxX, bounds.directionIsNegative[ 1 ] ? node.minY : node.maxY, bounds.directionIsNegative[ 2 ] ? node.minZ : node.maxZ };
+
+                Pack         entryLow        = boundsFrom;
+                Pack         entryHigh       = boundsFrom;
+                Pack         exitLow         = Pack::Broadcast( float( packet.GetEarliestEnd( entry.activeMask ) ) );
+                Pack         exitHigh        = boundsTo;
+
+                for ( SizeType axis = 0; axis < 3; axis++ )
+                {
+                    Pack nearPlane = Pack::Load( nearPlanes[ axis ] );
+                    Pack farPlane  = Pack::Load( farPlanes[ axis ] );
+                    Pack low;
+                    Pack high;
+
+                    ProductRange( nearPlane - originMax[ axis ], nearPlane - originMin[ axis ], inverseDirectionMin[ axis ], inverseDirectionMax[ axis ], low, high );
+                    entryLow  = Max( entryLow, low );
+                    entryHigh = Max( entryHigh, high );
+
+                    ProductRange( farPlane - originMax[ axis ], farPlane - originMin[ axis ], inverseDirectionMin[ axis ], inverseDirectionMax[ axis ], low, high );
+                    exitLow   = Min( exitLow, low );
+                    exitHigh  = Min( exitHigh, high );
+                }
+
+                candidates = MoveMask( entryLow <= exitHigh * farScale );
+                allHit     = MoveMask( entryHigh <= exitLow ) & candidates;
+
+                for ( uint32_t slots = allHit; slots != 0; slots &= slots - 1 )
+                {
+                    childMasks[ std::countr_zero( slots ) ] = entry.activeMask;
+                }
+            }
+
+            // The remaining candidates are tested ray by ray.
+            candidates &= ~allHit;
+
+            const Pack minX = Pack::Load( node.minX );
+            const Pack minY = Pack::Load( node.minY );
+            const Pack minZ = Pack::Load( node.minZ );
+            const Pack maxX = Pack::Load( node.maxX );
+            const Pack maxY = Pack::Load( node.maxY );
+            const Pack maxZ = Pack::Load( node.maxZ );
+
+            for ( SizeType lane = 0; candidates != 0 && lane < RayPacket::Size; lane++ )
+            {
+                if ( !( entry.activeMask & ( 1u << lane ) ) )
+                {
+                    continue;
+                }
+
+                // The rays of a packet may differ in direction signs, so the near and far planes are chosen per ray.
+                const LaneRay& ray      = laneRays[ lane ];
+
+                Pack           nearX    = ( ( ray.directionIsNegative[ 0 ] ? maxX : minX ) - ray.originX ) * ray.inverseDirectionX;
+                Pack           nearY    = ( ( ray.directionIsNegative[ 1 ] ? maxY : minY ) - ray.originY ) * ray.inverseDirectionY;
+                Pack           nearZ    = ( ( ray.directionIsNegative[ 2 ] ? maxZ : minZ ) - ray.originZ ) * ray.inverseDirectionZ;
+                Pack           farX     = ( ( ray.directionIsNegative[ 0 ] ? minX : maxX ) - ray.originX ) * ray.inverseDirectionX;
+                Pack           farY     = ( ( ray.directionIsNegative[ 1 ] ? minY : maxY ) - ray.originY ) * ray.inverseDirectionY;
+                Pack           farZ     = ( ( ray.directionIsNegative[ 2 ] ? minZ : maxZ ) - ray.originZ ) * ray.inverseDirectionZ;
+
+                Pack           tNear    = Max( Max( nearX, nearY ), Max( nearZ, ray.tFrom ) );
+                Pack           tFar     = Min( Min( farX, farY ), Min( farZ, Pack::Broadcast( float( packet.tTo[ lane ] ) ) ) ) * farScale;
+
+                uint32_t       laneHits = MoveMask( tNear <= tFar ) & candidates;
+
+                for ( ; laneHits != 0; laneHits &= laneHits - 1 )
+                {
+                    childMasks[ std::countr_zero( laneHits ) ] |= 1u << lane;
+                }
+            }
+
+            // Push far to near so that the nearest child is popped first.
+            uint32_t order = node.traversalOrders[ octant ];
+
+            for ( SizeType position = Width; position-- > 0; )
+            {
+                uint32_t slot = ( order >> ( 4 * position ) ) & 0xf;
+
+                if ( childMasks[ slot ] != 0 )
+                {
+                    stack[ stackSize++ ] = StackEntry { node.children[ slot ], node.primitiveCounts[ slot ], childMasks[ slot ] };
+                }
+            }
+        }
+
+        return hits;
+    }
+
+    template <SizeType Width>
+    bool WideBvh<Width>::Occluded( const RayR& ray, const IntervalR& rayParameterInterval ) const
+    {
+        Intersection unused;
+
+        return Traverse<true>( ray, rayParameterInterval, unused );
+    }
+
+    template <SizeType Width>
+    AabbR WideBvh<Width>::GetBoundingBox( ) const
+    {
+        return boundingBox;
+    }
+
+    template class WideBvh<4>;
+    template class WideBvh<8>;
+
+} // namespace RayTracer
@@ -0,0 +1,207 @@
+#pragma once
+
+#include "Bvh.hpp"
+#include "Simd.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace RayTracer
+{
+
+    // Bvh collapsed into nodes of Width children. The child boxes of a node are stored as single precision structure of
+    // arrays, rounded outwards, so that all of them are tested against a ray with one Simd<float, Width> sequence. Leaves
+    // are stored in their parent's child slots.
+    template <SizeType Width>
+    class WideBvh : public Hittable
+    {
+            static_assert( Width == 4 || Width == 8, "WideBvh supports 4 and 8 wide nodes" );
+
+        public:
+
+            struct alignas( 64 ) Node
+            {
+                    float    minX[ Width ];
+                    float    minY[ Width ];
+                    float    minZ[ Width ];
+                    float    maxX[ Width ];
+                    float    maxY[ Width ];
+                    float    maxZ[ Width ];
+
+                    uint32_t children[ Width ];        // Interior child: node index. Leaf child: index of the first primitive.
+                    uint16_t primitiveCounts[ Width ]; // Zero for interior children and unused slots.
+
+                    // For each ray direction octant, the child slots in near to far order as 4 bit fields.
+                    uint32_t traversalOrders[ 8 ];
+            };
+
+        private:
+
+            // A wide node takes at least one level of the binary tree, so its depth is bounded by that of the Bvh.
+            static constexpr SizeType            maxWideBvhDepth = 128;
+
+            std::vector<Node>                    nodes;
+            std::vector<SharedPointer<Hittable>> primitives;
+            AabbR                                boundingBox;
+
+            uint32_t                             CollapseNode( const std::vector<Bvh::Node>& binaryNodes, uint32_t binaryNodeIndex );
+
+            // Shared by Intersect and Occluded. With AnyHit, traversal stops at the first primitive hit.
+            template <bool AnyHit>
+            bool                                 Traverse( const RayR& ray, const IntervalR& rayParameterInterval, Intersection& intersection ) const;
+
+        public:
+
+            WideBvh( )
+            {
+            }
+
+            WideBvh( const Bvh& bvh );
+
+            WideBvh( const HittableList& list, Bvh::BuildMethod buildMethod = Bvh::BuildMethod::Sah );
+
+            // As Bvh::TraverseLeaves, for a tree collapsed from a Bvh built over bounding boxes.
+            template <bool AnyHit, class LeafFunction>
+            bool                     TraverseLeaves( const RayR& ray, const IntervalR& rayParameterInterval, LeafFunction&& intersectLeaf ) const;
+
+            bool                     Intersect( const RayR& ray, const IntervalR& rayParameterInterval, Intersection& intersection ) const override;
+
+            // Traverses the tree once for the whole packet. The children of a node that no ray of the packet can hit are
+            // culled with one Simd test of the packet bounds, before the rays test the others one by one.
+            LaneMask                 IntersectPacket( RayPacket& packet, LaneMask activeMask, Intersection* intersections ) const override;
+
+            bool                     Occluded( const RayR& ray, const IntervalR& rayParameterInterval ) const override;
+
+            AabbR                    GetBoundingBox( ) const override;
+
+            const std::vector<Node>& GetNodes( ) const
+            {
+                return nodes;
+            }
+    };
+
+    template <SizeType Width>
+    template <bool AnyHit, class LeafFunction>
+    bool WideBvh<Width>::TraverseLeaves( const RayR& ray, const IntervalR& rayParameterInterval, LeafFunction&& intersectLeaf ) const
+    {
+        if ( nodes.empty( ) )
+        {
+            return false;
+        }
+
+        using Pack = Simd<float, Width>;
+
+        struct StackEntry
+        {
+                uint32_t index;
+                uint32_t primitiveCount;
+                float    tNear;
+        };
+
+        const Vec3R&   direction = ray.GetDirection( );
+        const Point3R& origin    = ray.GetOrigin( );
+
+        // The sign bit matches the infinite inverse of a zero component, which selects the slab planes that keep a ray
+        // inside the slab from missing it.
+        const bool     directionIsNegative[ 3 ] = { std::signbit( direction[ 0 ] ), std::signbit( direction[ 1 ] ), std::signbit( direction[ 2 ] ) };
+        const uint32_t octant                   = uint32_t( directionIsNegative[ 0 ] ) | uint32_t( directionIsNegative[ 1 ] ) << 1 | uint32_t( directionIsNegative[ 2 ] ) << 2;
+
+        const Pack     originX                  = Pack::Broadcast( float( origin[ 0 ] ) );
+        const Pack     originY                  = Pack::Broadcast( float( origin[ 1 ] ) );
+        const Pack     originZ                  = Pack::Broadcast( float( origin[ 2 ] ) );
+        const Pack     inverseDirectionX        = Pack::Broadcast( float( 1.0 / direction[ 0 ] ) );
+        const Pack     inverseDirectionY        = Pack::Broadcast( float( 1.0 / direction[ 1 ] ) );
+        const Pack     inverseDirectionZ        = Pack::Broadcast( float( 1.0 / direction[ 2 ] ) );
+        const Pack     tFrom                    = Pack::Broadcast( float( rayParameterInterval.GetFrom( ) ) );
+
+        // Widens the far distances by a few ulps to compensate for the single precision slab computation.
+        const Pack     farScale                 = Pack::Broadcast( 1.0f + 4.0f * std::numeric_limits<float>::epsilon( ) );
+
+        StackEntry     stack[ maxWideBvhDepth * ( Width - 1 ) + 1 ];
+        SizeType       stackSize    = 0;
+        stack[ stackSize++ ]        = StackEntry { 0, 0, -std::numeric_limits<float>::infinity( ) };
+
+        bool           hitSomething = false;
+        RealType       closest      = rayParameterInterval.GetTo( );
+
+        alignas( sizeof( Pack ) ) float tNearLanes[ Width ];
+
+        while ( stackSize > 0 )
+        {
+            const StackEntry entry = stack[ --stackSize ];
+
+            if ( RealType( entry.tNear ) > closest )
+            {
+                continue;
+            }
+
+            if ( entry.primitiveCount > 0 )
+            {
+                if ( intersectLeaf( entry.index, SizeType( entry.primitiveCount ), closest ) )
+                {
+                    if constexpr ( AnyHit )
+                    {
+                        return true;
+                    }
+
+                    hitSomething = true;
+                }
+
+                continue;
+            }
+
+            const Node& node  = nodes[ entry.index ];
+
+            Pack        nearX = ( Pack::Load( directionIsNegative[ 0 ] ? node.maxX : node.minX ) - originX ) * inverseDirectionX;
+            Pack        nearY = ( Pack::Load( directionIsNegative[ 1 ] ? node.maxY : node.minY ) - originY ) * inverseDirectionY;
+            Pack        nearZ = ( Pack::Load( directionIsNegative[ 2 ] ? node.maxZ : node.minZ ) - originZ ) * inverseDirectionZ;
+            Pack        farX  = ( Pack::Load( directionIsNegative[ 0 ] ? node.minX : node.maxX ) - originX ) * inverseDirectionX;
+            Pack        farY  = ( Pack::Load( directionIsNegative[ 1 ] ? node.minY : node.maxY ) - originY ) * inverseDirectionY;
+            Pack        farZ  = ( Pack::Load( directionIsNegative[ 2 ] ? node.minZ : node.maxZ ) - originZ ) * inverseDirectionZ;
+
+            Pack        tNear = Max( Max( nearX, nearY ), Max( nearZ, tFrom ) );
+            Pack        tFar  = Min( Min( farX, farY ), Min( farZ, Pack::Broadcast( float( closest ) ) ) ) * farScale;
+
+            uint32_t    hits  = MoveMask( tNear <= tFar );
+
+            if ( hits == 0 )
+            {
+                continue;
+            }
+
+            tNear.Store( tNearLanes );
+
+            // Push far to near so that the nearest child is popped first.
+            uint32_t order = node.traversalOrders[ octant ];
+
+            for ( SizeType position = Width; position-- > 0; )
+            {
+                uint32_t slot = ( order >> ( 4 * position ) ) & 0xf;
+
+                if ( hits & ( 1u << slot ) )
+                {
+                    stack[ stackSize++ ] = StackEntry { node.children[ slot ], node.primitiveCounts[ slot ], tNearLanes[ slot ] };
+                }
+            }
+        }
+
+        return hitSomething;
+    }
+
+
+    extern template class WideBvh<4>;
+    extern template class WideBvh<8>;
+
+    using Bvh4 = WideBvh<4>;
+    using Bvh8 = WideBvh<8>;
+
+    // Acceleration structure used by the applications, chosen with the RAYTRACER_BVH_WIDTH build option.
+#if !defined( RAYTRACER_BVH_WIDTH ) || RAYTRACER_BVH_WIDTH == 2
+    using SceneBvh = Bvh;
+#else
+    using SceneBvh = WideBvh<RAYTRACER_BVH_WIDTH>;
+#endif
+
+} // namespace RayTracer
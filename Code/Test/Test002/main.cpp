@@ -1,24 +1,26 @@
+#include <chrono>
 #include <iostream>
 
 #include "Camera.hpp"
 #include "Image.hpp"
 #include "Material.hpp"
+#include "WideBvh.hpp"
 
 using namespace RayTracer;
 
-HittableList CreateWorld( )
+HittableList CreateWorld( MaterialTable& materials )
 {
-    auto groundMaterial       = std::make_shared<Lambertian>( RgbD( 0.8, 0.8, 0.0 ) );
-    auto centerSphereMaterial = std::make_shared<Lambertian>( RgbD( 0.1, 0.2, 0.5 ) );
-    auto leftSphereMaterial   = std::make_shared<Metal>( RgbD( 0.8, 0.8, 0.8 ) );
-    auto rightSphereMaterial  = std::make_shared<Metal>( RgbD( 0.8, 0.6, 0.2 ) );
+    auto groundMaterial       = materials.Add( Lambertian( RgbR( 0.8, 0.8, 0.0 ) ) );
+    auto centerSphereMaterial = materials.Add( Lambertian( RgbR( 0.1, 0.2, 0.5 ) ) );
+    auto leftSphereMaterial   = materials.Add( Metal( RgbR( 0.8, 0.8, 0.8 ) ) );
+    auto rightSphereMaterial  = materials.Add( Metal( RgbR( 0.8, 0.6, 0.2 ) ) );
 
     //
     HittableList world;
-    world.objects.push_back( std::make_shared<Sphere>( Point3D{ 0.0, -100.5, -1.0 }, 100.0, groundMaterial ) );
-    world.objects.push_back( std::make_shared<Sphere>( Point3D{ 0.0, 0, -1.2 }, 0.5, centerSphereMaterial ) );
-    world.objects.push_back( std::make_shared<Sphere>( Point3D { -1.0, 0.0, -1.0 }, 0.5, leftSphereMaterial ) );
-    world.objects.push_back( std::make_shared<Sphere>( Point3D{ 1.0, 0.0, -1.0 }, 0.5, rightSphereMaterial ) );
+    world.objects.push_back( std::make_shared<Sphere>( Point3R{ 0.0, -100.5, -1.0 }, 100.0, groundMaterial ) );
+    world.objects.push_back( std::make_shared<Sphere>( Point3R{ 0.0, 0, -1.2 }, 0.5, centerSphereMaterial ) );
+    world.objects.push_back( std::make_shared<Sphere>( Point3R { -1.0, 0.0, -1.0 }, 0.5, leftSphereMaterial ) );
+    world.objects.push_back( std::make_shared<Sphere>( Point3R{ 1.0, 0.0, -1.0 }, 0.5, rightSphereMaterial ) );
 
     return world;
 }
@@ -30,17 +32,26 @@ int main( )
     double             cameraFocalLength            = 1.0;
     double             cameraVerticalFieldOfViewDeg = 90.0;
     SizeType           maxBounces                   = 10;
-    SizeType           samplesPerPixel              = 500;
+    SizeType           minSamplesPerPixel           = 16;
+    SizeType           maxSamplesPerPixel           = 500;
+    double             maxError                     = 0.004;
 
     std::vector<Rgba8> buffer( 640 * 480 );
 
     RgbaImageView8     renderBuffer = RgbaImageView8( reinterpret_cast<uint8_t*>( buffer.data( ) ), 640, 480, 640 * sizeof( Rgba8 ) );
 
-    HittableList       world        = CreateWorld( );
+    MaterialTable      materials;
+    LightList          lights;
+    SceneBvh           world( CreateWorld( materials ) );
 
     //
     Camera camera( cameraFocalLength, cameraVerticalFieldOfViewDeg );
-    camera.Render( world, renderBuffer, maxBounces, samplesPerPixel );
+
+    auto     start       = std::chrono::steady_clock::now( );
+    SizeType sampleCount = camera.RenderAdaptive( world, materials, lights, renderBuffer, maxBounces, minSamplesPerPixel, maxSamplesPerPixel, maxError );
+    double   seconds     = std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( );
+
+    std::cout << "Render time: " << seconds << " s, average samples per pixel: " << double( sampleCount ) / double( renderBuffer.GetWidth( ) * renderBuffer.GetHeight( ) ) << std::endl;
 
     WritePPM( renderBuffer, "image.ppm" );
 }
\ No newline at end of file
@@ -0,0 +1,239 @@
+#include <chrono>
+#include <iostream>
+
+#include "Material.hpp"
+#include "WideBvh.hpp"
+
+using namespace RayTracer;
+
+// Traversal benchmark of the binary, 4 wide and 8 wide BVH layouts on the same random sphere scene.
+
+HittableList CreateWorld( SizeType sphereCount, MaterialTable& materials, Pcg32& rng )
+{
+    auto         material = materials.Add( Lambertian( RgbR( 0.5, 0.5, 0.5 ) ) );
+
+    HittableList world;
+
+    for ( SizeType i = 0; i < sphereCount; i++ )
+    {
+        Point3R center { RandomReal<RealType>( rng, -50.0, 50.0 ), RandomReal<RealType>( rng, -50.0, 50.0 ), RandomReal<RealType>( rng, -150.0, -50.0 ) };
+        world.objects.push_back( std::make_shared<Sphere>( center, RandomReal<RealType>( rng, 0.1, 0.5 ), material ) );
+    }
+
+    return world;
+}
+
+std::vector<RayR> CreateRays( SizeType rayCount, Pcg32& rng )
+{
+    std::vector<RayR> rays;
+
+    for ( SizeType i = 0; i < rayCount; i++ )
+    {
+        rays.emplace_back( Point3R { 0.0, 0.0, 0.0 }, Vec3R { RandomReal<RealType>( rng, -0.5, 0.5 ), RandomReal<RealType>( rng, -0.5, 0.5 ), -1.0 } );
+    }
+
+    return rays;
+}
+
+// Rays through the pixels of a width x height grid, ordered by blocks of rayPacketWidth x rayPacketHeight pixels as the
+// camera traces them in packets.
+std::vector<RayR> CreateCoherentRays( SizeType width, SizeType height )
+{
+    std::vector<RayR> rays;
+
+    for ( SizeType blockY = 0; blockY < height; blockY += rayPacketHeight )
+    {
+        for ( SizeType blockX = 0; blockX < width; blockX += rayPacketWidth )
+        {
+            for ( SizeType lane = 0; lane < rayPacketSize; lane++ )
+            {
+                RealType u = RealType( blockX + lane % rayPacketWidth ) / RealType( width ) - RealType( 0.5 );
+                RealType v = RealType( blockY + lane / rayPacketWidth ) / RealType( height ) - RealType( 0.5 );
+
+                rays.emplace_back( Point3R { 0.0, 0.0, 0.0 }, Vec3R { u, v, -1.0 } );
+            }
+        }
+    }
+
+    return rays;
+}
+
+template <class AccelerationStructure>
+void Benchmark( const char* name, const AccelerationStructure& accelerationStructure, const std::vector<RayR>& rays )
+{
+    SizeType hitCount = 0;
+    double   tSum     = 0.0;
+
+    auto     start    = std::chrono::steady_clock::now( );
+
+    for ( const auto& ray : rays )
+    {
+        HitRecord hitRecord;
+
+        if ( accelerationStructure.Hit( ray, IntervalR( 0.001, std::numeric_limits<double>::infinity( ) ), hitRecord ) )
+        {
+            hitCount++;
+            tSum += hitRecord.t;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( );
+
+    std::cout << name << ": " << double( rays.size( ) ) / seconds / 1e6 << " Mrays/s, hits: " << hitCount << ", t sum: " << tSum << std::endl;
+
+    // The same rays as shadow rays, which stop at the first hit found.
+    SizeType occludedCount = 0;
+
+    start                  = std::chrono::steady_clock::now( );
+
+    for ( const auto& ray : rays )
+    {
+        if ( accelerationStructure.Occluded( ray, IntervalR( 0.001, std::numeric_limits<double>::infinity( ) ) ) )
+        {
+            occludedCount++;
+        }
+    }
+
+    seconds = std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( );
+
+    std::cout << name << " occlusion: " << double( rays.size( ) ) / seconds / 1e6 << " Mrays/s, occluded: " << occludedCount << std::endl;
+}
+
+// Coherent rays traced one by one and as packets, which should give the same hits.
+template <class AccelerationStructure>
+void BenchmarkPackets( const char* name, const AccelerationStructure& accelerationStructure, const std::vector<RayR>& rays )
+{
+    SizeType hitCount = 0;
+    double   tSum     = 0.0;
+
+    auto     start    = std::chrono::steady_clock::now( );
+
+    for ( const auto& ray : rays )
+    {
+        Intersection intersection;
+
+        if ( accelerationStructure.Intersect( ray, IntervalR( 0.001, std::numeric_limits<RealType>::infinity( ) ), intersection ) )
+        {
+            hitCount++;
+            tSum += intersection.t;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( );
+
+    std::cout << name << " coherent: " << double( rays.size( ) ) / seconds / 1e6 << " Mrays/s, hits: " << hitCount << ", t sum: " << tSum << std::endl;
+
+    SizeType     packetHitCount = 0;
+    double       packetTSum     = 0.0;
+    RayPacket    packet;
+    Intersection intersections[ RayPacket::Size ];
+
+    start                       = std::chrono::steady_clock::now( );
+
+    for ( SizeType first = 0; first + RayPacket::Size <= rays.size( ); first += RayPacket::Size )
+    {
+        for ( SizeType lane = 0; lane < RayPacket::Size; lane++ )
+        {
+            packet.SetRay( lane, rays[ first + lane ], IntervalR( 0.001, std::numeric_limits<RealType>::infinity( ) ) );
+        }
+
+        LaneMask hits = accelerationStructure.IntersectPacket( packet, ( 1u << RayPacket::Size ) - 1, intersections );
+
+        for ( SizeType lane = 0; lane < RayPacket::Size; lane++ )
+        {
+            if ( hits & ( 1u << lane ) )
+            {
+                packetHitCount++;
+                packetTSum += intersections[ lane ].t;
+            }
+        }
+    }
+
+    seconds = std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( );
+
+    std::cout << name << " packets: " << double( rays.size( ) ) / seconds / 1e6 << " Mrays/s, hits: " << packetHitCount << ", t sum: " << packetTSum << std::endl;
+}
+
+// Rays along the z axis with zero x and y components of either sign, which start inside the x and y slabs of every box.
+// All of them must hit the spheres on the axis, one by one, as shadow rays and as a packet.
+template <class AccelerationStructure>
+bool HitsAlongAxis( const char* name, const AccelerationStructure& accelerationStructure )
+{
+    RayPacket    packet;
+    Intersection intersections[ RayPacket::Size ];
+    SizeType     missCount = 0;
+
+    for ( SizeType lane = 0; lane < RayPacket::Size; lane++ )
+    {
+        RayR      ray( Point3R { 0.0, 0.0, 0.0 }, Vec3R { lane & 1 ? -0.0 : 0.0, lane & 2 ? -0.0 : 0.0, -1.0 } );
+        IntervalR interval( 0.001, std::numeric_limits<RealType>::infinity( ) );
+        HitRecord hitRecord;
+
+        missCount += accelerationStructure.Hit( ray, interval, hitRecord ) ? 0 : 1;
+        missCount += accelerationStructure.Occluded( ray, interval ) ? 0 : 1;
+
+        packet.SetRay( lane, ray, interval );
+    }
+
+    LaneMask allLanes = LaneMask( ( 1u << RayPacket::Size ) - 1 );
+
+    if ( accelerationStructure.IntersectPacket( packet, allLanes, intersections ) != allLanes || missCount > 0 )
+    {
+        std::cout << name << " misses rays with zero direction components" << std::endl;
+
+        return false;
+    }
+
+    return true;
+}
+
+int main( )
+{
+    std::cout << "Test004" << std::endl;
+
+    {
+        MaterialTable materials;
+        HittableList  axisWorld;
+        auto          material = materials.Add( Lambertian( RgbR( 0.5, 0.5, 0.5 ) ) );
+
+        for ( SizeType i = 0; i < 16; i++ )
+        {
+            axisWorld.objects.push_back( std::make_shared<Sphere>( Point3R { RealType( i % 4 ) - 1.5, RealType( i / 4 ) - 1.5, -5.0 - RealType( i ) }, 0.75, material ) );
+        }
+
+        Bvh  axisBvh( axisWorld );
+        bool hitsAll = HitsAlongAxis( "Binary", axisBvh );
+
+        hitsAll      = HitsAlongAxis( "4 wide", Bvh4( axisBvh ) ) && hitsAll;
+        hitsAll      = HitsAlongAxis( "8 wide", Bvh8( axisBvh ) ) && hitsAll;
+
+        if ( !hitsAll )
+        {
+            return 1;
+        }
+    }
+
+    SizeType          sphereCount  = 100000;
+    SizeType          rayCount     = 1000000;
+
+    Pcg32             rng;
+    MaterialTable     materials;
+    HittableList      world        = CreateWorld( sphereCount, materials, rng );
+    std::vector<RayR> rays         = CreateRays( rayCount, rng );
+    std::vector<RayR> coherentRays = CreateCoherentRays( 1024, 1024 );
+
+    for ( auto buildMethod : { Bvh::BuildMethod::Sah, Bvh::BuildMethod::Lbvh } )
+    {
+        std::cout << ( buildMethod == Bvh::BuildMethod::Sah ? "SAH build" : "LBVH build" ) << std::endl;
+
+        Bvh bvh( world, buildMethod );
+
+        Benchmark( "Binary", bvh, rays );
+        Benchmark( "4 wide", Bvh4( bvh ), rays );
+        Benchmark( "8 wide", Bvh8( bvh ), rays );
+
+        BenchmarkPackets( "Binary", bvh, coherentRays );
+        BenchmarkPackets( "4 wide", Bvh4( bvh ), coherentRays );
+        BenchmarkPackets( "8 wide", Bvh8( bvh ), coherentRays );
+    }
+}
@@ -0,0 +1,77 @@
+#include <chrono>
+#include <iostream>
+
+#include "Material.hpp"
+#include "SphereSet.hpp"
+
+using namespace RayTracer;
+
+// Intersection benchmark of a HittableList of Sphere objects against a SphereSet holding the same spheres, at sizes
+// typical of BVH leaves and of small procedural scenes.
+
+std::vector<RayR> CreateRays( SizeType rayCount, Pcg32& rng )
+{
+    std::vector<RayR> rays;
+
+    for ( SizeType i = 0; i < rayCount; i++ )
+    {
+        rays.emplace_back( Point3R { 0.0, 0.0, 0.0 }, Vec3R { RandomReal<RealType>( rng, -0.5, 0.5 ), RandomReal<RealType>( rng, -0.5, 0.5 ), -1.0 } );
+    }
+
+    return rays;
+}
+
+void Benchmark( const char* name, const Hittable& world, const std::vector<RayR>& rays )
+{
+    SizeType hitCount = 0;
+    double   tSum     = 0.0;
+
+    auto     start    = std::chrono::steady_clock::now( );
+
+    for ( const auto& ray : rays )
+    {
+        HitRecord hitRecord;
+
+        if ( world.Hit( ray, IntervalR( 0.001, std::numeric_limits<double>::infinity( ) ), hitRecord ) )
+        {
+            hitCount++;
+            tSum += hitRecord.t;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( );
+
+    std::cout << name << ": " << double( rays.size( ) ) / seconds / 1e6 << " Mrays/s, hits: " << hitCount << ", t sum: " << tSum << std::endl;
+}
+
+int main( )
+{
+    std::cout << "Test005" << std::endl;
+
+    std::cout << "SphereSet width: " << SphereSet::Width << std::endl;
+
+    Pcg32             rng;
+    MaterialTable     materials;
+    auto              material = materials.Add( Lambertian( RgbR( 0.5, 0.5, 0.5 ) ) );
+    std::vector<RayR> rays     = CreateRays( 1000000, rng );
+
+    for ( SizeType sphereCount : { 4, 16, 64, 256 } )
+    {
+        HittableList list;
+        SphereSet    set;
+
+        for ( SizeType i = 0; i < sphereCount; i++ )
+        {
+            Point3R center { RandomReal<RealType>( rng, -10.0, 10.0 ), RandomReal<RealType>( rng, -10.0, 10.0 ), RandomReal<RealType>( rng, -30.0, -10.0 ) };
+            double  radius = RandomReal<RealType>( rng, 0.5, 2.0 );
+
+            list.objects.push_back( std::make_shared<Sphere>( center, radius, material ) );
+            set.Add( center, radius, material );
+        }
+
+        std::cout << sphereCount << " spheres" << std::endl;
+
+        Benchmark( "HittableList", list, rays );
+        Benchmark( "SphereSet", set, rays );
+    }
+}
@@ -0,0 +1,70 @@
+#include <chrono>
+#include <iostream>
+
+#include "Camera.hpp"
+#include "Image.hpp"
+#include "Light.hpp"
+#include "Material.hpp"
+#include "WideBvh.hpp"
+
+using namespace RayTracer;
+
+// Room lit by a single small sphere light, rendered at the same sample count with and without direct light sampling.
+// Without it, paths only find the light by chance.
+
+HittableList CreateRoom( MaterialTable& materials, LightList& lights )
+{
+    auto white         = materials.Add( Lambertian( RgbR( 0.73, 0.73, 0.73 ) ) );
+    auto red           = materials.Add( Lambertian( RgbR( 0.65, 0.05, 0.05 ) ) );
+    auto green         = materials.Add( Lambertian( RgbR( 0.12, 0.45, 0.15 ) ) );
+    auto metal         = materials.Add( Metal( RgbR( 0.8, 0.8, 0.8 ) ) );
+
+    auto lightMaterial = materials.Add( DiffuseLight( RgbR( 40.0, 36.0, 30.0 ) ) );
+
+    // Walls, floor and ceiling are large spheres.
+    HittableList world;
+    world.objects.push_back( std::make_shared<Sphere>( Point3R { 0.0, -1001.0, -2.0 }, 1000.0, white ) );
+    world.objects.push_back( std::make_shared<Sphere>( Point3R { 0.0, 1002.0, -2.0 }, 1000.0, white ) );
+    world.objects.push_back( std::make_shared<Sphere>( Point3R { -1002.0, 0.0, -2.0 }, 1000.0, red ) );
+    world.objects.push_back( std::make_shared<Sphere>( Point3R { 1002.0, 0.0, -2.0 }, 1000.0, green ) );
+    world.objects.push_back( std::make_shared<Sphere>( Point3R { 0.0, 0.0, -1005.0 }, 1000.0, white ) );
+    world.objects.push_back( std::make_shared<Sphere>( Point3R { 0.0, 0.0, 1001.0 }, 1000.0, white ) );
+
+    world.objects.push_back( std::make_shared<Sphere>( Point3R { 0.3, -0.5, -2.8 }, 0.5, white ) );
+    world.objects.push_back( std::make_shared<Sphere>( Point3R { -1.0, -0.5, -3.2 }, 0.5, metal ) );
+
+    auto light = std::make_shared<Sphere>( Point3R { 0.0, 1.6, -2.8 }, 0.15, lightMaterial );
+    world.objects.push_back( light );
+    lights.Add( *light, materials );
+
+    return world;
+}
+
+void Render( const char* name, const SceneBvh& world, const MaterialTable& materials, const LightList& lights, const char* fileName )
+{
+    std::vector<Rgba8> buffer( 640 * 480 );
+    RgbaImageView8     renderBuffer = RgbaImageView8( reinterpret_cast<uint8_t*>( buffer.data( ) ), 640, 480, 640 * sizeof( Rgba8 ) );
+
+    Camera             camera( 1.0, 90.0 );
+    camera.SetSampler( std::make_shared<SobolSampler>( ) );
+
+    auto start = std::chrono::steady_clock::now( );
+    camera.Render( world, materials, lights, renderBuffer, 10, 16 );
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( );
+
+    std::cout << name << ": " << seconds << " s" << std::endl;
+
+    WritePPM( renderBuffer, fileName );
+}
+
+int main( )
+{
+    std::cout << "Test006" << std::endl;
+
+    MaterialTable materials;
+    LightList     lights;
+    SceneBvh      world( CreateRoom( materials, lights ) );
+
+    Render( "Light sampling with MIS", world, materials, lights, "lights.ppm" );
+    Render( "Scattering only", world, materials, LightList( ), "scattering.ppm" );
+}
@@ -0,0 +1,78 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "Camera.hpp"
+#include "Image.hpp"
+#include "Light.hpp"
+#include "Material.hpp"
+#include "WideBvh.hpp"
+
+using namespace RayTracer;
+
+// Lit room full of small diffuse and metal spheres, rendered path by path and as a wavefront. Both give the same image,
+// only the order of the work differs.
+
+HittableList CreateScene( MaterialTable& materials, LightList& lights, Pcg32& rng )
+{
+    auto white         = materials.Add( Lambertian( RgbR( 0.73, 0.73, 0.73 ) ) );
+    auto red           = materials.Add( Lambertian( RgbR( 0.65, 0.05, 0.05 ) ) );
+    auto metal         = materials.Add( Metal( RgbR( 0.8, 0.8, 0.8 ) ) );
+
+    auto lightMaterial = materials.Add( DiffuseLight( RgbR( 40.0, 36.0, 30.0 ) ) );
+
+    HittableList world;
+    world.objects.push_back( std::make_shared<Sphere>( Point3R { 0.0, -1001.0, -2.0 }, 1000.0, white ) );
+    world.objects.push_back( std::make_shared<Sphere>( Point3R { 0.0, 1002.0, -2.0 }, 1000.0, white ) );
+    world.objects.push_back( std::make_shared<Sphere>( Point3R { -1002.0, 0.0, -2.0 }, 1000.0, red ) );
+    world.objects.push_back( std::make_shared<Sphere>( Point3R { 0.0, 0.0, -1005.0 }, 1000.0, white ) );
+
+    for ( SizeType i = 0; i < 1000; i++ )
+    {
+        Point3R center { RandomReal<RealType>( rng, -1.8, 1.8 ), RandomReal<RealType>( rng, -0.9, 0.9 ), RandomReal<RealType>( rng, -4.5, -2.0 ) };
+        world.objects.push_back( std::make_shared<Sphere>( center, RandomReal<RealType>( rng, 0.02, 0.08 ), i % 2 == 0 ? metal : white ) );
+    }
+
+    auto light = std::make_shared<Sphere>( Point3R { 0.0, 1.6, -2.8 }, 0.15, lightMaterial );
+    world.objects.push_back( light );
+    lights.Add( *light, materials );
+
+    return world;
+}
+
+int main( )
+{
+    std::cout << "Test007" << std::endl;
+
+    Pcg32              rng;
+    MaterialTable      materials;
+    LightList          lights;
+    SceneBvh           world( CreateScene( materials, lights, rng ) );
+
+    std::vector<Rgba8> pathBuffer( 640 * 480 );
+    std::vector<Rgba8> wavefrontBuffer( 640 * 480 );
+    RgbaImageView8     pathImage      = RgbaImageView8( reinterpret_cast<uint8_t*>( pathBuffer.data( ) ), 640, 480, 640 * sizeof( Rgba8 ) );
+    RgbaImageView8     wavefrontImage = RgbaImageView8( reinterpret_cast<uint8_t*>( wavefrontBuffer.data( ) ), 640, 480, 640 * sizeof( Rgba8 ) );
+
+    Camera             pathCamera( 1.0, 90.0 );
+    Camera             wavefrontCamera( 1.0, 90.0 );
+
+    auto               start = std::chrono::steady_clock::now( );
+    pathCamera.Render( world, materials, lights, pathImage, 10, 16 );
+    std::cout << "Path by path: " << std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( ) << " s" << std::endl;
+
+    start = std::chrono::steady_clock::now( );
+    wavefrontCamera.RenderWavefront( world, materials, lights, wavefrontImage, 10, 16 );
+    std::cout << "Wavefront: " << std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( ) << " s" << std::endl;
+
+    SizeType differingPixels = 0;
+
+    for ( SizeType k = 0; k < pathBuffer.size( ); k++ )
+    {
+        differingPixels += std::memcmp( &pathBuffer[ k ], &wavefrontBuffer[ k ], sizeof( Rgba8 ) ) != 0 ? 1 : 0;
+    }
+
+    std::cout << "Differing pixels: " << differingPixels << std::endl;
+
+    WritePPM( wavefrontImage, "wavefront.ppm" );
+}
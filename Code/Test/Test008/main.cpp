@@ -0,0 +1,137 @@
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include "Camera.hpp"
+#include "Image.hpp"
+#include "Light.hpp"
+#include "Material.hpp"
+#include "TriangleMesh.hpp"
+#include "WideBvh.hpp"
+
+using namespace RayTracer;
+
+// Finely tessellated sphere with smooth normals next to a faceted one, rendered with both triangle kernels. Rays through
+// the shared edges of the triangles may slip through the mesh with Moller-Trumbore, never with the watertight kernel.
+
+// Latitude and longitude tessellation, with one vertex per pole and the seam closed, so that no edge is duplicated.
+TriangleMeshData CreateSphereMesh( const Point3R& center, RealType radius, uint32_t segments, uint32_t rings, bool smooth )
+{
+    TriangleMeshData data;
+
+    auto             addVertex = [ & ]( RealType theta, RealType phi )
+    {
+        Vec3R normal { std::sin( theta ) * std::cos( phi ), std::cos( theta ), std::sin( theta ) * std::sin( phi ) };
+
+        data.positionX.push_back( center[ 0 ] + radius * normal[ 0 ] );
+        data.positionY.push_back( center[ 1 ] + radius * normal[ 1 ] );
+        data.positionZ.push_back( center[ 2 ] + radius * normal[ 2 ] );
+
+        if ( smooth )
+        {
+            data.normalX.push_back( normal[ 0 ] );
+            data.normalY.push_back( normal[ 1 ] );
+            data.normalZ.push_back( normal[ 2 ] );
+        }
+    };
+
+    addVertex( 0, 0 );
+
+    for ( uint32_t ring = 1; ring < rings; ring++ )
+    {
+        for ( uint32_t segment = 0; segment < segments; segment++ )
+        {
+            addVertex( pi * ring / rings, 2 * pi * segment / segments );
+        }
+    }
+
+    addVertex( pi, 0 );
+
+    const uint32_t southPole = uint32_t( data.GetVertexCount( ) - 1 );
+
+    auto           vertex    = [ & ]( uint32_t ring, uint32_t segment )
+    {
+        return ring == 0 ? 0 : ring == rings ? southPole : 1 + ( ring - 1 ) * segments + segment % segments;
+    };
+
+    // Counter clockwise seen from outside.
+    for ( uint32_t ring = 0; ring < rings; ring++ )
+    {
+        for ( uint32_t segment = 0; segment < segments; segment++ )
+        {
+            if ( ring > 0 )
+            {
+                data.indices.insert( data.indices.end( ), { vertex( ring, segment ), vertex( ring, segment + 1 ), vertex( ring + 1, segment + 1 ) } );
+            }
+
+            if ( ring + 1 < rings )
+            {
+                data.indices.insert( data.indices.end( ), { vertex( ring, segment ), vertex( ring + 1, segment + 1 ), vertex( ring + 1, segment ) } );
+            }
+        }
+    }
+
+    return data;
+}
+
+HittableList CreateScene( MaterialTable& materials, LightList& lights, TriangleMesh::Kernel kernel )
+{
+    auto white         = materials.Add( Lambertian( RgbR( 0.73, 0.73, 0.73 ) ) );
+    auto red           = materials.Add( Lambertian( RgbR( 0.65, 0.05, 0.05 ) ) );
+    auto metal         = materials.Add( Metal( RgbR( 0.8, 0.8, 0.8 ) ) );
+
+    auto lightMaterial = materials.Add( DiffuseLight( RgbR( 40.0, 36.0, 30.0 ) ) );
+
+    HittableList world;
+    world.objects.push_back( std::make_shared<Sphere>( Point3R { 0.0, -1001.0, -2.0 }, 1000.0, white ) );
+    world.objects.push_back( std::make_shared<Sphere>( Point3R { 0.0, 0.0, -1005.0 }, 1000.0, white ) );
+
+    world.objects.push_back( std::make_shared<TriangleMesh>( CreateSphereMesh( Point3R { -0.7, -0.3, -2.5 }, 0.7, 512, 256, true ), red, kernel ) );
+    world.objects.push_back( std::make_shared<TriangleMesh>( CreateSphereMesh( Point3R { 0.8, -0.4, -2.2 }, 0.6, 24, 12, false ), metal, kernel ) );
+
+    auto light = std::make_shared<Sphere>( Point3R { 0.0, 1.6, -2.8 }, 0.15, lightMaterial );
+    world.objects.push_back( light );
+    lights.Add( *light, materials );
+
+    return world;
+}
+
+int main( )
+{
+    std::cout << "Test008" << std::endl;
+
+    std::vector<Rgba8>         buffers[ 2 ];
+    const char*                names[ 2 ]   = { "Moller-Trumbore", "Watertight" };
+    const char*                files[ 2 ]   = { "moller_trumbore.ppm", "watertight.ppm" };
+    const TriangleMesh::Kernel kernels[ 2 ] = { TriangleMesh::Kernel::MollerTrumbore, TriangleMesh::Kernel::Watertight };
+
+    for ( SizeType k = 0; k < 2; k++ )
+    {
+        MaterialTable  materials;
+        LightList      lights;
+
+        auto           start = std::chrono::steady_clock::now( );
+        SceneBvh       world( CreateScene( materials, lights, kernels[ k ] ) );
+        std::cout << names[ k ] << " build: " << std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( ) << " s" << std::endl;
+
+        buffers[ k ].resize( 640 * 480 );
+        RgbaImageView8 image = RgbaImageView8( reinterpret_cast<uint8_t*>( buffers[ k ].data( ) ), 640, 480, 640 * sizeof( Rgba8 ) );
+        Camera         camera( 1.0, 90.0 );
+
+        start                = std::chrono::steady_clock::now( );
+        camera.Render( world, materials, lights, image, 10, 16 );
+        std::cout << names[ k ] << " render: " << std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( ) << " s" << std::endl;
+
+        WritePPM( image, files[ k ] );
+    }
+
+    SizeType differingPixels = 0;
+
+    for ( SizeType k = 0; k < buffers[ 0 ].size( ); k++ )
+    {
+        differingPixels += std::memcmp( &buffers[ 0 ][ k ], &buffers[ 1 ][ k ], sizeof( Rgba8 ) ) != 0 ? 1 : 0;
+    }
+
+    std::cout << "Differing pixels: " << differingPixels << std::endl;
+}
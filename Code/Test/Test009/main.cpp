@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "Camera.hpp"
+#include "Image.hpp"
+#include "Light.hpp"
+#include "Material.hpp"
+#include "MeshReader.hpp"
+#include "WideBvh.hpp"
+
+using namespace RayTracer;
+
+// Reads the mesh files given as arguments, or a torus of a million triangles written as binary PLY and as OBJ first, and
+// renders the last one read, scaled to fit the view. The torus must read the same from both files, and PLY headers with
+// malformed property lines must be rejected.
+
+struct TorusVertex
+{
+        float x, y, z;
+        float nx, ny, nz;
+        float u, v;
+};
+
+void WriteTorus( const char* plyFileName, const char* objFileName, uint32_t segments, uint32_t rings )
+{
+    std::vector<TorusVertex> vertices;
+
+    for ( uint32_t ring = 0; ring < rings; ring++ )
+    {
+        for ( uint32_t segment = 0; segment < segments; segment++ )
+        {
+            double theta = 2 * pi * segment / segments;
+            double phi   = 2 * pi * ring / rings;
+            double r     = 1.0 + 0.4 * std::cos( phi );
+
+            // Tilted by 45 degrees about the x axis, towards the camera.
+            Vec3D  normal { std::cos( phi ) * std::cos( theta ), std::sin( phi ), std::cos( phi ) * std::sin( theta ) };
+            Vec3D  point { r * std::cos( theta ), 0.4 * std::sin( phi ), r * std::sin( theta ) };
+
+            point  = Rotate( point, Vec3D { 1.0, 0.0, 0.0 }, 45.0 );
+            normal = Rotate( normal, Vec3D { 1.0, 0.0, 0.0 }, 45.0 );
+
+            vertices.push_back( TorusVertex { float( point[ 0 ] ), float( point[ 1 ] ), float( point[ 2 ] ), float( normal[ 0 ] ), float( normal[ 1 ] ), float( normal[ 2 ] ),
+                                              float( segment ) / float( segments ), float( ring ) / float( rings ) } );
+        }
+    }
+
+    auto vertex = [ & ]( uint32_t ring, uint32_t segment )
+    {
+        return int32_t( ( ring % rings ) * segments + segment % segments );
+    };
+
+    std::ofstream ply( plyFileName, std::ios::binary );
+    ply << "ply\nformat binary_little_endian 1.0\nelement vertex " << vertices.size( ) << "\nproperty float x\nproperty float y\nproperty float z\n"
+        << "property float nx\nproperty float ny\nproperty float nz\nproperty float u\nproperty float v\nelement face " << 2 * segments * rings
+        << "\nproperty list uchar int vertex_indices\nend_header\n";
+    ply.write( reinterpret_cast<const char*>( vertices.data( ) ), std::streamsize( vertices.size( ) * sizeof( TorusVertex ) ) );
+
+    std::ofstream obj( objFileName );
+    obj.precision( 9 );
+
+    for ( const TorusVertex& v : vertices )
+    {
+        obj << "v " << v.x << ' ' << v.y << ' ' << v.z << '\n';
+    }
+
+    // Texture coordinates and normals in reverse order, so that every corner has three different indices, as in the
+    // files of most modelling tools.
+    for ( auto v = vertices.rbegin( ); v != vertices.rend( ); v++ )
+    {
+        obj << "vt " << v->u << ' ' << v->v << '\n';
+    }
+
+    for ( auto v = vertices.rbegin( ); v != vertices.rend( ); v++ )
+    {
+        obj << "vn " << v->nx << ' ' << v->ny << ' ' << v->nz << '\n';
+    }
+
+    auto objCorner = [ & ]( int32_t vertex )
+    {
+        int32_t reversed = int32_t( vertices.size( ) ) - vertex;
+
+        return std::to_string( vertex + 1 ) + '/' + std::to_string( reversed ) + '/' + std::to_string( reversed );
+    };
+
+    // Counter clockwise seen from outside.
+    for ( uint32_t ring = 0; ring < rings; ring++ )
+    {
+        for ( uint32_t segment = 0; segment < segments; segment++ )
+        {
+            int32_t triangles[ 2 ][ 3 ] = { { vertex( ring, segment ), vertex( ring + 1, segment ), vertex( ring + 1, segment + 1 ) },
+                                            { vertex( ring, segment ), vertex( ring + 1, segment + 1 ), vertex( ring, segment + 1 ) } };
+
+            for ( const auto& triangle : triangles )
+            {
+                uint8_t cornerCount = 3;
+                ply.write( reinterpret_cast<const char*>( &cornerCount ), 1 );
+                ply.write( reinterpret_cast<const char*>( triangle ), sizeof( triangle ) );
+
+                obj << "f " << objCorner( triangle[ 0 ] ) << ' ' << objCorner( triangle[ 1 ] ) << ' ' << objCorner( triangle[ 2 ] ) << '\n';
+            }
+        }
+    }
+}
+
+// Whether the meshes have the same triangles and vertices, with the attributes compared in the single precision of the
+// files.
+bool IsSameMesh( const TriangleMeshData& a, const TriangleMeshData& b )
+{
+    const std::vector<RealType> TriangleMeshData::* attributes[] = { &TriangleMeshData::positionX, &TriangleMeshData::positionY, &TriangleMeshData::positionZ,
+                                                                      &TriangleMeshData::normalX,   &TriangleMeshData::normalY,   &TriangleMeshData::normalZ,
+                                                                      &TriangleMeshData::textureU,  &TriangleMeshData::textureV };
+
+    if ( a.indices != b.indices )
+    {
+        return false;
+    }
+
+    for ( auto attribute : attributes )
+    {
+        if ( !std::equal( ( a.*attribute ).begin( ), ( a.*attribute ).end( ), ( b.*attribute ).begin( ), ( b.*attribute ).end( ),
+                          []( RealType x, RealType y ) { return float( x ) == float( y ); } ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Header lines that lack the name or the type of a property.
+bool RejectsMalformedPlyHeaders( )
+{
+    for ( const char* property : { "property float", "property list uchar int", "property list uchar vertex_indices" } )
+    {
+        std::ofstream( "malformed.ply", std::ios::binary ) << "ply\nformat binary_little_endian 1.0\nelement vertex 0\nproperty float x\nproperty float y\n"
+                                                              "property float z\nelement face 0\n"
+                                                           << property << "\nend_header\n";
+
+        TriangleMeshData data;
+
+        if ( ReadPly( "malformed.ply", data ) )
+        {
+            std::cout << "Accepted \"" << property << "\"" << std::endl;
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Moves and scales the mesh into a sphere of radius 1 around center.
+void FitMesh( TriangleMeshData& data, const Point3R& center )
+{
+    AabbR box;
+
+    for ( SizeType i = 0; i < data.GetVertexCount( ); i++ )
+    {
+        box.Expand( Point3R { data.positionX[ i ], data.positionY[ i ], data.positionZ[ i ] } );
+    }
+
+    Point3R  boxCenter = box.GetCentroid( );
+    RealType scale     = RealType( 2 ) / std::max( box.GetExtent( ).Magnitude( ), std::numeric_limits<RealType>::min( ) );
+
+    for ( SizeType i = 0; i < data.GetVertexCount( ); i++ )
+    {
+        data.positionX[ i ] = center[ 0 ] + scale * ( data.positionX[ i ] - boxCenter[ 0 ] );
+        data.positionY[ i ] = center[ 1 ] + scale * ( data.positionY[ i ] - boxCenter[ 1 ] );
+        data.positionZ[ i ] = center[ 2 ] + scale * ( data.positionZ[ i ] - boxCenter[ 2 ] );
+    }
+}
+
+int main( int argc, char** argv )
+{
+    std::cout << "Test009" << std::endl;
+
+    std::vector<const char*> fileNames( argv + 1, argv + argc );
+    bool                     isTorus = fileNames.empty( );
+
+    if ( isTorus )
+    {
+        if ( !RejectsMalformedPlyHeaders( ) )
+        {
+            return 1;
+        }
+
+        WriteTorus( "torus.ply", "torus.obj", 1024, 512 );
+        fileNames = { "torus.ply", "torus.obj" };
+    }
+
+    std::vector<TriangleMeshData> meshes( fileNames.size( ) );
+
+    for ( SizeType i = 0; i < fileNames.size( ); i++ )
+    {
+        auto start = std::chrono::steady_clock::now( );
+
+        if ( !ReadMesh( fileNames[ i ], meshes[ i ] ) )
+        {
+            std::cout << "Cannot read " << fileNames[ i ] << std::endl;
+
+            return 1;
+        }
+
+        std::cout << fileNames[ i ] << ": " << meshes[ i ].GetTriangleCount( ) << " triangles, " << meshes[ i ].GetVertexCount( ) << " vertices in "
+                  << std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( ) << " s" << std::endl;
+    }
+
+    if ( isTorus && !IsSameMesh( meshes[ 0 ], meshes[ 1 ] ) )
+    {
+        std::cout << "torus.ply and torus.obj differ" << std::endl;
+
+        return 1;
+    }
+
+    TriangleMeshData data = std::move( meshes.back( ) );
+
+    meshes.clear( );
+
+    FitMesh( data, Point3R { 0.0, 0.0, -2.2 } );
+
+    MaterialTable materials;
+    LightList     lights;
+
+    auto          white         = materials.Add( Lambertian( RgbR( 0.73, 0.73, 0.73 ) ) );
+    auto          gold          = materials.Add( Metal( RgbR( 0.9, 0.7, 0.3 ) ) );
+
+    auto          lightMaterial = materials.Add( DiffuseLight( RgbR( 40.0, 36.0, 30.0 ) ) );
+
+    HittableList  scene;
+    scene.objects.push_back( std::make_shared<Sphere>( Point3R { 0.0, -1001.0, -2.0 }, 1000.0, white ) );
+    auto light = std::make_shared<Sphere>( Point3R { 0.0, 1.6, -2.0 }, 0.15, lightMaterial );
+    scene.objects.push_back( light );
+    lights.Add( *light, materials );
+
+    auto start = std::chrono::steady_clock::now( );
+    scene.objects.push_back( std::make_shared<TriangleMesh>( std::move( data ), gold, TriangleMesh::Kernel::Watertight ) );
+    std::cout << "Mesh build: " << std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( ) << " s" << std::endl;
+
+    SceneBvh           world( scene );
+
+    std::vector<Rgba8> buffer( 640 * 480 );
+    RgbaImageView8     image = RgbaImageView8( reinterpret_cast<uint8_t*>( buffer.data( ) ), 640, 480, 640 * sizeof( Rgba8 ) );
+    Camera             camera( 1.0, 90.0 );
+
+    start                    = std::chrono::steady_clock::now( );
+    camera.Render( world, materials, lights, image, 10, 16 );
+    std::cout << "Render: " << std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( ) << " s" << std::endl;
+
+    WritePPM( image, "mesh.ppm" );
+}